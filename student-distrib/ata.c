@@ -0,0 +1,365 @@
+/* ata.c
+ * ATA/IDE Disk Driver (Primary Channel, PIO and Bus-Master DMA)
+ *
+ * Drives on the primary channel are found with IDENTIFY and registered
+ * as block devices. Transfers use bus-master DMA through a 64kB bounce
+ * buffer when a PCI IDE controller is present, else PIO. Either way
+ * the caller sleeps until IRQ 14 reports completion, and a timer ends
+ * requests the drive never completes. Before the PIT runs, the drive is
+ * polled for a bounded time instead. One request runs at a time.
+ */
+
+#include "ata.h"
+#include "lib.h"
+#include "i8259.h"
+#include "blkdev.h"
+#include "syscall.h"
+#include "timer.h"
+#include "pit.h"
+#include "trace.h"
+#include "klog.h"
+
+// Physical Region Descriptor
+typedef struct prd_t {
+	uint32_t addr;
+	uint16_t bytes;
+	uint16_t flags;
+} prd_t;
+
+// Drives on the Primary Channel, Master and Slave
+static blkdev_t ata_disks[2];
+// Bus-Master Register Base, 0 if DMA is not Available
+static uint32_t ata_bm = 0;
+
+// The DMA Bounce Buffer may not Cross a 64kB Boundary
+static uint8_t ata_dma_buf[ATA_DMA_SIZE] __attribute__((aligned(ATA_DMA_SIZE)));
+static prd_t ata_prdt __attribute__((aligned(8)));
+
+// One Request at a Time
+static kmutex_t ata_lock;
+// Completion of the Request in Flight
+static volatile uint32_t ata_done;
+static volatile int32_t ata_result;
+static uint32_t ata_waiter;
+static ktimer_t ata_timer;
+
+/* pci_read()
+ * Read a Dword of PCI Configuration Space
+ */
+static uint32_t pci_read(uint32_t bus, uint32_t slot, uint32_t func, uint32_t reg) {
+	outl(PCI_ENABLE | (bus << 16) | (slot << 11) | (func << 8) | (reg & 0xFC), PCI_CONFIG_ADDR);
+	return inl(PCI_CONFIG_DATA);
+}
+
+/* pci_write()
+ * Write a Dword of PCI Configuration Space
+ */
+static void pci_write(uint32_t bus, uint32_t slot, uint32_t func, uint32_t reg, uint32_t val) {
+	outl(PCI_ENABLE | (bus << 16) | (slot << 11) | (func << 8) | (reg & 0xFC), PCI_CONFIG_ADDR);
+	outl(val, PCI_CONFIG_DATA);
+}
+
+/* ata_find_bm()
+ * Find a PCI IDE Controller, Enable Bus Mastering and Return the Base
+ * of its Bus-Master Registers
+ *
+ * Inputs: None
+ * Outputs: I/O Base, 0 if there is no Controller
+ */
+static uint32_t ata_find_bm(void) {
+	uint32_t bus, slot, func, cmd, bar;
+
+	for (bus = 0; bus < PCI_BUSES; bus++) {
+		for (slot = 0; slot < PCI_SLOTS; slot++) {
+			for (func = 0; func < PCI_FUNCS; func++) {
+				if ((pci_read(bus, slot, func, PCI_REG_ID) & 0xFFFF) == 0xFFFF) continue;
+				if ((pci_read(bus, slot, func, PCI_REG_CLASS) >> 16) != PCI_CLASS_IDE) continue;
+				bar = pci_read(bus, slot, func, PCI_REG_BAR4);
+				// BAR4 must be an I/O Space BAR
+				if (!(bar & 1)) continue;
+				cmd = pci_read(bus, slot, func, PCI_REG_CMD);
+				pci_write(bus, slot, func, PCI_REG_CMD, cmd | PCI_CMD_IO | PCI_CMD_MASTER);
+				return bar & 0xFFFC;
+			}
+		}
+	}
+	return 0;
+}
+
+/* ata_wait()
+ * Poll until the Drive is not Busy
+ *
+ * Inputs: None
+ * Outputs: Status, -1 on Timeout
+ */
+static int32_t ata_wait(void) {
+	uint32_t i, status;
+	for (i = 0; i < ATA_SPIN; i++) {
+		status = inb(ATA_IO + ATA_REG_STATUS);
+		if (!(status & ATA_SR_BSY)) return status;
+	}
+	return -1;
+}
+
+/* ata_select()
+ * Select a Drive and Load the Address Registers
+ */
+static void ata_select(uint32_t unit, uint32_t lba, uint32_t count) {
+	outb(ATA_DRIVE_LBA | (unit ? ATA_DRIVE_SLAVE : 0) | ((lba >> 24) & 0x0F), ATA_IO + ATA_REG_DRIVE);
+	// Give the Drive 400ns to Respond
+	inb(ATA_CTRL); inb(ATA_CTRL); inb(ATA_CTRL); inb(ATA_CTRL);
+	outb(count, ATA_IO + ATA_REG_COUNT);
+	outb(lba, ATA_IO + ATA_REG_LBA0);
+	outb(lba >> 8, ATA_IO + ATA_REG_LBA1);
+	outb(lba >> 16, ATA_IO + ATA_REG_LBA2);
+}
+
+/* ata_timeout()
+ * Timer Callback, the Drive did not Interrupt in Time
+ */
+static void ata_timeout(uint32_t data) {
+	if (!ata_done) {
+		if (ata_bm) outb(0, ata_bm + BM_CMD);
+		ata_result = -1;
+		ata_done = 1;
+		process_wake(ata_waiter);
+	}
+}
+
+/* ata_complete()
+ * Acknowledge the Drive and Complete the Request in Flight, if any
+ */
+static void ata_complete(void) {
+	uint32_t status, bm_status = 0;
+
+	if (ata_bm) {
+		bm_status = inb(ata_bm + BM_STATUS);
+		outb(0, ata_bm + BM_CMD);
+		// Write-1-to-Clear the IRQ and Error Bits
+		outb(BM_SR_IRQ | BM_SR_ERR, ata_bm + BM_STATUS);
+	}
+	// Reading Status Acknowledges the Drive
+	status = inb(ATA_IO + ATA_REG_STATUS);
+	if (!ata_done) {
+		ata_result = ((status & (ATA_SR_ERR | ATA_SR_DF)) || (bm_status & BM_SR_ERR)) ? -1 : 0;
+		ata_done = 1;
+		process_wake(ata_waiter);
+	}
+}
+
+/* ata_irq_handler()
+ * IRQ 14 Handler, Completes the Request in Flight
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void ata_irq_handler(void) {
+	cli();
+	trace(TRACE_IRQ, TR_IRQ_ENTER, ATA_IRQ);
+	ata_complete();
+	send_eoi(ATA_IRQ);
+	trace(TRACE_IRQ, TR_IRQ_EXIT, ATA_IRQ);
+	sti();
+}
+
+/* ata_poll()
+ * Complete the Request in Flight by Polling, for at most ATA_SPIN
+ * Reads. The Bus-Master IRQ Bit, or for PIO the Alternate Status
+ * (which does not Acknowledge the Drive), Stands in for IRQ 14.
+ */
+static void ata_poll(void) {
+	uint32_t i;
+
+	// Give the Drive 400ns to Raise BSY
+	inb(ATA_CTRL); inb(ATA_CTRL); inb(ATA_CTRL); inb(ATA_CTRL);
+	for (i = 0; i < ATA_SPIN; i++) {
+		if (ata_bm ? (inb(ata_bm + BM_STATUS) & BM_SR_IRQ) : !(inb(ATA_CTRL) & ATA_SR_BSY)) {
+			ata_complete();
+			return;
+		}
+	}
+	ata_timeout(0);
+}
+
+/* ata_sleep()
+ * Wait for ata_done. Called with Interrupts Disabled. Until pit_init()
+ * jiffies stand still and ata_timer cannot Fire, so the Boot-Time Mount
+ * Polls the Drive instead of Sleeping.
+ */
+static int32_t ata_sleep(void) {
+	if (!pit_running()) ata_poll();
+	while (!ata_done) process_sleep();
+	timer_del(&ata_timer);
+	return ata_result;
+}
+
+/* ata_dma()
+ * One DMA Transfer through the Bounce Buffer
+ *
+ * Inputs: unit - 0 Master, 1 Slave
+ *          lba - First Sector
+ *        count - Sectors, at most ATA_DMA_SECTORS
+ *        write - Direction
+ * Outputs: 0 on Success, -1 on Fail
+ */
+static int32_t ata_dma(uint32_t unit, uint32_t lba, uint32_t count, uint32_t write) {
+	uint32_t flags;
+	int32_t ret;
+
+	if (-1 == ata_wait()) return -1;
+	ata_prdt.addr = (uint32_t) ata_dma_buf;
+	ata_prdt.bytes = (count * BLKDEV_SECTOR) & 0xFFFF;	// 0 Means 64kB
+	ata_prdt.flags = PRD_EOT;
+
+	cli_and_save(flags);
+	outb(0, ata_bm + BM_CMD);
+	outb(BM_SR_IRQ | BM_SR_ERR, ata_bm + BM_STATUS);
+	outl((uint32_t) &ata_prdt, ata_bm + BM_PRDT);
+	ata_done = 0;
+	ata_waiter = current_pid;
+	timer_add(&ata_timer, jiffies + ATA_TIMEOUT_MS);
+	ata_select(unit, lba, count & 0xFF);	// 0 Means 256 Sectors
+	outb(write ? ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA, ATA_IO + ATA_REG_CMD);
+	outb(BM_CMD_START | (write ? 0 : BM_CMD_READ), ata_bm + BM_CMD);
+	ret = ata_sleep();
+	restore_flags(flags);
+	return ret;
+}
+
+/* ata_pio()
+ * PIO Transfer, one IRQ per Sector
+ *
+ * Inputs: unit - 0 Master, 1 Slave
+ *          lba - First Sector
+ *        count - Sectors, at most ATA_DMA_SECTORS
+ *        write - Direction
+ * Outputs: 0 on Success, -1 on Fail
+ */
+static int32_t ata_pio(uint32_t unit, uint32_t lba, uint32_t count, uint32_t write) {
+	uint16_t* p = (uint16_t*) ata_dma_buf;
+	uint32_t flags, i, j;
+	int32_t ret = 0;
+
+	if (-1 == ata_wait()) return -1;
+	cli_and_save(flags);
+	ata_done = 0;
+	ata_waiter = current_pid;
+	timer_add(&ata_timer, jiffies + ATA_TIMEOUT_MS);
+	ata_select(unit, lba, count & 0xFF);
+	outb(write ? ATA_CMD_WRITE_PIO : ATA_CMD_READ_PIO, ATA_IO + ATA_REG_CMD);
+	for (i = 0; i < count && ret == 0; i++) {
+		if (write) {
+			// The Drive asks for each Sector with DRQ
+			if (ata_wait() & (ATA_SR_ERR | ATA_SR_DF)) { ret = -1; break; }
+			for (j = 0; j < BLKDEV_SECTOR / 2; j++) outw(*p++, ATA_IO + ATA_REG_DATA);
+		}
+		// Each Sector Ends with an IRQ
+		ret = ata_sleep();
+		if (ret == 0 && !write) {
+			for (j = 0; j < BLKDEV_SECTOR / 2; j++) *p++ = inw(ATA_IO + ATA_REG_DATA);
+		}
+		if (i + 1 < count) {
+			ata_done = 0;
+			timer_add(&ata_timer, jiffies + ATA_TIMEOUT_MS);
+		}
+	}
+	timer_del(&ata_timer);
+	restore_flags(flags);
+	return ret;
+}
+
+/* ata_xfer()
+ * Split a Request into Bounce Buffer Sized Transfers
+ */
+static int32_t ata_xfer(blkdev_t* dev, uint32_t lba, uint32_t count, uint8_t* buf, uint32_t write) {
+	uint32_t n;
+	int32_t ret = 0;
+
+	kmutex_lock(&ata_lock);
+	while (count > 0) {
+		n = (count > ATA_DMA_SECTORS) ? ATA_DMA_SECTORS : count;
+		if (write) memcpy(ata_dma_buf, buf, n * BLKDEV_SECTOR);
+		ret = ata_bm ? ata_dma(dev->unit, lba, n, write) : ata_pio(dev->unit, lba, n, write);
+		// Keep lba at the Chunk that Failed for the Message below
+		if (ret != 0) break;
+		if (!write) memcpy(buf, ata_dma_buf, n * BLKDEV_SECTOR);
+		lba += n;
+		buf += n * BLKDEV_SECTOR;
+		count -= n;
+	}
+	kmutex_unlock(&ata_lock);
+	if (ret != 0) klog(KLOG_ERR, "ATA.ATA_XFER: ERR - %s Sector %d Failed \n", dev->name, lba);
+	return ret;
+}
+
+static int32_t ata_read(blkdev_t* dev, uint32_t lba, uint32_t count, void* buf) {
+	return ata_xfer(dev, lba, count, (uint8_t*) buf, 0);
+}
+
+static int32_t ata_write(blkdev_t* dev, uint32_t lba, uint32_t count, const void* buf) {
+	return ata_xfer(dev, lba, count, (uint8_t*) buf, 1);
+}
+
+/* ata_identify()
+ * Polled IDENTIFY, with Interrupts Off at the Drive
+ *
+ * Inputs: unit - 0 Master, 1 Slave
+ * Outputs: Size in Sectors, 0 if there is no ATA Drive
+ */
+static uint32_t ata_identify(uint32_t unit) {
+	uint16_t id[ATA_ID_WORDS];
+	int32_t status;
+	uint32_t i;
+
+	ata_select(unit, 0, 0);
+	outb(ATA_CMD_IDENTIFY, ATA_IO + ATA_REG_CMD);
+	// No Drive Leaves the Status at 0 (or Floating at 0xFF)
+	status = inb(ATA_IO + ATA_REG_STATUS);
+	if (status == 0 || status == 0xFF) return 0;
+	status = ata_wait();
+	// ATAPI and SATA Devices Abort IDENTIFY and Set a Signature
+	if (status == -1 || inb(ATA_IO + ATA_REG_LBA1) != 0 || inb(ATA_IO + ATA_REG_LBA2) != 0) return 0;
+	for (i = 0; i < ATA_SPIN && !(status & (ATA_SR_DRQ | ATA_SR_ERR)); i++) {
+		status = inb(ATA_IO + ATA_REG_STATUS);
+	}
+	if (!(status & ATA_SR_DRQ)) return 0;
+	for (i = 0; i < ATA_ID_WORDS; i++) id[i] = inw(ATA_IO + ATA_REG_DATA);
+	return id[ATA_ID_LBA28] | ((uint32_t) id[ATA_ID_LBA28 + 1] << 16);
+}
+
+/* ata_init()
+ * Probe the Primary Channel and Register its Disks as hda/hdb
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void ata_init(void) {
+	uint32_t unit, sectors;
+
+	// Floating Bus, no Controller
+	if (inb(ATA_IO + ATA_REG_STATUS) == 0xFF) return;
+
+	outb(ATA_CTRL_NIEN, ATA_CTRL);
+	for (unit = 0; unit < 2; unit++) {
+		sectors = ata_identify(unit);
+		if (sectors == 0) continue;
+		ata_disks[unit].name[0] = 'h';
+		ata_disks[unit].name[1] = 'd';
+		ata_disks[unit].name[2] = 'a' + unit;
+		ata_disks[unit].name[3] = '\0';
+		ata_disks[unit].nr_sectors = sectors;
+		ata_disks[unit].mem = NULL;
+		ata_disks[unit].read = ata_read;
+		ata_disks[unit].write = ata_write;
+		ata_disks[unit].unit = unit;
+		blkdev_register(&ata_disks[unit]);
+		printf("(%s %dMB) ", ata_disks[unit].name, sectors >> 11);
+	}
+
+	ata_bm = ata_find_bm();
+	timer_setup(&ata_timer, ata_timeout, 0);
+	// Discard any Stale Interrupt, then let the Drive Interrupt
+	inb(ATA_IO + ATA_REG_STATUS);
+	outb(0, ATA_CTRL);
+	enable_irq(ATA_IRQ);
+}
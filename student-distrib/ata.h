@@ -0,0 +1,91 @@
+/* ata.h
+ * ATA/IDE Disk Driver (Primary Channel, PIO and Bus-Master DMA)
+ */
+
+#ifndef _ATA_H
+#define _ATA_H
+
+#include "types.h"
+
+// Primary Channel is connected to IRQ 14 (IRQ 6 on Slave)
+#define ATA_IRQ			14
+
+// Primary Channel Command Block and Control Registers
+#define ATA_IO			0x1F0
+#define ATA_CTRL		0x3F6
+#define ATA_REG_DATA	0
+#define ATA_REG_ERROR	1
+#define ATA_REG_COUNT	2
+#define ATA_REG_LBA0	3
+#define ATA_REG_LBA1	4
+#define ATA_REG_LBA2	5
+#define ATA_REG_DRIVE	6
+#define ATA_REG_STATUS	7
+#define ATA_REG_CMD		7
+
+// Status Bits
+#define ATA_SR_ERR		0x01
+#define ATA_SR_DRQ		0x08
+#define ATA_SR_DF		0x20
+#define ATA_SR_BSY		0x80
+
+// Control Register: Interrupts off (nIEN)
+#define ATA_CTRL_NIEN	0x02
+
+// Commands (28-bit LBA)
+#define ATA_CMD_READ_PIO	0x20
+#define ATA_CMD_WRITE_PIO	0x30
+#define ATA_CMD_READ_DMA	0xC8
+#define ATA_CMD_WRITE_DMA	0xCA
+#define ATA_CMD_FLUSH		0xE7
+#define ATA_CMD_IDENTIFY	0xEC
+
+// Drive Select: LBA Mode, Bit 4 picks the Slave
+#define ATA_DRIVE_LBA	0xE0
+#define ATA_DRIVE_SLAVE	0x10
+
+// IDENTIFY Words holding the 28-bit LBA Sector Count
+#define ATA_ID_WORDS	256
+#define ATA_ID_LBA28	60
+
+// PCI Configuration Mechanism #1
+#define PCI_CONFIG_ADDR	0xCF8
+#define PCI_CONFIG_DATA	0xCFC
+#define PCI_ENABLE		0x80000000
+#define PCI_BUSES		256
+#define PCI_SLOTS		32
+#define PCI_FUNCS		8
+#define PCI_REG_ID		0x00
+#define PCI_REG_CMD		0x04
+#define PCI_REG_CLASS	0x08
+#define PCI_REG_BAR4	0x20
+#define PCI_CMD_IO		0x0001
+#define PCI_CMD_MASTER	0x0004
+// Class 01 (Storage), Subclass 01 (IDE)
+#define PCI_CLASS_IDE	0x0101
+
+// Bus-Master IDE Registers (Primary Channel) and Bits
+#define BM_CMD			0
+#define BM_STATUS		2
+#define BM_PRDT			4
+#define BM_CMD_START	0x01
+#define BM_CMD_READ		0x08	// Device to Memory
+#define BM_SR_ERR		0x02
+#define BM_SR_IRQ		0x04
+
+// One PRD covers the 64kB Bounce Buffer
+#define ATA_DMA_SIZE	0x10000
+#define ATA_DMA_SECTORS	(ATA_DMA_SIZE / 512)
+#define PRD_EOT			0x8000
+
+// Polling Limit for BSY/DRQ and the IRQ Timeout in Milliseconds
+#define ATA_SPIN		1000000
+#define ATA_TIMEOUT_MS	2000
+
+/* Probe the Primary Channel and Register its Disks as hda/hdb */
+void ata_init(void);
+
+/* IRQ 14 Handler */
+void ata_irq_handler(void);
+
+#endif // _ATA_H
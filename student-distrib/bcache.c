@@ -0,0 +1,309 @@
+/* bcache.c
+ * Block Buffer Cache
+ *
+ * Keeps recently used File System Blocks of Disk Devices in Memory,
+ * keyed by (Device, Block). Lookups go through a Hash Table; a CLOCK
+ * Hand picks the Buffer to Reuse, skipping Pinned Buffers and giving
+ * Recently Used ones a Second Chance. Prefetched Blocks enter without
+ * the Reference Bit, so Read-Ahead that is never Used goes First.
+ *
+ * One Mutex covers the Cache, including the Device Read on a Miss.
+ * Read-Ahead is Queued and Done by the kreadahead Kernel Thread, off
+ * the read() Path: each Run of Blocks not yet Cached is one Device Read
+ * into a Staging Area, made without the Mutex, then Copied into Buffers.
+ */
+
+#include "bcache.h"
+#ifndef FS_HOST
+#include "lib.h"
+#include "syscall.h"
+#include "kthread.h"
+#include "klog.h"
+#endif
+
+static buf_t bufs[BCACHE_NR];
+static uint8_t buf_data[BCACHE_NR][BCACHE_BLOCK_SIZE] __attribute__((aligned(BCACHE_BLOCK_SIZE)));
+static buf_t* bcache_hash[BCACHE_HASH];
+static uint32_t clock_hand = 0;
+static kmutex_t bcache_lock;
+static stat_bcache_t bcache_st;
+
+#ifndef FS_HOST
+// Queued Read-Ahead Requests, Dropped when the Queue is Full
+typedef struct bcache_ra_t {
+	blkdev_t* dev;
+	uint32_t block;
+	uint32_t count;
+} bcache_ra_t;
+static bcache_ra_t ra_queue[BCACHE_RA_QUEUE];
+static uint32_t ra_head = 0;
+static uint32_t ra_tail = 0;
+#endif
+// Consecutive Blocks for one Device Read, only Used by the Worker
+static uint8_t ra_stage[BCACHE_RA_MAX][BCACHE_BLOCK_SIZE];
+// PID of kreadahead, 0 until it is Started
+static uint32_t ra_pid = 0;
+
+#define BCACHE_BUCKET(block)	(&bcache_hash[(block) & (BCACHE_HASH - 1)])
+
+/* bcache_lookup()
+ * Find a Cached Block
+ *
+ * Inputs:   dev - Device
+ *         block - Block Number on the Device
+ * Outputs: Buffer, NULL if not Cached
+ */
+static buf_t* bcache_lookup(blkdev_t* dev, uint32_t block) {
+	buf_t* b;
+	for (b = *BCACHE_BUCKET(block); b != NULL; b = b->hash_next) {
+		if (b->dev == dev && b->block == block) return b;
+	}
+	return NULL;
+}
+
+/* bcache_unhash()
+ * Remove a Buffer from its Hash Chain
+ */
+static void bcache_unhash(buf_t* b) {
+	buf_t** p;
+	for (p = BCACHE_BUCKET(b->block); *p != NULL; p = &(*p)->hash_next) {
+		if (*p == b) {
+			*p = b->hash_next;
+			break;
+		}
+	}
+	b->hash_next = NULL;
+}
+
+/* bcache_victim()
+ * Advance the CLOCK Hand to a Buffer that can be Reused, and Empty it
+ *
+ * Inputs: None
+ * Outputs: Buffer, NULL if every Buffer is Pinned
+ */
+static buf_t* bcache_victim(void) {
+	buf_t* b;
+	uint32_t i;
+
+	// Two Sweeps: the First may only Clear Reference Bits
+	for (i = 0; i < 2 * BCACHE_NR; i++) {
+		b = &bufs[clock_hand];
+		clock_hand = (clock_hand + 1) % BCACHE_NR;
+		if (b->refcnt != 0) continue;
+		if (b->flags & B_REF) {
+			b->flags &= ~B_REF;
+			continue;
+		}
+		if (b->flags & B_VALID) {
+			bcache_unhash(b);
+			bcache_st.evictions++;
+		}
+		b->flags = 0;
+		b->data = buf_data[b - bufs];
+		return b;
+	}
+	klog(KLOG_ERR, "BCACHE.BCACHE_VICTIM: ERR - All Buffers Pinned \n");
+	return NULL;
+}
+
+/* bcache_hash_in()
+ * Make a Buffer Holding a Block Valid and Hash it
+ *
+ * Inputs:     b - Buffer from bcache_victim()
+ *           dev - Device
+ *         block - Block Number on the Device
+ *         flags - Flags besides B_VALID
+ * Outputs: None
+ */
+static void bcache_hash_in(buf_t* b, blkdev_t* dev, uint32_t block, uint32_t flags) {
+	buf_t** bucket = BCACHE_BUCKET(block);
+
+	b->dev = dev;
+	b->block = block;
+	b->flags = B_VALID | flags;
+	b->hash_next = *bucket;
+	*bucket = b;
+}
+
+/* bcache_fill()
+ * Read a Block into an Empty Buffer and Hash it
+ *
+ * Inputs:     b - Buffer from bcache_victim()
+ *           dev - Device
+ *         block - Block Number on the Device
+ *         flags - Flags once Valid
+ * Outputs: 0 on Success, -1 on Fail
+ */
+static int32_t bcache_fill(buf_t* b, blkdev_t* dev, uint32_t block, uint32_t flags) {
+	if (-1 == blk_read(dev, block * BCACHE_BLOCK_SECTORS, BCACHE_BLOCK_SECTORS, b->data)) return -1;
+	bcache_hash_in(b, dev, block, flags);
+	return 0;
+}
+
+/* bread()
+ * Get a Block through the Cache and Pin it
+ *
+ * Inputs:   dev - Device
+ *         block - Block Number on the Device, in BCACHE_BLOCK_SIZE Units
+ * Outputs: Pinned Buffer, NULL on Fail
+ */
+buf_t* bread(blkdev_t* dev, uint32_t block) {
+	buf_t* b;
+
+	kmutex_lock(&bcache_lock);
+	b = bcache_lookup(dev, block);
+	if (b != NULL) {
+		bcache_st.hits++;
+		if (b->flags & B_RA) bcache_st.ra_hits++;
+		b->flags = (b->flags & ~B_RA) | B_REF;
+	}
+	else {
+		bcache_st.misses++;
+		b = bcache_victim();
+		if (b != NULL && -1 == bcache_fill(b, dev, block, B_REF)) b = NULL;
+	}
+	if (b != NULL) b->refcnt++;
+	kmutex_unlock(&bcache_lock);
+	return b;
+}
+
+/* brelse()
+ * Unpin a Buffer
+ *
+ * Inputs: b - Buffer from bread()
+ * Outputs: None
+ */
+void brelse(buf_t* b) {
+	kmutex_lock(&bcache_lock);
+	if (b->refcnt > 0) b->refcnt--;
+	kmutex_unlock(&bcache_lock);
+}
+
+/* bcache_ra_run()
+ * Prefetch the Blocks of a Request that are not Cached yet, one Device
+ * Read per Run of Missing Blocks. They are not Pinned and lose to Used
+ * Blocks at Eviction until they are Read.
+ *
+ * Inputs:   dev - Device
+ *         block - First Block
+ *         count - Number of Blocks, at most BCACHE_RA_MAX
+ * Outputs: None
+ */
+static void bcache_ra_run(blkdev_t* dev, uint32_t block, uint32_t count) {
+	uint32_t last = dev->nr_sectors / BCACHE_BLOCK_SECTORS;
+	uint32_t end, n, i;
+	buf_t* b;
+
+	if (block >= last) return;
+	end = (count > last - block) ? last : block + count;
+	while (block < end) {
+		// Find the next Run of Blocks not Cached
+		kmutex_lock(&bcache_lock);
+		while (block < end && bcache_lookup(dev, block) != NULL) block++;
+		for (n = 0; block + n < end && bcache_lookup(dev, block + n) == NULL; n++);
+		kmutex_unlock(&bcache_lock);
+		if (n == 0) break;
+
+		// Read it without Holding the Cache
+		if (-1 == blk_read(dev, block * BCACHE_BLOCK_SECTORS, n * BCACHE_BLOCK_SECTORS, ra_stage)) return;
+
+		// A Reader may have Missed on some of them meanwhile
+		kmutex_lock(&bcache_lock);
+		for (i = 0; i < n; i++) {
+			if (bcache_lookup(dev, block + i) != NULL) continue;
+			b = bcache_victim();
+			if (b == NULL) break;
+			memcpy(b->data, ra_stage[i], BCACHE_BLOCK_SIZE);
+			bcache_hash_in(b, dev, block + i, B_RA);
+			bcache_st.ra_blocks++;
+		}
+		kmutex_unlock(&bcache_lock);
+		block += n;
+	}
+}
+
+#ifndef FS_HOST
+/* kreadahead()
+ * Kernel Thread that Runs Queued Read-Ahead, Sleeping while there is None
+ *
+ * Inputs: None Effective
+ * Outputs: None
+ */
+static void kreadahead(uint32_t data) {
+	bcache_ra_t r;
+	uint32_t flags;
+
+	while (1) {
+		cli_and_save(flags);
+		while (ra_head == ra_tail) process_sleep();
+		r = ra_queue[ra_head % BCACHE_RA_QUEUE];
+		ra_head++;
+		restore_flags(flags);
+		bcache_ra_run(r.dev, r.block, r.count);
+	}
+}
+
+/* bcache_init()
+ * Start kreadahead. Until the Scheduler Runs Requests just Wait.
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void bcache_init(void) {
+	int32_t pid = kthread_create(kreadahead, 0, "kreadahead");
+	if (pid != -1) ra_pid = pid;
+}
+#endif
+
+/* bcache_readahead()
+ * Queue a Prefetch of Blocks. The Caller does not Wait for it; on the
+ * Host, or before kreadahead is Started, it is Done at once.
+ *
+ * Inputs:   dev - Device
+ *         block - First Block
+ *         count - Number of Blocks
+ * Outputs: None
+ */
+void bcache_readahead(blkdev_t* dev, uint32_t block, uint32_t count) {
+#ifndef FS_HOST
+	uint32_t flags;
+#endif
+
+	if (count > BCACHE_RA_MAX) count = BCACHE_RA_MAX;
+	if (ra_pid == 0) {
+		bcache_ra_run(dev, block, count);
+		return;
+	}
+#ifndef FS_HOST
+	cli_and_save(flags);
+	// A Hint only, Dropped if kreadahead is Behind
+	if (ra_tail - ra_head < BCACHE_RA_QUEUE) {
+		ra_queue[ra_tail % BCACHE_RA_QUEUE].dev = dev;
+		ra_queue[ra_tail % BCACHE_RA_QUEUE].block = block;
+		ra_queue[ra_tail % BCACHE_RA_QUEUE].count = count;
+		ra_tail++;
+		if (process_list[ra_pid] == PROCESS_SLEEPING) process_wake(ra_pid);
+	}
+	restore_flags(flags);
+#endif
+}
+
+/* bcache_stat()
+ * Fill a STAT_BCACHE Snapshot
+ *
+ * Inputs: st - Snapshot
+ * Outputs: None
+ */
+void bcache_stat(stat_bcache_t* st) {
+	uint32_t i;
+
+	*st = bcache_st;
+	st->nr_bufs = BCACHE_NR;
+	st->block_size = BCACHE_BLOCK_SIZE;
+	st->nr_valid = 0;
+	st->nr_pinned = 0;
+	for (i = 0; i < BCACHE_NR; i++) {
+		if (bufs[i].flags & B_VALID) st->nr_valid++;
+		if (bufs[i].refcnt != 0) st->nr_pinned++;
+	}
+}
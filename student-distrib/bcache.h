@@ -0,0 +1,53 @@
+/* bcache.h
+ * Block Buffer Cache
+ */
+
+#ifndef _BCACHE_H
+#define _BCACHE_H
+
+#include "blkdev.h"
+#include "stats.h"
+
+// Cached Blocks and their Size, one File System Block each
+#define BCACHE_NR			32
+#define BCACHE_BLOCK_SIZE	4096
+#define BCACHE_BLOCK_SECTORS	(BCACHE_BLOCK_SIZE / BLKDEV_SECTOR)
+// Hash Buckets, a Power of Two
+#define BCACHE_HASH			64
+// Most Blocks one Read-Ahead Request Brings in, at most BCACHE_NR / 2
+#define BCACHE_RA_MAX		8
+// Read-Ahead Requests Waiting for kreadahead
+#define BCACHE_RA_QUEUE		8
+
+// Buffer Flags
+#define B_VALID		0x1		// data Holds the Block
+#define B_REF		0x2		// Used since the CLOCK Hand last Passed
+#define B_RA		0x4		// Prefetched and not yet Used
+
+typedef struct buf_t {
+	blkdev_t* dev;
+	uint32_t block;
+	uint32_t flags;
+	// Readers Holding the Buffer, it is not Evicted while Nonzero
+	uint32_t refcnt;
+	struct buf_t* hash_next;
+	uint8_t* data;
+} buf_t;
+
+/* Get a Block, Pinned until brelse(). NULL on Fail */
+buf_t* bread(blkdev_t* dev, uint32_t block);
+
+/* Unpin a Block from bread() */
+void brelse(buf_t* b);
+
+/* Start the Read-Ahead Thread */
+void bcache_init(void);
+
+/* Queue count Blocks from block on to be Brought into the Cache without
+ * Pinning them */
+void bcache_readahead(blkdev_t* dev, uint32_t block, uint32_t count);
+
+/* Fill a STAT_BCACHE Snapshot */
+void bcache_stat(stat_bcache_t* st);
+
+#endif // _BCACHE_H
@@ -0,0 +1,205 @@
+/* bench.c
+ * Boot-time Benchmark Suite
+ *
+ * Built into the kernel by "make bench" (RUN_BENCH). Each entry of
+ * bench_registry is timed with the TSC and reported on the screen and
+ * on COM1 as one line per benchmark:
+ *
+ *     BENCH <name> <value> <unit>
+ *
+ * between BENCH_BEGIN and BENCH_END lines, for tools/runbench.py.
+ * Results go to the serial port directly rather than through
+ * SERIAL_CONSOLE so the terminal benchmark only measures the console.
+ */
+
+#include "bench.h"
+#include "lib.h"
+#include "clocksource.h"
+#include "serial.h"
+#include "paging.h"
+#include "syscall.h"
+#include "keyboard.h"
+#include "file_system.h"
+#include "malloc.h"
+
+// System Call used for the Round Trip, set_quantum(0) only Queries
+#define BENCH_SYSCALL_NR	14
+// Size of the File System and Terminal Buffers
+#define BENCH_BUF_SIZE		4096
+#define BENCH_LINE_LEN		80
+// Sizes cycled through by the malloc Benchmark
+#define BENCH_MALLOC_SIZES	8
+// Microseconds per Second and Nanoseconds per Microsecond
+#define BENCH_US_PER_S		1000000
+#define BENCH_NS_PER_US		1000
+
+static uint8_t bench_buf[BENCH_BUF_SIZE];
+
+/* bench_syscall()
+ * int 0x80 Round Trip through syscall_wrapper
+ */
+static uint32_t bench_syscall(uint32_t iters) {
+	uint32_t i;
+	int32_t ret;
+	for (i = 0; i < iters; i++) {
+		asm volatile("int $0x80"
+			: "=a" (ret)
+			: "a" (BENCH_SYSCALL_NR), "b" (0), "c" (0), "d" (0)
+			: "memory", "cc");
+	}
+	return iters;
+}
+
+/* bench_switch()
+ * Address Space Switch as done by context_switch(): Remap the User
+ * Page and Flush the TLB. No Process exists yet at Boot, so the
+ * Register Save and Scheduler Decision are not Included.
+ */
+static uint32_t bench_switch(uint32_t iters) {
+	uint32_t i;
+	for (i = 0; i < iters; i++) {
+		switch_task(1);
+		switch_task(2);
+	}
+	return 2 * iters;
+}
+
+/* bench_fs_read()
+ * Sequential read_data() of the Largest Regular File in 4kB Chunks
+ */
+static uint32_t bench_fs_read(uint32_t iters) {
+	uint32_t i, best = 0, length = 0, len, offset, bytes = 0;
+
+	for (i = 0; i < bl->num_dentries; i++) {
+		if (bl->dentries[i].file_type != FTYPE_REGULAR) continue;
+		if (fs_file_length(bl->dentries[i].inode_index) > length) {
+			length = fs_file_length(bl->dentries[i].inode_index);
+			best = bl->dentries[i].inode_index;
+		}
+	}
+	if (length == 0) return 0;
+
+	for (i = 0; i < iters; i++) {
+		for (offset = 0; offset < length; offset += len) {
+			len = read_data(best, offset, bench_buf, BENCH_BUF_SIZE);
+			if (len == 0 || len == (uint32_t) -1) break;
+			bytes += len;
+		}
+	}
+	return bytes;
+}
+
+/* bench_malloc()
+ * malloc() and free() Pairs over a Mix of Sizes
+ */
+static uint32_t bench_malloc(uint32_t iters) {
+	static const uint32_t sizes[BENCH_MALLOC_SIZES] = {16, 24, 32, 48, 64, 128, 256, 512};
+	uint8_t* p[BENCH_MALLOC_SIZES];
+	uint32_t i, j;
+	for (i = 0; i < iters; i++) {
+		for (j = 0; j < BENCH_MALLOC_SIZES; j++) p[j] = malloc(sizes[j]);
+		for (j = 0; j < BENCH_MALLOC_SIZES; j++) free(p[j]);
+	}
+	return 2 * BENCH_MALLOC_SIZES * iters;
+}
+
+/* bench_terminal()
+ * terminal_write() of Full Lines, Scrolling the Screen
+ */
+static uint32_t bench_terminal(uint32_t iters) {
+	uint32_t i;
+	for (i = 0; i < BENCH_LINE_LEN - 1; i++) bench_buf[i] = 'a' + i % 26;
+	bench_buf[BENCH_LINE_LEN - 1] = '\n';
+	for (i = 0; i < iters; i++) {
+		terminal_write(0, bench_buf, BENCH_LINE_LEN);
+	}
+	return BENCH_LINE_LEN * iters;
+}
+
+/* bench_execute()
+ * Loading Half of execute() for "shell": Executable Check, Entry Point,
+ * Address Space Switch and Image Copy. Entering User Mode needs a
+ * Running Process, so it is not Included.
+ */
+static uint32_t bench_execute(uint32_t iters) {
+	uint32_t i;
+	uint8_t cbuf[S_INT];
+	for (i = 0; i < iters; i++) {
+		if (0 != check_file((uint8_t*) "shell")) return 0;
+		read_file_data((uint8_t*) "shell", ELF_ENTRY_OFFSET, cbuf, S_INT);
+		switch_task(1);
+		read_file_data((uint8_t*) "shell", 0, (uint8_t*) ELF_LOAD_ADDR, UINT16_MAX);
+	}
+	return iters;
+}
+
+// The Benchmark Registry, Run in Order
+static bench_t bench_registry[] = {
+	{"syscall_roundtrip", "ns", 1, 1, 100000, bench_syscall},
+	{"context_switch", "ns", 1, 1, 100000, bench_switch},
+	{"fs_read", "MB/s", 0, 1048576, 200, bench_fs_read},
+	{"malloc", "ops/s", 0, 1, 10000, bench_malloc},
+	{"terminal_write", "chars/s", 0, 1, 2000, bench_terminal},
+	{"execute_load", "ns", 1, 1, 200, bench_execute},
+};
+
+/* bench_report()
+ * Print one Result Line on the Screen and COM1
+ */
+static void bench_report(const char* name, uint32_t value, const char* unit) {
+	int8_t line[BENCH_LINE_LEN];
+	int8_t num[BENCH_LINE_LEN / 2];
+
+	strcpy(line, "BENCH ");
+	strcpy(line + strlen(line), name);
+	strcpy(line + strlen(line), " ");
+	strcpy(line + strlen(line), itoa(value, num, 10));
+	strcpy(line + strlen(line), " ");
+	strcpy(line + strlen(line), unit);
+	strcpy(line + strlen(line), "\n");
+	printf("%s", line);
+	serial_write(0, line, strlen(line));
+}
+
+/* launch_benchmarks()
+ * Run every Benchmark in bench_registry
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void launch_benchmarks() {
+	bench_t* b;
+	uint64_t start, ns, value;
+	uint32_t i, units;
+
+	if (tsc_khz() == 0) {
+		printf("BENCH: ERR - No TSC, Benchmarks Skipped \n");
+		return;
+	}
+	bench_report("BEGIN", sizeof(bench_registry) / sizeof(bench_t), "benchmarks");
+	for (i = 0; i < sizeof(bench_registry) / sizeof(bench_t); i++) {
+		b = &bench_registry[i];
+		// Warm up Caches and TLB
+		b->run(1);
+		start = rdtsc();
+		units = b->run(b->iters);
+		ns = cycles_to_ns(rdtsc() - start);
+		if (units == 0 || ns < BENCH_NS_PER_US) {
+			printf("BENCH: ERR - %s did not Run \n", b->name);
+			continue;
+		}
+		if (b->per_op) {
+			value = ns;
+			div64_32(&value, units);
+		}
+		else {
+			// Units per Second, in Microseconds to keep the Divisor 32-bit
+			value = (uint64_t) units * BENCH_US_PER_S;
+			div64_32(&value, b->scale);
+			div64_32(&ns, BENCH_NS_PER_US);
+			div64_32(&value, (uint32_t) ns);
+		}
+		bench_report(b->name, (uint32_t) value, b->unit);
+	}
+	bench_report("END", 0, "done");
+}
@@ -0,0 +1,22 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "types.h"
+
+/* Benchmark Entry: run() does iters Iterations and Returns the Units
+ * of Work done (Calls, Bytes, Characters...) */
+typedef struct bench_t {
+	const char* name;
+	const char* unit;
+	// Report Nanoseconds per Iteration instead of Units per Second
+	uint32_t per_op;
+	// Units per Reported Unit, e.g. 1048576 for MB/s
+	uint32_t scale;
+	uint32_t iters;
+	uint32_t (*run)(uint32_t iters);
+} bench_t;
+
+// benchmark launcher, enabled by "make bench"
+void launch_benchmarks();
+
+#endif /* BENCH_H */
@@ -0,0 +1,109 @@
+/* blkdev.c
+ * Generic Block Device Layer
+ *
+ * Drivers fill in a blkdev_t and register it; the file system reads
+ * through blk_read() without knowing whether the sectors come from a
+ * disk or from a RAM image such as the multiboot module.
+ */
+
+#include "blkdev.h"
+#ifndef FS_HOST
+#include "lib.h"
+#endif
+
+static blkdev_t* blkdevs[BLKDEV_MAX];
+static uint32_t nr_blkdevs = 0;
+
+/* blkdev_register()
+ * Add a Block Device
+ *
+ * Inputs: dev - Filled in Device
+ * Outputs: Device Index, -1 if the Table is Full
+ */
+int32_t blkdev_register(blkdev_t* dev) {
+	if (nr_blkdevs == BLKDEV_MAX) {
+		printf("BLKDEV.BLKDEV_REGISTER: ERR - No Slot for %s \n", dev->name);
+		return -1;
+	}
+	blkdevs[nr_blkdevs] = dev;
+	return nr_blkdevs++;
+}
+
+/* blkdev_get()
+ * Look up a Block Device by Index
+ *
+ * Inputs: idx - Index in Registration Order
+ * Outputs: Device, NULL if there is none
+ */
+blkdev_t* blkdev_get(uint32_t idx) {
+	return (idx < nr_blkdevs) ? blkdevs[idx] : NULL;
+}
+
+/* blk_read()
+ * Read Sectors from a Device
+ *
+ * Inputs:   dev - Device
+ *           lba - First Sector
+ *         count - Number of Sectors
+ *           buf - Destination, count * BLKDEV_SECTOR Bytes
+ * Outputs: 0 on Success, -1 on Fail
+ */
+int32_t blk_read(blkdev_t* dev, uint32_t lba, uint32_t count, void* buf) {
+	if (dev == NULL || buf == NULL || lba >= dev->nr_sectors || count > dev->nr_sectors - lba) {
+		printf("BLKDEV.BLK_READ: ERR - Invalid Request \n");
+		return -1;
+	}
+	dev->nr_reads++;
+	dev->sectors_read += count;
+	return dev->read(dev, lba, count, buf);
+}
+
+/* blk_write()
+ * Write Sectors to a Device
+ *
+ * Inputs:   dev - Device
+ *           lba - First Sector
+ *         count - Number of Sectors
+ *           buf - Source, count * BLKDEV_SECTOR Bytes
+ * Outputs: 0 on Success, -1 on Fail
+ */
+int32_t blk_write(blkdev_t* dev, uint32_t lba, uint32_t count, const void* buf) {
+	if (dev == NULL || buf == NULL || dev->write == NULL ||
+		lba >= dev->nr_sectors || count > dev->nr_sectors - lba) {
+		printf("BLKDEV.BLK_WRITE: ERR - Invalid Request \n");
+		return -1;
+	}
+	return dev->write(dev, lba, count, buf);
+}
+
+/* ramdisk_read()
+ * Copy Sectors out of the RAM Image
+ */
+static int32_t ramdisk_read(blkdev_t* dev, uint32_t lba, uint32_t count, void* buf) {
+	memcpy(buf, dev->mem + (lba << BLKDEV_SECTOR_SHIFT), count << BLKDEV_SECTOR_SHIFT);
+	return 0;
+}
+
+/* ramdisk_init()
+ * Set up a Read-Only RAM Device. It is not Registered, the Caller
+ * decides whether it should be.
+ *
+ * Inputs:   dev - Device to Fill in
+ *          name - Device Name
+ *         start - First Byte of the Image
+ *          size - Image Size in Bytes, Rounded down to Sectors
+ * Outputs: None
+ */
+void ramdisk_init(blkdev_t* dev, const char* name, uint8_t* start, uint32_t size) {
+	uint32_t i;
+
+	for (i = 0; i < BLKDEV_NAME_LEN - 1 && name[i] != '\0'; i++) dev->name[i] = name[i];
+	dev->name[i] = '\0';
+	dev->nr_sectors = size >> BLKDEV_SECTOR_SHIFT;
+	dev->mem = start;
+	dev->read = ramdisk_read;
+	dev->write = NULL;
+	dev->unit = 0;
+	dev->nr_reads = 0;
+	dev->sectors_read = 0;
+}
@@ -0,0 +1,50 @@
+/* blkdev.h
+ * Generic Block Device Layer
+ */
+
+#ifndef _BLKDEV_H
+#define _BLKDEV_H
+
+#ifdef FS_HOST
+#include "fs_host.h"
+#else
+#include "types.h"
+#endif
+
+// Sector Size of every Block Device
+#define BLKDEV_SECTOR		512
+#define BLKDEV_SECTOR_SHIFT	9
+// Registered Devices
+#define BLKDEV_MAX			4
+#define BLKDEV_NAME_LEN		8
+
+typedef struct blkdev_t {
+	char name[BLKDEV_NAME_LEN];
+	// Size in Sectors
+	uint32_t nr_sectors;
+	// Memory behind a RAM Device, Read in Place. NULL for Disks
+	uint8_t* mem;
+	// Transfer count Sectors at lba, Returns 0 or -1
+	int32_t (*read)(struct blkdev_t* dev, uint32_t lba, uint32_t count, void* buf);
+	int32_t (*write)(struct blkdev_t* dev, uint32_t lba, uint32_t count, const void* buf);
+	// Driver Data
+	uint32_t unit;
+	// Counters
+	uint32_t nr_reads;
+	uint32_t sectors_read;
+} blkdev_t;
+
+/* Add a Device, Returns its Index or -1 */
+int32_t blkdev_register(blkdev_t* dev);
+
+/* Device by Index, NULL past the Last */
+blkdev_t* blkdev_get(uint32_t idx);
+
+/* Range-Checked Transfers */
+int32_t blk_read(blkdev_t* dev, uint32_t lba, uint32_t count, void* buf);
+int32_t blk_write(blkdev_t* dev, uint32_t lba, uint32_t count, const void* buf);
+
+/* Set up a RAM Device over [start, start + size) */
+void ramdisk_init(blkdev_t* dev, const char* name, uint8_t* start, uint32_t size);
+
+#endif // _BLKDEV_H
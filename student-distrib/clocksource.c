@@ -0,0 +1,139 @@
+/* clocksource.c
+ * TSC Clock Source Calibrated against the PIT
+ *
+ * At boot the TSC is counted while PIT channel 2 runs a one-shot of
+ * CALIBRATE_MS. The best of CALIBRATE_RUNS runs gives the TSC rate,
+ * from which a mult/shift pair turns cycles into nanoseconds with only
+ * multiplies and shifts. Without a TSC, the jiffy clock is used.
+ */
+
+#include "clocksource.h"
+#include "lib.h"
+#include "pit.h"
+#include "paging.h"
+#include "timer.h"
+
+// User Time Page, Padded so no other Kernel Data shares its Page
+static union {
+	vtime_page_t page;
+	uint8_t pad[M_4KB];
+} vtime __attribute__((aligned(M_4KB)));
+
+/* cpu_has_tsc()
+ * Check CPUID for a Time Stamp Counter
+ *
+ * Inputs: None
+ * Outputs: 1 if Present, 0 otherwise
+ */
+static int32_t cpu_has_tsc(void) {
+	uint32_t eax = 1, ebx, ecx, edx;
+	asm volatile("cpuid"
+		: "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+	return (edx & CPUID_TSC) != 0;
+}
+
+/* pit_calibrate_tsc()
+ * Count TSC Cycles during one CALIBRATE_MS One-Shot on PIT Channel 2.
+ * Must be called with Interrupts Disabled.
+ *
+ * Inputs: None
+ * Outputs: Elapsed TSC Cycles
+ */
+static uint64_t pit_calibrate_tsc(void) {
+	uint32_t latch = INI_FRE * CALIBRATE_MS / 1000;
+	uint64_t start, end;
+
+	// Gate Channel 2 on, Speaker off
+	outb((inb(PIT_GATE_PORT) & ~PIT_SPEAKER) | PIT_GATE2, PIT_GATE_PORT);
+	// One-Shot, OUT2 rises when the Count reaches 0
+	outb(PIT_MODE_ONESHOT2, PIT_IO);
+	outb(latch & 0xFF, PIT_CHANNEL_TWO);
+	outb(latch >> BYTE_SHIFT, PIT_CHANNEL_TWO);
+
+	start = rdtsc();
+	while ((inb(PIT_GATE_PORT) & PIT_OUT2) == 0);
+	end = rdtsc();
+
+	return end - start;
+}
+
+/* clocksource_init()
+ * Calibrate the TSC and Publish the Time Page
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void clocksource_init(void) {
+	uint32_t flags;
+	uint64_t best = 0, delta, mult;
+	uint32_t shift;
+	int i;
+
+	vtime.page.seq = 1;
+	vtime.page.valid = 0;
+
+	if (cpu_has_tsc()) {
+		cli_and_save(flags);
+		// Shortest Run is the one least Disturbed
+		for (i = 0; i < CALIBRATE_RUNS; i++) {
+			delta = pit_calibrate_tsc();
+			if (best == 0 || delta < best) best = delta;
+		}
+		div64_32(&best, CALIBRATE_MS);
+		vtime.page.tsc_khz = (uint32_t) best;
+		if (vtime.page.tsc_khz == 0) vtime.page.tsc_khz = 1;
+
+		// Largest Shift whose Multiplier still fits in 32 Bits
+		for (shift = CS_SHIFT_MAX; ; shift--) {
+			mult = (uint64_t) NS_PER_MS << shift;
+			div64_32(&mult, vtime.page.tsc_khz);
+			if ((mult >> 32) == 0 || shift == 0) break;
+		}
+		vtime.page.mult = (uint32_t) mult;
+		vtime.page.shift = shift;
+		vtime.page.tsc_base = rdtsc();
+		vtime.page.valid = 1;
+		restore_flags(flags);
+	}
+	vtime.page.seq = 2;
+
+	// Let every Process Read the Page
+	map_user_page(TIME_PAGE_IDX, (uint32_t) &vtime.page, 0);
+}
+
+/* cycles_to_ns()
+ * Convert TSC Cycles to Nanoseconds. The 32x64 Product is Split in two
+ * 32x32 Multiplies so nothing needs 64-bit Division.
+ *
+ * Inputs: cycles - TSC Cycles
+ * Outputs: Nanoseconds
+ */
+uint64_t cycles_to_ns(uint64_t cycles) {
+	uint32_t hi = (uint32_t) (cycles >> 32);
+	uint32_t lo = (uint32_t) cycles;
+	uint32_t shift = vtime.page.shift;
+
+	return (((uint64_t) hi * vtime.page.mult) << (32 - shift)) +
+		(((uint64_t) lo * vtime.page.mult) >> shift);
+}
+
+/* ktime_ns()
+ * Nanoseconds since clocksource_init()
+ *
+ * Inputs: None
+ * Outputs: Monotonic Time in Nanoseconds
+ */
+uint64_t ktime_ns(void) {
+	if (!vtime.page.valid) return (uint64_t) jiffies * NS_PER_MS;
+	return cycles_to_ns(rdtsc() - vtime.page.tsc_base);
+}
+
+/* tsc_khz()
+ * TSC Frequency
+ *
+ * Inputs: None
+ * Outputs: Frequency in kHz, 0 if there is no TSC
+ */
+uint32_t tsc_khz(void) {
+	return vtime.page.valid ? vtime.page.tsc_khz : 0;
+}
@@ -0,0 +1,72 @@
+/* clocksource.h
+ * TSC Clock Source Calibrated against the PIT
+ */
+
+#ifndef _CLOCKSOURCE_H
+#define _CLOCKSOURCE_H
+
+#include "types.h"
+
+// PIT Channel 2 Data Port and its Gate/Status Port
+#define PIT_CHANNEL_TWO	0x42
+#define PIT_GATE_PORT	0x61
+// Gate Bit, Speaker Bit and OUT2 Status Bit of PIT_GATE_PORT
+#define PIT_GATE2		0x01
+#define PIT_SPEAKER		0x02
+#define PIT_OUT2		0x20
+// 0xB0 = 1011 0000 = Counter2, Low+High byte, Interrupt on Terminal Count, Binary
+#define PIT_MODE_ONESHOT2	0xB0
+
+// Length and Number of Calibration Runs
+#define CALIBRATE_MS	10
+#define CALIBRATE_RUNS	3
+
+// Scale of the Cycles to Nanoseconds Multiplier
+#define CS_SHIFT_MAX	24
+
+// CPUID Leaf 1 EDX Bit for the TSC
+#define CPUID_TSC		0x10
+
+// Virtual Address of the User Time Page (Second Page of VID_DIR)
+#define TIME_VIR_MEM	0x8401000
+// Index of the Time Page in the Video Page Table
+#define TIME_PAGE_IDX	1
+
+/* User Time Page
+ * Mapped Read-Only at TIME_VIR_MEM for every Process, so the Time can
+ * be Read without a System Call:
+ *     ns = ((rdtsc() - tsc_base) * mult) >> shift
+ * seq is Odd while the Kernel Updates the Page.
+ */
+typedef struct vtime_page_t {
+	volatile uint32_t seq;
+	// Nonzero once the TSC is Calibrated
+	uint32_t valid;
+	uint32_t mult;
+	uint32_t shift;
+	uint32_t tsc_khz;
+	uint64_t tsc_base;
+} vtime_page_t;
+
+/* rdtsc()
+ * Read the Time Stamp Counter
+ */
+static inline uint64_t rdtsc(void) {
+	uint32_t lo, hi;
+	asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((uint64_t) hi << 32) | lo;
+}
+
+/* Calibrate the TSC and Publish the Time Page */
+void clocksource_init(void);
+
+/* Nanoseconds since clocksource_init() */
+uint64_t ktime_ns(void);
+
+/* Convert TSC Cycles to Nanoseconds */
+uint64_t cycles_to_ns(uint64_t cycles);
+
+/* TSC Frequency in kHz, 0 if there is no TSC */
+uint32_t tsc_khz(void);
+
+#endif // _CLOCKSOURCE_H
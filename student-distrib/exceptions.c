@@ -4,6 +4,8 @@
 
 #include "exceptions.h"
 #include "lib.h"
+#include "stats.h"
+#include "trace.h"
 
 void division_error(){
 	printf("EXCEPTION: Division Error");
@@ -85,6 +87,7 @@ void general_protection(){
 }
 
 void page_fault(){
+	acct_page_fault();
 	printf("EXCEPTION: Page Fault at Address 0x");
 	
 	int addr;
@@ -97,6 +100,7 @@ void page_fault(){
 	: "eax"
     );
 	printf("%x          ", addr);
+	trace(TRACE_FAULT, TR_PAGE_FAULT, addr);
 	
 	while(1);
 
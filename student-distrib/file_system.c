@@ -1,18 +1,285 @@
 
 #include "file_system.h"
+#include "klog.h"
 
 // Pointer to the Bootblock of the File System
 bootblock *bl;
+// Device the File System is Read from, and its Size in Blocks
+static blkdev_t *fs_dev;
+static uint32_t fs_nr_blocks;
+// Copy of the Bootblock when the Device is not Memory
+static bootblock fs_boot;
+// RAM Device over the Multiboot Module
+static blkdev_t fs_ramdisk;
+
+// Open Regular Files
+static fs_file_t fs_files[FS_OPEN_MAX];
+// Block List Entries Read per fs_copy() when Mapping a File
+#define FS_MAP_CHUNK 64
+
+/* fs_copy()
+ * Copy Bytes out of one File System Block. Memory Devices are Read in
+ * Place; Disks are Read through the Buffer Cache.
+ *
+ * Inputs: block - Block Number in the Image
+ *        offset - First Byte within the Block
+ *           dst - Destination
+ *           len - Bytes, offset + len must not Exceed the Block
+ * Outputs: 0 on Success, -1 on Fail
+ */
+static int32_t fs_copy(uint32_t block, uint32_t offset, uint8_t *dst, uint32_t len) {
+	buf_t *b;
+	
+	if (block >= fs_nr_blocks || offset + len > FS_BLOCK_SIZE) {
+		klog(KLOG_ERR, "FS.FS_COPY: ERR - Block %d Outside the Image \n", block);
+		return -1;
+	}
+	if (fs_dev->mem != NULL) {
+		memcpy(dst, fs_dev->mem + block * FS_BLOCK_SIZE + offset, len);
+		return 0;
+	}
+	
+	b = bread(fs_dev, block);
+	if (b == NULL) return -1;
+	memcpy(dst, b->data + offset, len);
+	brelse(b);
+	return 0;
+}
+
+/* fs_copy_run()
+ * Copy Bytes out of Consecutive Blocks of an Extent. Memory Devices
+ * are Copied in one Piece.
+ *
+ * Inputs: block - First Block in the Image
+ *        offset - First Byte within the Block
+ *           dst - Destination
+ *           len - Bytes, within Blocks Checked by fs_map_file()
+ * Outputs: 0 on Success, -1 on Fail
+ */
+static int32_t fs_copy_run(uint32_t block, uint32_t offset, uint8_t *dst, uint32_t len) {
+	uint32_t n;
+	
+	if (fs_dev->mem != NULL) {
+		memcpy(dst, fs_dev->mem + block * FS_BLOCK_SIZE + offset, len);
+		return 0;
+	}
+	for (; len > 0; block++, offset = 0) {
+		n = FS_BLOCK_SIZE - offset;
+		if (n > len) n = len;
+		if (-1 == fs_copy(block, offset, dst, n)) return -1;
+		dst += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/* fs_extent_find()
+ * Binary Search for the Extent Holding a File Byte
+ *
+ * Inputs: f - Open File
+ *       pos - File Byte, below f->mapped
+ * Outputs: Extent
+ */
+static fs_extent_t *fs_extent_find(fs_file_t *f, uint32_t pos) {
+	uint32_t lo = 0, hi = f->nr_extents - 1, mid;
+	
+	while (lo < hi) {
+		mid = (lo + hi + 1) / 2;
+		if (f->extent[mid].offset <= pos) lo = mid;
+		else hi = mid - 1;
+	}
+	return &f->extent[lo];
+}
+
+/* fs_map_file()
+ * Build the Extent Map of a File, Checking every Data Block once
+ *
+ * Inputs: f - File Slot to Fill
+ *     inode - The inode index
+ * Outputs: 0 on Success, -1 if the inode is Invalid
+ */
+static int32_t fs_map_file(fs_file_t *f, uint32_t inode) {
+	uint32_t list[FS_MAP_CHUNK];
+	uint32_t nr_blocks, idx, i, n, block;
+	uint32_t stop = 0;
+	fs_extent_t *e = NULL;
+	
+	if (inode >= bl->num_inodes) return -1;
+	f->inode = inode;
+	f->length = fs_file_length(inode);
+	f->mapped = 0;
+	f->nr_extents = 0;
+	f->ra_next = 0;
+	f->ra_window = 0;
+	
+	nr_blocks = (f->length + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE;
+	if (nr_blocks > FS_INODE_BLOCKS) nr_blocks = FS_INODE_BLOCKS;
+	// Read the Block List a Chunk at a Time
+	for (idx = 0; idx < nr_blocks && !stop; idx += n) {
+		n = nr_blocks - idx;
+		if (n > FS_MAP_CHUNK) n = FS_MAP_CHUNK;
+		if (-1 == fs_copy(FS_INODE_BLOCK(inode), (1 + idx) * sizeof(uint32_t), (uint8_t *) list, n * sizeof(uint32_t))) return -1;
+		for (i = 0; i < n; i++) {
+			// Stop at a Bad Block; read_data() Reports it if it is Read
+			if (list[i] >= bl->num_data_blocks) {
+				stop = 1;
+				break;
+			}
+			block = FS_DATA_BLOCK(list[i]);
+			if (e != NULL && block == e->block + e->nr_blocks) {
+				e->nr_blocks++;
+				continue;
+			}
+			// Out of Extents, the Rest is Read without the Map
+			if (f->nr_extents == FS_EXTENT_MAX) {
+				stop = 1;
+				break;
+			}
+			e = &f->extent[f->nr_extents++];
+			e->offset = (idx + i) * FS_BLOCK_SIZE;
+			e->block = block;
+			e->nr_blocks = 1;
+		}
+	}
+	if (e != NULL) {
+		f->mapped = e->offset + e->nr_blocks * FS_BLOCK_SIZE;
+		if (f->mapped > f->length) f->mapped = f->length;
+	}
+	return 0;
+}
+
+/* fs_map_read()
+ * Read an Open File: a Binary Search and one Copy per Extent, then
+ * read_data() for any Part past the Map
+ *
+ * Inputs:      f - Open File
+ *         offset - First Byte
+ *            buf - Destination
+ *         length - Bytes, within the File
+ * Outputs: Bytes Read, -1 on Fail
+ */
+static int32_t fs_map_read(fs_file_t *f, uint32_t offset, uint8_t *buf, uint32_t length) {
+	fs_extent_t *e;
+	uint32_t done = 0, pos, rel, n;
+	int32_t ret;
+	
+	while (done < length) {
+		pos = offset + done;
+		if (pos >= f->mapped) {
+			ret = read_data(f->inode, pos, buf + done, length - done);
+			if (ret == -1) return (done == 0) ? -1 : done;
+			return done + ret;
+		}
+		e = fs_extent_find(f, pos);
+		rel = pos - e->offset;
+		// Up to the End of the Extent, or of the Mapped Part
+		n = e->nr_blocks * FS_BLOCK_SIZE - rel;
+		if (n > f->mapped - pos) n = f->mapped - pos;
+		if (n > length - done) n = length - done;
+		if (-1 == fs_copy_run(e->block + rel / FS_BLOCK_SIZE, rel % FS_BLOCK_SIZE, buf + done, n)) {
+			return (done == 0) ? -1 : done;
+		}
+		done += n;
+	}
+	return done;
+}
+
+/* fs_readahead()
+ * Queue a Prefetch of the Blocks after a read() that Continued where
+ * the last read() of the same Open File Stopped. The Window Doubles on
+ * each such read() and Resets when the File is Read out of Order. The
+ * read() does not Wait: kreadahead (bcache.c) Reads the Blocks.
+ *
+ * Inputs:      f - Open File
+ *         offset - Where the read() Started
+ *         length - Bytes it Returned
+ * Outputs: None
+ */
+static void fs_readahead(fs_file_t *f, uint32_t offset, uint32_t length) {
+	fs_extent_t *e;
+	uint32_t pos, end, rel, run;
+	
+	if (fs_dev->mem != NULL || length == 0) return;
+	if (f->ra_next != offset) {
+		f->ra_window = 0;
+	}
+	else {
+		f->ra_window = (f->ra_window == 0) ? FS_RA_MIN : f->ra_window * 2;
+		if (f->ra_window > FS_RA_MAX) f->ra_window = FS_RA_MAX;
+	}
+	f->ra_next = offset + length;
+	if (f->ra_window == 0) return;
+	
+	// Blocks from the one Holding the next Byte, up to the Window
+	pos = f->ra_next - f->ra_next % FS_BLOCK_SIZE;
+	end = pos + f->ra_window * FS_BLOCK_SIZE;
+	if (end > f->mapped) end = f->mapped;
+	// One Request per Extent the Window Touches, each Block Run of it
+	// becomes one Device Read
+	while (pos < end) {
+		e = fs_extent_find(f, pos);
+		rel = (pos - e->offset) / FS_BLOCK_SIZE;
+		run = e->nr_blocks - rel;
+		if (run > (end - pos + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE) run = (end - pos + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE;
+		bcache_readahead(fs_dev, e->block + rel, run);
+		pos += run * FS_BLOCK_SIZE;
+	}
+}
+
+/* fs_mount()
+ * Use a Block Device as the File System if its Bootblock is Sane
+ *
+ * Inputs: dev - Block Device
+ * Outputs: 0 on Success, -1 if it does not Hold a File System
+ */
+int32_t fs_mount(blkdev_t *dev) {
+	bootblock *boot = &fs_boot;
+	uint32_t blocks = dev->nr_sectors / FS_BLOCK_SECTORS;
+	
+	if (blocks == 0) return -1;
+	if (dev->mem != NULL) boot = (bootblock *) dev->mem;
+	else if (-1 == blk_read(dev, 0, FS_BLOCK_SECTORS, boot)) return -1;
+	
+	// The Counts must Describe an Image that Fits on the Device
+	if (boot->num_dentries > FS_DENTRY_MAX || boot->num_inodes == 0 ||
+		boot->num_inodes >= blocks || boot->num_data_blocks > blocks - 1 - boot->num_inodes) {
+		return -1;
+	}
+	fs_dev = dev;
+	// Handles into the Previous File System are Gone
+	memset(fs_files, 0, sizeof(fs_files));
+	fs_nr_blocks = 1 + boot->num_inodes + boot->num_data_blocks;
+	bl = boot;
+	return 0;
+}
 
 /* init_file_system()
- * Load the module start address to the pointer of Bootblock
+ * Mount the File System from the first Disk that Holds one, else from
+ * the Multiboot Module
  *
  * Inputs: module_start - The Start Address of File System Module Loaded from kernel.c 
- * Outputs: None
+ *           module_end - End of the Module, 0 if there is None
+ * Outputs: 0 on Success, -1 if no File System was Found
  */
-void init_file_system(unsigned int module_start) {
+int32_t init_file_system(uint32_t module_start, uint32_t module_end) {
+	blkdev_t *dev;
+	uint32_t i;
 	
-	bl = (void *) module_start;
+	for (i = 0; (dev = blkdev_get(i)) != NULL; i++) {
+		if (0 == fs_mount(dev)) {
+			printf("(%s) ", dev->name);
+			return 0;
+		}
+	}
+	if (module_end > module_start) {
+		ramdisk_init(&fs_ramdisk, "ram0", (uint8_t *) (unsigned long) module_start, module_end - module_start);
+		if (-1 != blkdev_register(&fs_ramdisk) && 0 == fs_mount(&fs_ramdisk)) {
+			printf("(%s) ", fs_ramdisk.name);
+			return 0;
+		}
+	}
+	printf("FS.INIT_FILE_SYSTEM: FATAL - No File System Found \n");
+	return -1;
 }
 
 /* read_dentry_by_name()
@@ -133,126 +400,115 @@ unsigned int read_dentry_by_index(unsigned int index, dentry_t *dentry) {
  * Outputs: The number of bytes successfully read
  */
 unsigned int read_data(unsigned int inode, unsigned int offset, unsigned char *buf, unsigned int length) {
-	unsigned int copy_length;
-	unsigned int rest_length;
-	unsigned int buff_idx = 0;
-	unsigned int reach_end_flag = 0;
-	unsigned int fourkb = 4096;
-	unsigned int four = 4;
+	uint32_t file_length, block_idx, block_off, copy_length;
+	uint32_t buff_idx = 0;
 	
 	// Check if the inode index is invalid
-	if(inode >= bl->num_inodes) {
-		printf("FS.READ_DATA: ERR - Invalid Inode \n");
+	if (inode >= bl->num_inodes) {
+		klog(KLOG_ERR, "FS.READ_DATA: ERR - Invalid Inode \n");
 		return -1;
 	}
+	if (-1 == fs_copy(FS_INODE_BLOCK(inode), 0, (uint8_t*) &file_length, sizeof(uint32_t))) return -1;
 	
-	unsigned int num_data_block;
-	num_data_block = bl->num_data_blocks; 
-
-	// The address of the inode that stores the index of data blocks
-	//CP3.4: NEWLY CHANGED :if (offset > *((unsigned int*)inode_addr)){
-	unsigned char *inode_addr; 
-	inode_addr = ((unsigned char*) bl + (inode + 1) * fourkb);
-	
-	// If offset s less that zero, invalid, return -1
-	if (offset < 0) return -1;
-	// If offset is greater than the data length or less than zero, return -1
-	if (offset > *((unsigned int*)inode_addr)){
-		printf("FS.READ_DATA: ERR - Offset Greater than Length of File \n");
+	// If offset is greater than the data length, nothing can be read
+	if (offset > file_length) {
+		klog(KLOG_ERR, "FS.READ_DATA: ERR - Offset Greater than Length of File \n");
 		return 0;
 	}
 	
-	// true_length is the length of data that can be read, since the length argument may exceed file length
-	// If length is greater than the data size from offset, cut it off
-	unsigned int true_length = *((unsigned int*) inode_addr) - offset;
-	if (true_length > length)
-		true_length = length;
-	// Copy will reach or exceed the end of the data block
-	else reach_end_flag = 1;
-	
-	// Calculate which data block corresponds to offset
-	unsigned int start_data_block = offset / fourkb;
-	unsigned int start_data_offset = offset % fourkb;
-	
-	// data_block_idx_ptr indicates the memory location to store the data block index
-	unsigned char *data_block_idx_ptr; 
-	data_block_idx_ptr = inode_addr + (1 + start_data_block) * 4;
-	
-	// Check if data block index is out of range
-	if(*((unsigned int*) data_block_idx_ptr) >= num_data_block) {
-		printf("FS.READ_DATA: ERR(1) - Data Block Index Out of Range \n");
-		return -1;
-	}
+	// The length may exceed the File, cut it off
+	if (length > file_length - offset) length = file_length - offset;
 	
-	unsigned int data_block_start_addr = ((unsigned int)((unsigned char*) bl) + (1 + bl->num_inodes + (*((unsigned int*) data_block_idx_ptr))) * fourkb);
-	// Need to copy data from the rest block
-	if (true_length > (fourkb - start_data_offset)) {
-		copy_length = fourkb - start_data_offset;
-		rest_length = true_length - copy_length;
-	}
-	// Copy falls within the block
-	else {
-		copy_length = true_length;
-		rest_length = 0;
-	}
-	
-	// Call helper function to copy data from a block
-	copy_data(data_block_start_addr, start_data_offset, buf, copy_length, buff_idx);
-	buff_idx +=copy_length;
-	
-	if (true_length <= (fourkb - start_data_offset)) {
-		return true_length;
-	}
-	
-	// Copy the entire data block
-	while ((rest_length / fourkb) > 0.00) {
-		data_block_idx_ptr += four;
+	// Copy Block by Block
+	while (buff_idx < length) {
+		block_off = (offset + buff_idx) % FS_BLOCK_SIZE;
+		copy_length = FS_BLOCK_SIZE - block_off;
+		if (copy_length > length - buff_idx) copy_length = length - buff_idx;
+		
+		// Look up the Data Block Index in the Inode
+		block_idx = (offset + buff_idx) / FS_BLOCK_SIZE;
+		if (block_idx >= FS_INODE_BLOCKS) {
+			klog(KLOG_ERR, "FS.READ_DATA: ERR - File Length Exceeds the Inode \n");
+			return -1;
+		}
+		if (-1 == fs_copy(FS_INODE_BLOCK(inode), (1 + block_idx) * sizeof(uint32_t), (uint8_t*) &block_idx, sizeof(uint32_t))) return -1;
+		
 		// Check if data block index is out of range
-		if(*((unsigned int*) data_block_idx_ptr) >= num_data_block)
-			return -1; 
-		data_block_start_addr = ((unsigned int)((unsigned char*) bl) + (1 + bl->num_inodes + (*((unsigned int*) data_block_idx_ptr))) * fourkb);
-		// Call helper function to copy data from a block
-		copy_data(data_block_start_addr, 0, buf, fourkb, buff_idx);
-		buff_idx += fourkb;
-		rest_length -= fourkb;
-	}
-	
-	if (rest_length <= 0) {
-		return true_length;
-	}
-	
-	// Copy the last block
-	data_block_idx_ptr += four;
-	// Check if data block index is out of range
-	if(*((unsigned int*)data_block_idx_ptr) >= num_data_block) {
-		printf("FS.READ_DATA: ERR(2) - Data Block Index Out of Range \n");
-		return -1;
+		if (block_idx >= bl->num_data_blocks) {
+			klog(KLOG_ERR, "FS.READ_DATA: ERR - Data Block Index Out of Range \n");
+			return -1;
+		}
+		if (-1 == fs_copy(FS_DATA_BLOCK(block_idx), block_off, buf + buff_idx, copy_length)) return -1;
+		buff_idx += copy_length;
 	}
-	
-	data_block_start_addr = ((unsigned int)((unsigned char*) bl) + (1 + bl->num_inodes + (*((unsigned int*) data_block_idx_ptr))) * fourkb);
-	// Call helper function to copy data from a block
-	copy_data(data_block_start_addr, 0, buf, rest_length, buff_idx);
-	return true_length;
+	return length;
 }
 
-/* copy_data()
- * Helper function to copy data stored in data block into buffer
+/* fs_splice()
+ * Pass an Open File's Bytes to an Actor without Copying them: whole
+ * Extents at once from a Memory Image, Block by Block from the Buffer
+ * Cache. Stops when the Actor Consumes less than it was Given, and at
+ * the End of the Mapped Part of the File.
  *
- * Inputs: start_addr - The start address to copy data
- *                buf - Buffer that stores the data
- *             length - The size of data that needs to be copied
- *         buff_index - The index in the buffer that starts to store data
- * Outputs: None
+ * Inputs: handle - Open File from open_file()
+ *         offset - The start point of a file to be read
+ *         length - Most Bytes to Pass
+ *          actor - Consumer, Returns Bytes Consumed or -1
+ *            ctx - Passed to actor
+ * Outputs: Bytes Consumed, -1 if Nothing could be Passed
  */
-void copy_data(unsigned int start_addr, unsigned int offset, unsigned char *buf, unsigned int length, unsigned int buff_index) {
-	unsigned int i = 0;
-	unsigned char *cur_addr;
-	cur_addr = ((unsigned char*)(start_addr + offset + i));
-	for (; i < length; i++) {
-		cur_addr = ((unsigned char*)(start_addr + offset + i));
-		buf[buff_index] = *cur_addr;
-		buff_index ++;
+int32_t fs_splice(uint32_t handle, uint32_t offset, uint32_t length, fs_actor_t actor, void *ctx) {
+	fs_file_t *f;
+	fs_extent_t *e;
+	uint32_t done = 0, pos, rel, n, block;
+	buf_t *b;
+	int32_t ret = 0;
+	
+	if (handle >= FS_OPEN_MAX || !fs_files[handle].used) return -1;
+	f = &fs_files[handle];
+	if (offset >= f->length) return 0;
+	if (offset >= f->mapped) return -1;
+	if (length > f->mapped - offset) length = f->mapped - offset;
+	
+	while (done < length) {
+		pos = offset + done;
+		e = fs_extent_find(f, pos);
+		rel = pos - e->offset;
+		n = e->nr_blocks * FS_BLOCK_SIZE - rel;
+		if (n > length - done) n = length - done;
+		block = e->block + rel / FS_BLOCK_SIZE;
+		
+		if (fs_dev->mem != NULL) {
+			ret = actor(ctx, fs_dev->mem + block * FS_BLOCK_SIZE + rel % FS_BLOCK_SIZE, n);
+		}
+		else {
+			// Hand out one Block, Pinned while the Actor Runs
+			if (n > FS_BLOCK_SIZE - rel % FS_BLOCK_SIZE) n = FS_BLOCK_SIZE - rel % FS_BLOCK_SIZE;
+			if ((b = bread(fs_dev, block)) == NULL) {
+				ret = -1;
+				break;
+			}
+			ret = actor(ctx, b->data + rel % FS_BLOCK_SIZE, n);
+			brelse(b);
+		}
+		if (ret < 0) break;
+		done += ret;
+		if (ret < n) break;
 	}
+	return (done == 0 && ret < 0) ? -1 : done;
+}
+
+/* fs_file_length()
+ * Length of a File in Bytes
+ *
+ * Inputs: inode - The inode index
+ * Outputs: Length, 0 if the inode is Invalid
+ */
+uint32_t fs_file_length(uint32_t inode) {
+	uint32_t length;
+	if (inode >= bl->num_inodes) return 0;
+	if (-1 == fs_copy(FS_INODE_BLOCK(inode), 0, (uint8_t*) &length, sizeof(uint32_t))) return 0;
+	return length;
 }
 
 /* open_directory()
@@ -281,7 +537,7 @@ int read_directory(unsigned int inode, unsigned int offset, void* buf, int32_t n
 //		return -1;
 	}
 	if (file_read_dentry < 0) {
-		printf("FS.READ_DIRECTORY: ERR - Invalid Dentry %d \n", file_read_dentry);
+		klog(KLOG_ERR, "FS.READ_DIRECTORY: ERR - Invalid Dentry %d \n", file_read_dentry);
 		return -1;
 	}
 	unsigned int success_flag = 0;
@@ -289,7 +545,7 @@ int read_directory(unsigned int inode, unsigned int offset, void* buf, int32_t n
 	dentry_t cur_dentry;
 	success_flag = read_dentry_by_index(file_read_dentry, &cur_dentry);
 	if(success_flag == -1) {
-		printf("FS.READ_DIRECTORY: ERR - Unable to Find Dentry %d \n", file_read_dentry);
+		klog(KLOG_ERR, "FS.READ_DIRECTORY: ERR - Unable to Find Dentry %d \n", file_read_dentry);
 		return -1;
 	}
 	
@@ -311,9 +567,9 @@ int read_directory(unsigned int inode, unsigned int offset, void* buf, int32_t n
  * Inputs:
  * Outputs:
  */
-int write_directory(const void* buf, int32_t size) {
+int write_directory(unsigned int inode, const void* buf, int32_t size) {
 	
-	printf("FS.WRITE_DIRECTORY: ERR - File System is READ ONLY \n");
+	klog(KLOG_ERR, "FS.WRITE_DIRECTORY: ERR - File System is READ ONLY \n");
 	return -1;
 }
 
@@ -323,20 +579,34 @@ int write_directory(const void* buf, int32_t size) {
  * Inputs:
  * Outputs:
  */
-int close_directory(void) {
+int close_directory(unsigned int inode) {
 	
 	return 0;
 }
 
 /* open_file()
- * Open the File with given File Name
+ * Open the File with given File Name and Map its Extents
  *
  * Inputs: filename - File Name
- * Outputs: 0
+ * Outputs: Handle for read_file() and close_file(), -1 on Fail
  */
 int open_file(const uint8_t* filename) {
-
-	return 0;
+	dentry_t cur_dentry;
+	int i;
+	
+	if (-1 == read_dentry_by_name(filename, &cur_dentry) || cur_dentry.file_type != FTYPE_REGULAR) return -1;
+	for (i = 0; i < FS_OPEN_MAX; i++) {
+		if (!fs_files[i].used) {
+			if (-1 == fs_map_file(&fs_files[i], cur_dentry.inode_index)) {
+				klog(KLOG_ERR, "FS.OPEN_FILE: ERR - Invalid Inode \n");
+				return -1;
+			}
+			fs_files[i].used = 1;
+			return i;
+		}
+	}
+	klog(KLOG_ERR, "FS.OPEN_FILE: ERR - Out of Open Files \n");
+	return -1;
 }
 
 /* read_by_data_txt()
@@ -429,12 +699,85 @@ int check_file(unsigned char *fname) {
 }
 
 /* read_file()
- * Direct call to read_data, Refer to read_data() for details
+ * read() of an Open File through its Extent Map, then Read-Ahead if
+ * the File is being Read in Order
  *
+ * Inputs:  inode - Handle from open_file()
+ *         offset - The start point of a file to be read
+ *         buffer - The buffer to store the data to be read
+ *         length - The size in bytes
+ * Outputs: The number of bytes successfully read, -1 on Fail
  */
 int read_file(unsigned int inode, unsigned int offset, void* buffer, int32_t length){
-	// Direct Call to Helper
-	return read_data(inode, offset, buffer, length);
+	fs_file_t *f;
+	int32_t ret;
+	
+	if (inode >= FS_OPEN_MAX || !fs_files[inode].used || length < 0) return -1;
+	f = &fs_files[inode];
+	if (offset >= f->length) return 0;
+	if (length > f->length - offset) length = f->length - offset;
+	ret = fs_map_read(f, offset, buffer, length);
+	// The next read() may Continue where this one Stopped
+	if (ret > 0) fs_readahead(f, offset, ret);
+	return ret;
+}
+
+/* read_file_v()
+ * readv() of an Open File. The Segments are Filled in one Walk over
+ * the Extent Map, moving to the next Extent instead of Searching
+ * again, and the Call counts as one read() for Read-Ahead.
+ *
+ * Inputs:  inode - Handle from open_file()
+ *         offset - The start point of a file to be read
+ *            iov - Segments, Checked by the Caller
+ *         iovcnt - Number of Segments
+ * Outputs: The number of bytes successfully read, -1 on Fail
+ */
+int read_file_v(unsigned int inode, unsigned int offset, const iovec_t* iov, int32_t iovcnt) {
+	fs_file_t *f;
+	fs_extent_t *e = NULL;
+	uint32_t pos = offset, total = 0, left, rel, n;
+	uint8_t *dst;
+	int32_t i, ret, stop = 0, fail = 0;
+	
+	if (inode >= FS_OPEN_MAX || !fs_files[inode].used || iovcnt < 0) return -1;
+	f = &fs_files[inode];
+	for (i = 0; i < iovcnt && !stop && pos < f->length; i++) {
+		if (iov[i].len < 0) return -1;
+		dst = (uint8_t *) iov[i].base;
+		left = iov[i].len;
+		if (left > f->length - pos) left = f->length - pos;
+		while (left > 0) {
+			if (pos >= f->mapped) {
+				ret = read_data(f->inode, pos, dst, left);
+				if (ret == -1) fail = 1;
+				else total += ret;
+				// The Rest is not in the Map, one read_data() per Segment
+				if (ret == -1 || (uint32_t) ret < left) stop = 1;
+				else pos += ret;
+				break;
+			}
+			// Runs are Read in Order, the next Byte is usually in the next Extent
+			if (e != NULL && pos == e->offset + e->nr_blocks * FS_BLOCK_SIZE && e + 1 < f->extent + f->nr_extents) e++;
+			else if (e == NULL || pos < e->offset || pos >= e->offset + e->nr_blocks * FS_BLOCK_SIZE) e = fs_extent_find(f, pos);
+			rel = pos - e->offset;
+			n = e->nr_blocks * FS_BLOCK_SIZE - rel;
+			if (n > f->mapped - pos) n = f->mapped - pos;
+			if (n > left) n = left;
+			if (-1 == fs_copy_run(e->block + rel / FS_BLOCK_SIZE, rel % FS_BLOCK_SIZE, dst, n)) {
+				fail = 1;
+				stop = 1;
+				break;
+			}
+			dst += n;
+			pos += n;
+			left -= n;
+			total += n;
+		}
+	}
+	if (total == 0 && fail) return -1;
+	if (total > 0) fs_readahead(f, offset, total);
+	return total;
 }
 
 /* read_file_data()
@@ -479,19 +822,20 @@ int read_file_data(unsigned char *fname, unsigned int offset, unsigned char *buf
  * Inputs: None Effective
  * Outputs: -1
  */
-int write_file(const void* buf, int32_t size) {	
+int write_file(unsigned int inode, const void* buf, int32_t size) {	
 	
-	printf("FS.WRITE_FILE: ERR - File System is READ ONLY \n");
+	klog(KLOG_ERR, "FS.WRITE_FILE: ERR - File System is READ ONLY \n");
 	return -1;
 }
 
 /* close_file()
  * Closes a File
  * 
- * Inputs: None
- * Outputs: 0
+ * Inputs: inode - Handle from open_file()
+ * Outputs: 0 on Success, -1 if it is not Open
  */
-int close_file(void) {
-	
+int close_file(unsigned int inode) {
+	if (inode >= FS_OPEN_MAX || !fs_files[inode].used) return -1;
+	fs_files[inode].used = 0;
 	return 0;
 }
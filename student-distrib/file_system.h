@@ -1,9 +1,39 @@
 
+#ifdef FS_HOST
+// Host Build for Benchmarking and Fuzzing, see tools/fshost
+#include "fs_host.h"
+#else
 #include "lib.h"
+#endif
 
 #ifndef _FILE_SYSTEM_H
 #define _FILE_SYSTEM_H
 
+#include "blkdev.h"
+#include "bcache.h"
+#include "iovec.h"
+
+/* Image Layout: Bootblock, one Block per Inode, then the Data Blocks */
+#define FS_BLOCK_SIZE		4096
+#define FS_BLOCK_SECTORS	(FS_BLOCK_SIZE / BLKDEV_SECTOR)
+#define FS_DENTRY_MAX		63
+#define FS_INODE_BLOCKS		1023
+#define FS_INODE_BLOCK(i)	(1 + (i))
+#define FS_DATA_BLOCK(d)	(1 + bl->num_inodes + (d))
+
+/* Dentry File Types */
+#define FTYPE_REGULAR 2
+#define FTYPE_DIRECTORY 1
+#define FTYPE_RTC 0
+
+/* Read-Ahead Window in Blocks */
+#define FS_RA_MIN			2
+#define FS_RA_MAX			8
+
+/* Open Files, and Extents Mapped per File */
+#define FS_OPEN_MAX			48
+#define FS_EXTENT_MAX		16
+
 typedef struct dentry_t {
 	unsigned char file_name[32];
 	unsigned int file_type;
@@ -27,10 +57,43 @@ typedef struct inode {
 } inode;
 
 
+/* A Run of Consecutive Image Blocks Holding Consecutive File Blocks */
+typedef struct fs_extent_t {
+	// File Byte the Run Starts at, a Multiple of FS_BLOCK_SIZE
+	uint32_t offset;
+	// First Image Block and Length of the Run
+	uint32_t block;
+	uint32_t nr_blocks;
+} fs_extent_t;
+
+/* Regular File Opened by open_file(), its Handle is the Table Index */
+typedef struct fs_file_t {
+	uint32_t used;
+	uint32_t inode;
+	uint32_t length;
+	// Bytes from the Start the Extents Cover; the rest (a File with
+	// more than FS_EXTENT_MAX Runs, or a Bad Block) goes to read_data()
+	uint32_t mapped;
+	uint32_t nr_extents;
+	fs_extent_t extent[FS_EXTENT_MAX];
+	// Offset a Sequential read() would Start at, and Blocks to Prefetch
+	uint32_t ra_next;
+	uint32_t ra_window;
+} fs_file_t;
+
 extern bootblock *bl;
 extern int file_read_dentry;
 
-void init_file_system(unsigned int module_start);
+int32_t init_file_system(uint32_t module_start, uint32_t module_end);
+
+int32_t fs_mount(blkdev_t *dev);
+
+uint32_t fs_file_length(uint32_t inode);
+
+/* Consumer for fs_splice(), Returns Bytes Consumed or -1 */
+typedef int32_t (*fs_actor_t)(void *ctx, const uint8_t *data, int32_t len);
+
+int32_t fs_splice(uint32_t handle, uint32_t offset, uint32_t length, fs_actor_t actor, void *ctx);
 
 int read_dentry_by_name(const unsigned char *fname, dentry_t *dentry);
 
@@ -42,15 +105,13 @@ unsigned int read_dentry_by_index(unsigned int index, dentry_t *dentry);
 
 unsigned int read_data(unsigned int inode, unsigned int offset, unsigned char *buf, unsigned int length);
 
-void copy_data(unsigned int start_addr, unsigned int offset, unsigned char *buf, unsigned int length, unsigned int buff_index);
-
 int open_directory(const uint8_t* filename);
 
 int read_directory(unsigned int inode, unsigned int offset, void* buf, int32_t nbytes);
 
-int write_directory(const void* buf, int32_t size);
+int write_directory(unsigned int inode, const void* buf, int32_t size);
 
-int close_directory(void);
+int close_directory(unsigned int inode);
 
 int open_file(const uint8_t* filename);
 
@@ -62,10 +123,12 @@ int check_file(unsigned char *fname);
 
 int read_file(unsigned int inode, unsigned int offset, void* buffer, int32_t length);
 
+int read_file_v(unsigned int inode, unsigned int offset, const iovec_t* iov, int32_t iovcnt);
+
 int read_file_data(unsigned char *fname, unsigned int offset, unsigned char *buf, unsigned int length);
 
-int write_file(const void* buf, int32_t size);
+int write_file(unsigned int inode, const void* buf, int32_t size);
 
-int close_file(void);
+int close_file(unsigned int inode);
 
 #endif
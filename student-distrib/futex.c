@@ -0,0 +1,182 @@
+/* futex.c
+ * Wait Queues for User Space Locks
+ *
+ * A user lock only enters the kernel when it is contended: futex_wait()
+ * sleeps on a word of the user page while it still holds the value the
+ * caller saw, and futex_wake() wakes the tasks sleeping on it. Waiters
+ * are queued in FIFO order on a hash bucket chosen by the word's
+ * physical address, so a wake only walks the tasks that hash alike, and
+ * threads of one program find each other while other programs' words at
+ * the same virtual address never match. The queue links live in the
+ * waiters' PCBs.
+ */
+
+#include "futex.h"
+#include "lib.h"
+#include "syscall.h"
+#include "paging.h"
+#include "thread.h"
+#include "klog.h"
+
+// Wait Queue of one Hash Bucket
+typedef struct futex_bucket_t {
+	pcb_struct_t* head;
+	pcb_struct_t* tail;
+} futex_bucket_t;
+
+static futex_bucket_t futex_hash[FUTEX_HASH_SIZE];
+
+/* futex_bucket()
+ * Hash Bucket of a Key
+ *
+ * Inputs: key - Physical Address of the Word
+ * Outputs: Its Bucket
+ */
+static futex_bucket_t* futex_bucket(uint32_t key) {
+	return &futex_hash[(key * FUTEX_HASH_MULT) >> (32 - FUTEX_HASH_BITS)];
+}
+
+/* futex_key()
+ * Check a User Futex Address and Translate it to its Key
+ *
+ * Inputs: addr - Word in the Running Program's User Page
+ * Outputs: Physical Address of the Word, 0 if it is Invalid
+ */
+static uint32_t futex_key(uint32_t* addr) {
+	if (((uint32_t) addr & (S_INT - 1)) || !thread_user_range((uint32_t) addr, S_INT)) return 0;
+	return user_phys(group_pcb()->pid, (uint32_t) addr);
+}
+
+/* futex_unlink()
+ * Remove a Waiter from its Bucket, Called with Interrupts Disabled
+ *
+ * Inputs:    b - Bucket
+ *         prev - Waiter Queued before p, NULL if p is the Head
+ *            p - Waiter to Remove
+ * Outputs: None
+ */
+static void futex_unlink(futex_bucket_t* b, pcb_struct_t* prev, pcb_struct_t* p) {
+	if (prev != NULL) prev->futex_next = p->futex_next;
+	else b->head = p->futex_next;
+	if (b->tail == p) b->tail = prev;
+	p->futex_next = NULL;
+	p->futex_key = 0;
+}
+
+/* futex_queue()
+ * Queue a Task at the Tail of a Key's Bucket, Called with Interrupts
+ * Disabled. It stays Queued until futex_wake_key() or futex_cancel().
+ *
+ * Inputs: pid - Task
+ *         key - Physical Address of the Word
+ * Outputs: None
+ */
+void futex_queue(uint32_t pid, uint32_t key) {
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * pid));
+	futex_bucket_t *b = futex_bucket(key);
+
+	pcb->futex_key = key;
+	pcb->futex_next = NULL;
+	if (b->tail != NULL) b->tail->futex_next = pcb;
+	else b->head = pcb;
+	b->tail = pcb;
+}
+
+/* futex_wake_key()
+ * Dequeue and Wake the Oldest Tasks Queued on a Key
+ *
+ * Inputs: key - Physical Address of the Word
+ *           n - Most Tasks to Wake
+ * Outputs: Number of Tasks Woken
+ */
+int32_t futex_wake_key(uint32_t key, int32_t n) {
+	pcb_struct_t *p, *prev = NULL, *next;
+	futex_bucket_t *b = futex_bucket(key);
+	uint32_t flags;
+	int32_t woken = 0;
+
+	cli_and_save(flags);
+	for (p = b->head; p != NULL && woken < n; p = next) {
+		next = p->futex_next;
+		if (p->futex_key != key) {
+			prev = p;
+			continue;
+		}
+		futex_unlink(b, prev, p);
+		process_wake(p->pid);
+		woken++;
+	}
+	restore_flags(flags);
+	return woken;
+}
+
+/* futex_wait()
+ * Block until futex_wake() on addr, unless *addr no longer Holds val.
+ * The Check and the Queueing are Atomic against futex_wake().
+ *
+ * Inputs: addr - Aligned Word in the User Page
+ *          val - Value the Caller Last Saw there
+ * Outputs: 0 once Woken, -1 if *addr Changed or addr is Invalid
+ */
+int32_t futex_wait(uint32_t* addr, uint32_t val) {
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * current_pid));
+	uint32_t flags, key = futex_key(addr);
+
+	if (key == 0) {
+		klog(KLOG_ERR, "FUTEX.FUTEX_WAIT: FATAL - Invalid Address \n");
+		return -1;
+	}
+
+	cli_and_save(flags);
+	if (*addr != val) {
+		restore_flags(flags);
+		return -1;
+	}
+	futex_queue(current_pid, key);
+	// Dequeueing Clears futex_key, other Wakeups just Sleep again
+	while (pcb->futex_key != 0) process_sleep();
+	restore_flags(flags);
+	return 0;
+}
+
+/* futex_wake()
+ * Wake the Oldest Waiters on addr
+ *
+ * Inputs: addr - Word passed to futex_wait()
+ *            n - Most Waiters to Wake
+ * Outputs: Number of Waiters Woken, -1 if addr is Invalid
+ */
+int32_t futex_wake(uint32_t* addr, int32_t n) {
+	uint32_t key = futex_key(addr);
+
+	if (key == 0) {
+		klog(KLOG_ERR, "FUTEX.FUTEX_WAKE: FATAL - Invalid Address \n");
+		return -1;
+	}
+	return futex_wake_key(key, n);
+}
+
+/* futex_cancel()
+ * Drop a Task from the Wait Queue it Sleeps on, if any
+ *
+ * Inputs: pid - Task
+ * Outputs: None
+ */
+void futex_cancel(uint32_t pid) {
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * pid));
+	pcb_struct_t *p, *prev = NULL;
+	futex_bucket_t *b;
+	uint32_t flags;
+
+	cli_and_save(flags);
+	if (pcb->futex_key != 0) {
+		b = futex_bucket(pcb->futex_key);
+		for (p = b->head; p != NULL; prev = p, p = p->futex_next) {
+			if (p == pcb) {
+				futex_unlink(b, prev, p);
+				break;
+			}
+		}
+	}
+	restore_flags(flags);
+}
@@ -0,0 +1,25 @@
+/* futex.h
+ * Wait Queues for User Space Locks
+ */
+
+#ifndef _FUTEX_H
+#define _FUTEX_H
+
+#include "types.h"
+
+/* Hash Buckets of Wait Queues, a Power of 2 */
+#define FUTEX_HASH_BITS		4
+#define FUTEX_HASH_SIZE		(1 << FUTEX_HASH_BITS)
+/* Multiplier of the Fibonacci Hash, 2^32 / Golden Ratio */
+#define FUTEX_HASH_MULT		0x9E3779B1
+
+/* Queue a Task on a Key, Called with Interrupts Disabled */
+void futex_queue(uint32_t pid, uint32_t key);
+
+/* Wake the Oldest n Tasks Queued on a Key */
+int32_t futex_wake_key(uint32_t key, int32_t n);
+
+/* Drop a Task from its Futex Wait Queue, e.g. before it is Reaped */
+void futex_cancel(uint32_t pid);
+
+#endif // _FUTEX_H
@@ -82,6 +82,8 @@ void set_idt(){
 	SET_IDT_ENTRY(idt[40], rtc_irq_wrapper);
 	SET_IDT_ENTRY(idt[33], kbd_irq_wrapper);
 	SET_IDT_ENTRY(idt[44], mouse_irq_wrapper);
+	SET_IDT_ENTRY(idt[36], serial_irq_wrapper);
+	SET_IDT_ENTRY(idt[46], ata_irq_wrapper);
 	
 	// System Call
 	SET_IDT_ENTRY(idt[128], syscall_wrapper);
@@ -0,0 +1,201 @@
+/* ioring.c
+ * Asynchronous I/O Submission and Completion Rings
+ *
+ * Each Program has a Submission and a Completion Ring at IORING_ADDR in
+ * its own Page. io_submit() Queues Entries the Program has Filled in
+ * and Returns at once. The Kernel Runs Queued Entries through the FD's
+ * op_table_t, in Order, in the Program's own Context: a Batch each
+ * Time the PIT Interrupts it in User Mode, and the Rest in io_wait().
+ * The Program keeps Computing between Batches, and Collects Results
+ * from the Completion Ring without a System Call.
+ */
+
+#include "ioring.h"
+#include "lib.h"
+#include "syscall.h"
+#include "stats.h"
+#include "klog.h"
+#include "thread.h"
+
+#define IORING	((io_ring_t *) IORING_ADDR)
+
+/* ioring_pcb()
+ * PCB of the Running Program, Shared by its Threads as the Rings are
+ */
+static pcb_struct_t* ioring_pcb(void) {
+	return group_pcb();
+}
+
+/* ioring_init()
+ * Empty the Rings of the Program being Executed. Its Page must be
+ * Mapped.
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void ioring_init(void) {
+	pcb_struct_t *pcb = ioring_pcb();
+
+	pcb->io_sq_head = 0;
+	pcb->io_sq_tail = 0;
+	pcb->io_cq_tail = 0;
+	pcb->io_runner = 0;
+	IORING->sq_head = 0;
+	IORING->cq_tail = 0;
+	IORING->sq_tail = 0;
+	IORING->cq_head = 0;
+}
+
+/* ioring_user_buf()
+ * Check that a Buffer lies within the Program's Page
+ */
+static int32_t ioring_user_buf(uint32_t buf, int32_t len) {
+	if (len < 0) return -1;
+	if (len == 0) return 0;
+	if ((buf >> PD_OFFSET) != USER_DIR || ((buf + len - 1) >> PD_OFFSET) != USER_DIR) return -1;
+	return 0;
+}
+
+/* ioring_exec()
+ * Run one Submission Entry, as read() or write() would
+ *
+ * Inputs: pcb - Running Program
+ *         sqe - Kernel Copy of the Entry
+ * Outputs: Result for the Completion
+ */
+static int32_t ioring_exec(pcb_struct_t *pcb, io_sqe_t *sqe) {
+	file_desc_t *f;
+	uint32_t offset;
+	int32_t ret;
+
+	if (sqe->opcode == IORING_OP_NOP) return 0;
+	if (sqe->fd < 0 || sqe->fd >= FD_MAX || pcb->fd_array[sqe->fd].flags == 0) return -1;
+	if (-1 == ioring_user_buf(sqe->buf, sqe->len) || sqe->buf == 0) return -1;
+	f = &pcb->fd_array[sqe->fd];
+
+	if (sqe->opcode == IORING_OP_READ) {
+		// The Same FDs read() Refuses
+		if (sqe->fd == 1) return -1;
+		offset = (sqe->offset == IORING_OFF_CUR) ? f->file_position : sqe->offset;
+		ret = f->function_table->read(f->inode, offset, (void *) sqe->buf, sqe->len);
+		if (ret > 0) {
+			if (sqe->offset == IORING_OFF_CUR) f->file_position += ret;
+			pcb->acct.bytes_read += ret;
+		}
+		return ret;
+	}
+	if (sqe->opcode == IORING_OP_WRITE) {
+		if (sqe->fd == 0) return -1;
+		ret = f->function_table->write(f->inode, (const void *) sqe->buf, sqe->len);
+		if (ret > 0) pcb->acct.bytes_written += ret;
+		return ret;
+	}
+	return -1;
+}
+
+/* ioring_run()
+ * Run Queued Entries in Order until budget is Spent, the Queue is
+ * Empty, or the Completion Ring is Full. One Thread of the Program
+ * Runs them at a Time, as an Entry may Sleep between Claiming its
+ * Completion Slot and Filling it.
+ *
+ * Inputs: budget - Most Entries to Run
+ * Outputs: Entries Run, -1 if a Sibling Thread is Running them
+ */
+static int32_t ioring_run(uint32_t budget) {
+	pcb_struct_t *pcb = ioring_pcb();
+	io_sqe_t sqe;
+	io_cqe_t *cqe;
+	uint32_t done, flags;
+
+	cli_and_save(flags);
+	if (pcb->io_runner != 0) {
+		restore_flags(flags);
+		return -1;
+	}
+	pcb->io_runner = current_pid;
+	restore_flags(flags);
+
+	for (done = 0; done < budget && pcb->io_sq_head != pcb->io_sq_tail; done++) {
+		// The Program may not have Consumed its Completions
+		if (pcb->io_cq_tail - IORING->cq_head >= IORING_ENTRIES) break;
+		sqe = IORING->sq[pcb->io_sq_head % IORING_ENTRIES];
+		pcb->io_sq_head++;
+		IORING->sq_head = pcb->io_sq_head;
+
+		cqe = &IORING->cq[pcb->io_cq_tail % IORING_ENTRIES];
+		cqe->user_data = sqe.user_data;
+		cqe->res = ioring_exec(pcb, &sqe);
+		pcb->io_cq_tail++;
+		IORING->cq_tail = pcb->io_cq_tail;
+	}
+	pcb->io_runner = 0;
+	return done;
+}
+
+/* ioring_resume()
+ * Called by the PIT Wrapper before Returning. Runs a Batch of the
+ * Running Program's Requests if it was Interrupted in User Mode, with
+ * Interrupts Enabled since a Request may Sleep.
+ *
+ * Inputs: cs - Saved CS of the Interrupted Context
+ * Outputs: None
+ */
+void ioring_resume(uint32_t cs) {
+	pcb_struct_t *pcb;
+
+	if ((cs & CS_RPL_MASK) != CS_RPL_MASK || current_pid == 0) return;
+	pcb = ioring_pcb();
+	if (pcb->io_sq_head == pcb->io_sq_tail) return;
+	sti();
+	ioring_run(IORING_BATCH);
+	cli();
+}
+
+/* io_submit()
+ * Queue Submission Entries the Program has Added after the last Call
+ *
+ * Inputs: nr - Most Entries to Queue
+ * Outputs: Entries Queued, -1 if the Ring Indices are Invalid
+ */
+int32_t io_submit(uint32_t nr) {
+	pcb_struct_t *pcb = ioring_pcb();
+	uint32_t tail = IORING->sq_tail;
+	uint32_t avail = tail - pcb->io_sq_tail;
+
+	// The Program may not Overwrite Entries the Kernel has not Run
+	if (tail - pcb->io_sq_head > IORING_ENTRIES) {
+		klog(KLOG_ERR, "IORING.IO_SUBMIT: ERR - Submission Ring Overrun \n");
+		return -1;
+	}
+	if (nr > avail) nr = avail;
+	pcb->io_sq_tail += nr;
+	return nr;
+}
+
+/* io_wait()
+ * Run Queued Entries until min_complete Completions are Waiting
+ *
+ * Inputs: min_complete - Completions to Wait for
+ * Outputs: Completions Waiting, which may be Fewer if nothing is
+ *          Queued; -1 if the Ring Indices are Invalid
+ */
+int32_t io_wait(uint32_t min_complete) {
+	pcb_struct_t *pcb = ioring_pcb();
+	uint32_t ready;
+	int32_t ran;
+
+	if (min_complete > IORING_ENTRIES) min_complete = IORING_ENTRIES;
+	while (1) {
+		ready = pcb->io_cq_tail - IORING->cq_head;
+		if (ready > IORING_ENTRIES) {
+			klog(KLOG_ERR, "IORING.IO_WAIT: ERR - Completion Ring Overrun \n");
+			return -1;
+		}
+		if (ready >= min_complete || thread_killed()) return ready;
+		ran = ioring_run(min_complete - ready);
+		if (ran == 0) return ready;
+		// Let the Sibling Running the Queue Finish its Entry
+		if (ran == -1) sleep(1);
+	}
+}
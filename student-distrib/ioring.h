@@ -0,0 +1,65 @@
+/* ioring.h
+ * Asynchronous I/O Submission and Completion Rings
+ */
+
+#ifndef _IORING_H
+#define _IORING_H
+
+#include "types.h"
+
+// The Rings Occupy the Start of every Program's Page, below the Image
+#define IORING_ADDR		0x08000000
+#define IORING_ENTRIES	64
+
+// Operations
+#define IORING_OP_NOP	0
+#define IORING_OP_READ	1
+#define IORING_OP_WRITE	2
+
+// Offset that Uses and Advances the FD's File Position
+#define IORING_OFF_CUR	0xFFFFFFFF
+
+// Requests Run each Time the Program is Interrupted in User Mode
+#define IORING_BATCH	8
+
+/* Submission Queue Entry */
+typedef struct io_sqe_t {
+	uint8_t opcode;
+	uint8_t flags;
+	uint16_t resv;
+	int32_t fd;
+	uint32_t offset;
+	int32_t len;
+	uint32_t buf;
+	// Returned in the Completion
+	uint32_t user_data;
+} io_sqe_t;
+
+/* Completion Queue Entry */
+typedef struct io_cqe_t {
+	uint32_t user_data;
+	// What read() or write() would have Returned
+	int32_t res;
+} io_cqe_t;
+
+/* Ring Page. Indices are Free-Running, Slots are Index % IORING_ENTRIES.
+ * The Program Fills sq[sq_tail] and Advances sq_tail, then Consumes
+ * cq[cq_head] and Advances cq_head. The Kernel Advances the Others. */
+typedef struct io_ring_t {
+	// Written by the Kernel
+	volatile uint32_t sq_head;
+	volatile uint32_t cq_tail;
+	// Written by the Program
+	volatile uint32_t sq_tail;
+	volatile uint32_t cq_head;
+	io_sqe_t sq[IORING_ENTRIES];
+	io_cqe_t cq[IORING_ENTRIES];
+} io_ring_t;
+
+/* Empty the Rings of a Program being Executed */
+void ioring_init(void);
+
+/* Run Queued Requests before Returning to User Mode; cs is the Saved CS */
+void ioring_resume(uint32_t cs);
+
+#endif // _IORING_H
@@ -0,0 +1,19 @@
+/* iovec.h
+ * Segments of a readv() or writev()
+ */
+
+#ifndef _IOVEC_H
+#define _IOVEC_H
+
+#include "types.h"
+
+/* One Segment of a readv() or writev() */
+typedef struct iovec_t {
+	void* base;
+	int32_t len;
+} iovec_t;
+
+// Most Segments in one readv() or writev()
+#define IOV_MAX 16
+
+#endif // _IOVEC_H
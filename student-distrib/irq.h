@@ -17,6 +17,12 @@ void kbd_irq_wrapper();
 // Mouse IRQ Handler Wrapper
 void mouse_irq_wrapper();
 
+// Serial (COM1) IRQ Handler Wrapper
+void serial_irq_wrapper();
+
+// ATA (Primary IDE) IRQ Handler Wrapper
+void ata_irq_wrapper();
+
 // System Call Wrapper
 void syscall_wrapper();
 
@@ -9,6 +9,7 @@
 #include "rtc.h"
 #include "debug.h"
 #include "tests.h"
+#include "bench.h"
 #include "idt.h"
 #include "paging.h"
 #include "rtc.h"
@@ -18,6 +19,12 @@
 #include "pit.h"
 #include "mouse.h"
 #include "malloc.h"
+#include "serial.h"
+#include "timer.h"
+#include "clocksource.h"
+#include "ata.h"
+#include "bcache.h"
+#include "klog.h"
 #define RUN_TESTS
 
 /* Macros. */
@@ -27,8 +34,9 @@
 /* Check if MAGIC is valid and print the Multiboot information structure
    pointed by ADDR. */
 void entry(unsigned long magic, unsigned long addr) {
-    //define the start address of file system
-    unsigned long fs_start_address;
+    //define the start and end address of file system
+    unsigned long fs_start_address = 0;
+    unsigned long fs_end_address = 0;
     multiboot_info_t *mbi;
 
     /* Clear the screen. */
@@ -64,6 +72,7 @@ void entry(unsigned long magic, unsigned long addr) {
         module_t* mod = (module_t*)mbi->mods_addr;
         // Load the Start Address of Module into File System Start Address
         fs_start_address = (uint32_t)mod->mod_start;
+        fs_end_address = (uint32_t)mod->mod_end;
         while (mod_count < mbi->mods_count) {
             ///////////////////////////////////////////////////////
             // printf("Module %d loaded at address: 0x%#x\n", mod_count, (unsigned int)mod->mod_start);
@@ -164,6 +173,11 @@ void entry(unsigned long magic, unsigned long addr) {
 	printf("CTOS: Registering PIC ");
     i8259_init();
 	printf("[PASS] \n");
+
+	/* Initialize the Serial Console */
+	printf("CTOS: Initializing Serial Port ");
+	serial_init();
+	printf("[PASS] \n");
 	
 	/* Initialize Paging */
 	printf("CTOS: Enabling Paging ");
@@ -175,6 +189,21 @@ void entry(unsigned long magic, unsigned long addr) {
 	heap_init();
 	printf("[PASS] \n");
 	
+	/* Initialize Kernel Timers */
+	printf("CTOS: Initializing Timers ");
+	timer_init();
+	printf("[PASS] \n");
+	
+	/* Start the Kernel Log Drain */
+	printf("CTOS: Starting Kernel Log ");
+	klog_init();
+	printf("[PASS] \n");
+	
+	/* Calibrate the TSC */
+	printf("CTOS: Calibrating TSC ");
+	clocksource_init();
+	printf("[PASS] %d kHz \n", tsc_khz());
+	
 	/* Initialize the RTC */
 	printf("CTOS: Initializing RTC ");
 	rtc_init();
@@ -196,10 +225,15 @@ void entry(unsigned long magic, unsigned long addr) {
 	printf("[PASS] \n");
 	
 	
+	/* Initialize the Disk Driver */
+	printf("CTOS: Probing ATA Disks ");
+	ata_init();
+	bcache_init();
+	printf("[PASS] \n");
+	
     /* Initialize the File System */
 	printf("CTOS: Loading File System ");
-    init_file_system(fs_start_address);
-	printf("[PASS] \n");
+    if (0 == init_file_system(fs_start_address, fs_end_address)) printf("[PASS] \n");
 
 	/* Initialize System Calls Function Table */
 	printf("CTOS: Setting up System Calls ");
@@ -211,9 +245,17 @@ void entry(unsigned long magic, unsigned long addr) {
 	
 #ifdef RUN_TESTS
     /* Run tests */
-   // launch_tests();
+    launch_tests();
 #endif
 
+#ifdef RUN_BENCH
+	/* Run Benchmarks, built by "make bench" */
+	launch_benchmarks();
+#endif
+
+	/* Start the Scheduler's Periodic Work */
+	sched_init();
+
 	/* Initialize the PIT */
     printf("CTOS: Initializing PIT ");
     pit_init();
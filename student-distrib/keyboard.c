@@ -7,6 +7,9 @@
 #include "i8259.h"
 #include "syscall.h"
 #include "paging.h"
+#include "tasklet.h"
+#include "trace.h"
+#include "thread.h"
 
 // Current Terminal
 int term = 0;
@@ -18,6 +21,26 @@ int cmd_len[TERM_MAX];
 int cmd_cursor[TERM_MAX];
 // Read Lock on Current Command
 int cmd_readlock[TERM_MAX];
+// Process Blocked in terminal_read() on each Terminal, 0 if None
+static uint32_t cmd_waiter[TERM_MAX];
+// Scancodes Queued by the Top Half for each Terminal
+static kbd_ring_t kbd_ring[TERM_MAX];
+// Set while the Line Discipline is Draining the Rings
+static volatile int kbd_ld_active = 0;
+// ALT Status seen by the Top Half (0 - Released, 1 - Pressed)
+static uint8_t kbd_top_alt = 0;
+// Deferred Line Discipline
+static tasklet_t kbd_tasklet;
+
+/* kbd_ld_tasklet()
+ * Tasklet Entry for the Line Discipline
+ *
+ * Inputs: None Effective
+ * Outputs: None
+ */
+static void kbd_ld_tasklet(uint32_t data) {
+	kbd_line_discipline();
+}
 
 // Standard US QWERTY Keyboard Scancode Mappings
 unsigned char scancode_arr[4][128] = {
@@ -58,8 +81,6 @@ unsigned char scancode_arr[4][128] = {
 uint8_t scancode_type = 0;
 // CTRL Status (0 - Released, 1 - Pressed)
 uint8_t scancode_ctrl = 0;
-// ATL Status (0 - Released, 1 - Pressed)
-uint8_t scancode_alt = 0;
 
 /* kbd_init()
  * Initialize the Keyboard, Enables Keyboard IRQs
@@ -75,11 +96,17 @@ void kbd_init(void) {
 	// Set Terminal to Default
 	term = 0;
 	cmd_flag=0;
-	// Reset all Cursors and Buffers
+	kbd_top_alt = 0;
+	kbd_ld_active = 0;
+	tasklet_init(&kbd_tasklet, kbd_ld_tasklet, 0);
+	// Reset all Cursors, Buffers and Scancode Rings
 	for (i = 0; i < TERM_MAX; i++) {
 		cmd_len[i] = 0;
 		cmd_cursor[i] = 0;
 		cmd_readlock[i] = 1;
+		cmd_waiter[i] = 0;
+		kbd_ring[i].head = 0;
+		kbd_ring[i].tail = 0;
 		for (j = 0; j < CMD_LEN_MAX; j++) {
 			cmd_buf[i][j] = 0;
 		}
@@ -89,8 +116,46 @@ void kbd_init(void) {
 	enable_irq(KBD_IRQ);
 }
 
+/* kbd_ring_push()
+ * Queue a Scancode, dropping it if the Ring is Full.
+ * Only called from the Top Half with Interrupts Disabled.
+ *
+ * Inputs: ring - Ring of the Target Terminal
+ *            c - Scancode
+ * Outputs: None
+ */
+static void kbd_ring_push(kbd_ring_t* ring, uint8_t c) {
+	uint32_t head = ring->head;
+	// Ring Full, Drop the Key
+	if (head - ring->tail >= KBD_RING_SIZE) return;
+	ring->data[head & KBD_RING_MASK] = c;
+	// Publish the Scancode before Advancing Head
+	barrier();
+	ring->head = head + 1;
+}
+
+/* kbd_ring_pop()
+ * Dequeue a Scancode. Only called from the Line Discipline.
+ *
+ * Inputs: ring - Ring to Drain
+ *            c - Where to Store the Scancode
+ * Outputs: 1 if a Scancode was Dequeued, 0 if Empty
+ */
+static int kbd_ring_pop(kbd_ring_t* ring, uint8_t* c) {
+	uint32_t tail = ring->tail;
+	if (tail == ring->head) return 0;
+	*c = ring->data[tail & KBD_RING_MASK];
+	// Consume the Scancode before Releasing the Slot
+	barrier();
+	ring->tail = tail + 1;
+	return 1;
+}
+
 /* kbd_irq_handler()
- * Handler for a Keyboard Interrupt
+ * Top Half of a Keyboard Interrupt. Only routes raw Scancodes into the
+ * Ring of the Foreground Terminal, so the time spent with Interrupts
+ * Disabled does not depend on the Command Length. Editing, Echo and
+ * Shell Launches are done by the kbd_line_discipline() Tasklet.
  *
  * Inputs: None
  * Outputs: None
@@ -102,79 +167,189 @@ void kbd_irq_handler(void) {
 	// Status of Keyboard
 	unsigned char stat = 0x02;
 	
-	// Disable all IRQs while Initializing Keyboard
+	// Disable all IRQs while Reading the Controller
 	cli();
+	trace(TRACE_IRQ, TR_IRQ_ENTER, KBD_IRQ);
 	cmd_flag=1;
 	while (stat & KBD_STAT_MASK) {
 		// Read value from Keyboard Data Register
 		val = inb(KBD_DATA);
-		// Process Character
-		char_handler(val);
+		// Track ALT here so a Terminal Switch routes the following Keys
+		if (val == KEY_LALT_PS) {
+			kbd_top_alt = 1;
+		}
+		else if (val == KEY_LALT_RL) {
+			kbd_top_alt = 0;
+		}
+		else if (val >= KEY_F1 && val <= KEY_F3) {
+			// Function Keys only mean something together with ALT
+			if (kbd_top_alt) {
+				// Switch Active Terminal
+				term = TERM_ZERO + (val - KEY_F1);
+				switch_terminal(term);
+				// Let the Line Discipline Launch the Shell if Needed
+				kbd_ring_push(&kbd_ring[term], val);
+			}
+		}
+		else {
+			kbd_ring_push(&kbd_ring[term], val);
+		}
 		// Read Status Register
 		stat = inb(KBD_STAT);
 	}
 	// Send EOI
 	send_eoi(KBD_IRQ);
 	
+	// Run the Line Discipline after the IRQ Returns
+	tasklet_schedule(&kbd_tasklet);
+	trace(TRACE_IRQ, TR_IRQ_EXIT, KBD_IRQ);
+	
 	// Re-enable all IRQs
 	sti();
 }
 
-/* char_handler()
- * Process an Input Character
+/* kbd_rings_pending()
+ * Check whether any Terminal has Unprocessed Scancodes
  *
  * Inputs: None
+ * Outputs: 1 if Pending, 0 Otherwise
+ */
+static int kbd_rings_pending(void) {
+	int t;
+	for (t = 0; t < TERM_MAX; t++) {
+		if (kbd_ring[t].tail != kbd_ring[t].head) return 1;
+	}
+	return 0;
+}
+
+/* kbd_launch_shell()
+ * Forced Context Switch to a new Shell on Terminal t. The current
+ * Process resumes by returning from this Function once it is
+ * Scheduled again.
+ *
+ * Inputs: t - Terminal to Launch the Shell on
  * Outputs: None
  */
-void char_handler(unsigned char c) {
+static void kbd_launch_shell(int t) {
+	// Forced Context Switch to Shell on Terminal t
+	switch_process(t);
+	printf("CTOS: Launching Shell on Terminal %d \n", t);
+
+	// Save the Base and Stack Pointers
+	pcb_struct_t *current_pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid)));
+	asm volatile(
+	"movl %%esp, %%eax ;"
+	: "=a" (current_pcb->sp)
+	);
+	asm volatile(
+	"movl %%ebp, %%eax ;"
+	: "=a" (current_pcb->bp)
+	);
+	
+	// Launch Shell
+	execute((const uint8_t *) "shell");
+}
+
+/* kbd_line_discipline()
+ * Bottom Half of the Keyboard. Drains the Scancode Rings of every
+ * Terminal and applies them to the Command Lines. Runs with Interrupts
+ * Enabled; a nested Keyboard IRQ that finds it active simply leaves its
+ * Scancodes for the running instance to pick up.
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void kbd_line_discipline(void) {
+	uint32_t flags;
+	uint8_t c;
+	int t;
+
+	while (1) {
+		// Claim the Line Discipline unless someone else is Draining
+		cli_and_save(flags);
+		if (kbd_ld_active || !kbd_rings_pending()) {
+			restore_flags(flags);
+			return;
+		}
+		kbd_ld_active = 1;
+		restore_flags(flags);
+
+		for (t = 0; t < TERM_MAX; t++) {
+			while (kbd_ring_pop(&kbd_ring[t], &c)) {
+				// ALT + Function Key: Launch this Terminal on first Use
+				if (c >= KEY_F1 && c <= KEY_F3) {
+					if ((term_process[t] == TERMINAL_EMPTY) && (t == get_terminal())) {
+						// Never returns until this Process is Scheduled again
+						kbd_ld_active = 0;
+						kbd_launch_shell(t);
+						return;
+					}
+					continue;
+				}
+				char_handler(c, t);
+			}
+		}
+
+		// Loop to catch Scancodes Queued while we were Finishing
+		kbd_ld_active = 0;
+	}
+}
+
+/* char_handler()
+ * Process an Input Scancode for a Terminal's Command Line. Only the
+ * part of the Line that changed is Echoed.
+ *
+ * Inputs: c - Scancode
+ *         t - Terminal the Scancode was Typed on
+ * Outputs: None
+ */
+void char_handler(unsigned char c, int t) {
 	
 	// Enter is Pressed
 	if (c == KEY_ENTER) {
-		// Print Command Buffer
-		putcmdend(cmd_buf[term], cmd_len[term]);
+		// Finish the Command Echo
+		putcmdend(cmd_buf[t], cmd_len[t], t);
 		// Unlock the Command Buffer
-		cmd_readlock[term] = 0;
+		cmd_readlock[t] = 0;
+		// Wake the Reader
+		if (cmd_waiter[t] != 0) process_wake_interactive(cmd_waiter[t]);
 	}
 
 	// Backspace is Pressed
 	else if (c == KEY_BACKSPACE) {
-		if (cmd_cursor[term] > 0) {
+		if (cmd_cursor[t] > 0) {
 			// Shift Command Buffer Left
-			int i;
-			for (i = cmd_cursor[term] - 1; i < cmd_len[term]; i++) {
-				cmd_buf[term][i] = cmd_buf[term][i + 1];
-			}
+			memmove(&cmd_buf[t][cmd_cursor[t] - 1], &cmd_buf[t][cmd_cursor[t]], cmd_len[t] - cmd_cursor[t]);
 			// Move Cursor Left and Decrease Length 
-			cmd_cursor[term]--;
-			cmd_len[term]--;
-			// Print the Current Command Buffer
-			putcmd(cmd_buf[term], cmd_len[term]);
+			cmd_cursor[t]--;
+			cmd_len[t]--;
+			cmd_buf[t][cmd_len[t]] = 0;
+			// Echo from the Cursor onwards
+			putcmd(cmd_buf[t], cmd_cursor[t], cmd_len[t], t);
 		}
 	}
 	// Delete is Pressed
 	else if (c == KEY_DEL) {
-		if (cmd_len[term] > cmd_cursor[term]) {
+		if (cmd_len[t] > cmd_cursor[t]) {
 			// Shift Command Buffer Left
-			int i;
-			for (i = cmd_cursor[term]; i < cmd_len[term]; i++) {
-				cmd_buf[term][i] = cmd_buf[term][i + 1];
-			}
+			memmove(&cmd_buf[t][cmd_cursor[t]], &cmd_buf[t][cmd_cursor[t] + 1], cmd_len[t] - cmd_cursor[t] - 1);
 			// Decrease Length 
-			cmd_len[term]--;
-			// Print the Current Command Buffer
-			putcmd(cmd_buf[term], cmd_len[term]);
+			cmd_len[t]--;
+			cmd_buf[t][cmd_len[t]] = 0;
+			// Echo from the Cursor onwards
+			putcmd(cmd_buf[t], cmd_cursor[t], cmd_len[t], t);
 		}
 	}
 	// Left Arrow is Pressed
 	else if (c == KEY_LARROW) {
-		if (cmd_cursor[term] > 0) {
-			cmd_cursor[term]--;
+		if (cmd_cursor[t] > 0) {
+			cmd_cursor[t]--;
 		}
 	}
 	// Right Arrow is Pressed
 	else if (c == KEY_RARROW) {
-		if (cmd_cursor[term] < cmd_len[term]) {
-			cmd_cursor[term]++;
+		if (cmd_cursor[t] < cmd_len[t]) {
+			cmd_cursor[t]++;
 		}
 	}
 	// Caps Lock is Pressed
@@ -198,88 +373,6 @@ void char_handler(unsigned char c) {
 	else if (c == KEY_LSHIFT_RL || c == KEY_RSHIFT_RL) {
 		scancode_type -= 1;
 	}
-	// Left Alt is Pressed
-	else if (c == KEY_LALT_PS) {
-		scancode_alt = 1;
-	}
-	// Left Alt is Released
-	else if (c == KEY_LALT_RL) {
-		scancode_alt = 0;
-	}
-	// F1 is Pressed
-	else if (c == KEY_F1 && scancode_alt) {
-		// Switch Active Terminal
-		term = TERM_ZERO;
-		switch_terminal(term);
-		
-	}
-	// F2 is Pressed
-	else if (c == KEY_F2 && scancode_alt) {
-		// Switch Active Terminal
-		term = TERM_ONE;
-		switch_terminal(term);
-		
-		// Launch this Terminal on first Use
-		if(term_process[term] == TERMINAL_EMPTY){
-			
-			// Forced Context Switch to Shell on Terminal 1
-			switch_process(term);
-			printf("CTOS: Launching Shell on Terminal 1 \n");
-
-			// Save the Base and Stack Pointers
-			pcb_struct_t *current_pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid)));
-			asm volatile(
-			"movl %%esp, %%eax ;"
-			: "=a" (current_pcb->sp)
-			);
-			asm volatile(
-			"movl %%ebp, %%eax ;"
-			: "=a" (current_pcb->bp)
-			);
-			
-			// Send EOI
-			send_eoi(KBD_IRQ);
-			// Re-Enable Interrupts
-			sti();
-			// Launch Shell
-			execute((const uint8_t *) "shell");
-		}
-		
-	}
-	// F3 is Pressed
-	else if (c == KEY_F3 && scancode_alt) {
-		// Switch Active Terminal
-		term = TERM_TWO;
-		switch_terminal(term);
-		
-		// Launch this Terminal on first Use
-		if(term_process[term] == TERMINAL_EMPTY){
-			
-			// Forced Context Switch to Shell on Terminal 2
-			switch_process(term);
-			printf("CTOS: Launching Shell on Terminal 2 \n");
-
-			// Save the Base and Stack Pointers
-			pcb_struct_t *current_pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid)));
-			asm volatile(
-			"movl %%esp, %%eax ;"
-			: "=a" (current_pcb->sp)
-			);
-	
-			asm volatile(
-			"movl %%ebp, %%eax ;"
-			: "=a" (current_pcb->bp)
-			);
-			
-			// Send EOI
-			send_eoi(KBD_IRQ);
-			// Re-Enable Interrupts
-			sti();
-			// Launch Shell
-			execute((const uint8_t *) "shell");
-		}
-		
-	}
 	// 'L' and CTRL is Pressed
 	else if (c == KEY_L && scancode_ctrl) {
 		clear();
@@ -287,21 +380,18 @@ void char_handler(unsigned char c) {
 	else {
 		char ascii_chr;
 		// Check that Key is a Press and not Release
-		if ((c < KEY_RELEASE_BOUND) && (scancode_arr[scancode_type][c] != 0) && (cmd_len[term] < (CMD_LEN_MAX))) {
-			int i;
+		if ((c < KEY_RELEASE_BOUND) && (scancode_arr[scancode_type][c] != 0) && (cmd_len[t] < (CMD_LEN_MAX))) {
 			// Convert Scancode to ASCII
 			ascii_chr = scancode_arr[scancode_type][c];
-			// Set Command Buffer
-			for (i = cmd_len[term]; i > cmd_cursor[term]; i--) {
-				cmd_buf[term][i] = cmd_buf[term][i - 1];
-			}
-			cmd_buf[term][cmd_cursor[term]] = ascii_chr;
+			// Make Room at the Cursor
+			memmove(&cmd_buf[t][cmd_cursor[t] + 1], &cmd_buf[t][cmd_cursor[t]], cmd_len[t] - cmd_cursor[t]);
+			cmd_buf[t][cmd_cursor[t]] = ascii_chr;
 			// Increment the Cursor
-			cmd_cursor[term]++;
+			cmd_cursor[t]++;
 			// Increment the Length
-			cmd_len[term]++;
-			// Print the Current Command Buffer
-			putcmd(cmd_buf[term], cmd_len[term]);
+			cmd_len[t]++;
+			// Echo from the Inserted Character onwards
+			putcmd(cmd_buf[t], cmd_cursor[t] - 1, cmd_len[t], t);
 		}
 	}
 }
@@ -323,7 +413,7 @@ int terminal_open(const uint8_t* filename) {
  * Inputs: None
  * Outputs: 0
  */
-int terminal_close(void) {
+int terminal_close(unsigned int inode) {
 	
 	return 0;
 }
@@ -333,13 +423,14 @@ int terminal_close(void) {
  *
  * Inputs: buf - Pointer to Char Buffer
  *		   size - Number of Bytes
- * Outputs: Number of Bytes read
+ * Outputs: Number of Bytes read, -1 if a Sibling Thread Halts the Program
  */
 int terminal_read(unsigned int inode, unsigned int offset, void* buffer, int32_t size) {
 	
 	int i;
 	int bytes_read = 0;
 	int term_loc = get_process();
+	uint32_t flags;
 	cmd_readlock[term_loc] = 1;
 	unsigned char* buf = (unsigned char*) buffer;
 	
@@ -355,8 +446,19 @@ int terminal_read(unsigned int inode, unsigned int offset, void* buffer, int32_t
 		size = CMD_LEN_MAX;
 	}
 	
-	// Wait for Command to be ready
-	while (cmd_readlock[term_loc]);
+	// Block until Enter Unlocks the Command
+	cli_and_save(flags);
+	while (cmd_readlock[term_loc] && !thread_killed()) {
+		cmd_waiter[term_loc] = current_pid;
+		process_sleep();
+	}
+	cmd_waiter[term_loc] = 0;
+	// Woken because a Sibling Thread is Halting the Program
+	if (cmd_readlock[term_loc]) {
+		restore_flags(flags);
+		return -1;
+	}
+	restore_flags(flags);
 	
 	// Read from Command Buffer
 	for (i = 0; i < size; i++) {
@@ -374,7 +476,7 @@ int terminal_read(unsigned int inode, unsigned int offset, void* buffer, int32_t
 	cmd_readlock[term_loc] = 1;
 	
 	// Move to Next Line
-	putc_term('\n', term);
+	putc_term('\n', term_loc);
 
 	return bytes_read;
 }
@@ -386,7 +488,7 @@ int terminal_read(unsigned int inode, unsigned int offset, void* buffer, int32_t
  *		   size - Number of Bytes
  * Outputs: Number of Bytes written
  */
-int terminal_write(const void* buffer, int32_t size) {
+int terminal_write(unsigned int inode, const void* buffer, int32_t size) {
 	
 	int i;
 	int bytes_written = 0;
@@ -415,7 +517,7 @@ int terminal_read_invalid(unsigned int inode, unsigned int offset, void* buffer,
 }
 
 /* Invalid Write Function for STDIN */
-int terminal_write_invalid(const void* buffer, int32_t size) {
+int terminal_write_invalid(unsigned int inode, const void* buffer, int32_t size) {
 	
 	printf("TERMINAL.STDIN: ERR - Invalid Call to Write Function \n");
 	return -1;
@@ -24,6 +24,10 @@
 // Command Buffer Maximum Length
 #define CMD_LEN_MAX	256
 
+// Scancode Ring Size per Terminal (must be a Power of 2)
+#define KBD_RING_SIZE	64
+#define KBD_RING_MASK	(KBD_RING_SIZE - 1)
+
 //the index of the first terminal
 #define TERM_ZERO	0
 
@@ -57,6 +61,20 @@
 #define KEY_LARROW		0x4B
 #define KEY_RARROW		0x4D
 
+/* Scancode Ring
+ * Single-producer/single-consumer queue. The IRQ top half is the only
+ * writer of head and the line discipline is the only writer of tail,
+ * so neither side needs a lock.
+ */
+typedef struct kbd_ring_t {
+	// Next Slot to be Filled (Top Half)
+	volatile uint32_t head;
+	// Next Slot to be Consumed (Line Discipline)
+	volatile uint32_t tail;
+	// Raw Scancodes
+	uint8_t data[KBD_RING_SIZE];
+} kbd_ring_t;
+
 /* Functions */
 
 // Initialize the Keyboard
@@ -65,25 +83,28 @@ void kbd_init(void);
 // Handler for a Keyboard Interrupt
 void kbd_irq_handler(void);
 
-// Process a Character Input
-void char_handler(unsigned char c);
+// Drain the Scancode Rings and Edit/Echo the Command Lines
+void kbd_line_discipline(void);
+
+// Process a Character Input for a Terminal
+void char_handler(unsigned char c, int t);
 
 // Open Terminal
 int terminal_open(const uint8_t* filename);
 
 // Close Terminal
-int terminal_close(void);
+int terminal_close(unsigned int inode);
 
 // Read from Command Buffer
 int terminal_read(unsigned int inode, unsigned int offset, void* buffer, int32_t size);
 
 // Display write buffer on Terminal
-int terminal_write(const void* buffer, int32_t size);
+int terminal_write(unsigned int inode, const void* buffer, int32_t size);
 
 // Invalid Read Function for STDOUT
 int terminal_read_invalid(unsigned int inode, unsigned int offset, void* buffer, int32_t size);
 
 // Invalid Write Function for STDIN
-int terminal_write_invalid(const void* buffer, int32_t size);
+int terminal_write_invalid(unsigned int inode, const void* buffer, int32_t size);
 
 #endif
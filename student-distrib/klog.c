@@ -0,0 +1,144 @@
+/* klog.c
+ * Leveled Kernel Log
+ *
+ * klog() reserves a ring slot with one locked xadd, so an IRQ handler
+ * that logs in the middle of a system call's record simply takes the
+ * next slot; nothing disables interrupts. A record is published by
+ * storing its seq last. The klogd kernel thread, at the lowest MLFQ
+ * level, prints the records and re-checks seq after copying each one,
+ * so a record overwritten meanwhile is counted as lost instead of
+ * printed half old, half new.
+ */
+
+#include "klog.h"
+#include "lib.h"
+#include "syscall.h"
+#include "kthread.h"
+
+// The Ring and the Total Number of Slots Reserved
+static klog_rec_t klog_ring[KLOG_RING_SIZE];
+static volatile uint32_t klog_head = 0;
+// Total Number of Records Printed or Lost
+static uint32_t klog_tail = 0;
+static uint32_t klog_lost = 0;
+
+// PID of klogd, 0 until it is Started
+static uint32_t klogd_pid = 0;
+
+// Names Printed before each Record
+static const char* klog_level_name[] = {"ERR", "WARN", "INFO", "DEBUG"};
+
+// Compiler Barrier, Keeps seq Ordered against the Record Body
+#define klog_barrier()	asm volatile ("" : : : "memory")
+
+/* klog_drain()
+ * Print up to KLOG_DRAIN_BATCH Records
+ *
+ * Inputs: None
+ * Outputs: Records Printed or Skipped as Lost, 0 if the Oldest is still
+ *          being Written
+ */
+static uint32_t klog_drain(void) {
+	klog_rec_t r;
+	uint32_t n, head;
+
+	for (n = 0; n < KLOG_DRAIN_BATCH; n++) {
+		head = klog_head;
+		// The Writers Lapped the Drain, Skip to the Oldest Slot Left
+		if (head - klog_tail > KLOG_RING_SIZE) {
+			klog_lost += head - klog_tail - KLOG_RING_SIZE;
+			klog_tail = head - KLOG_RING_SIZE;
+		}
+		if (klog_tail == head) break;
+
+		// Stop at a Record still being Written
+		r = klog_ring[klog_tail & KLOG_RING_MASK];
+		klog_barrier();
+		if (r.seq != klog_tail + 1) {
+			if (klog_head - klog_tail <= KLOG_RING_SIZE) break;
+			continue;
+		}
+		// Overwritten while Copied, Counted as Lost by the next Pass
+		if (klog_ring[klog_tail & KLOG_RING_MASK].seq != r.seq) continue;
+		klog_tail++;
+
+		if (klog_lost) {
+			printf("KLOG: WARN - %d Records Lost \n", klog_lost);
+			klog_lost = 0;
+		}
+		printf("<%s> [%d] ", (int8_t*) klog_level_name[r.level], r.pid);
+		printf((int8_t*) r.fmt, r.arg[0], r.arg[1], r.arg[2], r.arg[3]);
+		if (r.missed) printf("KLOG: INFO - %d more like the above Suppressed \n", r.missed);
+	}
+	return n;
+}
+
+/* klogd()
+ * Kernel Thread that Drains the Ring, Sleeping while it is Empty
+ *
+ * Inputs: None Effective
+ * Outputs: None
+ */
+static void klogd(uint32_t data) {
+	uint32_t flags;
+
+	// Only Run when nothing more Urgent is Runnable
+	nice(NICE_MAX);
+	while (1) {
+		// A Writer was Preempted inside klog_record(), let it Finish
+		if (klog_drain() == 0 && klog_tail != klog_head) sleep(1);
+
+		cli_and_save(flags);
+		while (klog_tail == klog_head) process_sleep();
+		restore_flags(flags);
+	}
+}
+
+/* klog_init()
+ * Start klogd. Records Logged before the Scheduler Runs are Kept and
+ * Printed once it does.
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void klog_init(void) {
+	int32_t pid = kthread_create(klogd, 0, "klogd");
+	if (pid != -1) klogd_pid = pid;
+}
+
+/* klog_record()
+ * Append a Record to the Ring and Wake klogd. Called by klog()
+ * once the Call Site has passed its Rate Limit.
+ *
+ * Inputs: site - Call Site, its Suppressed Count is Moved to the Record
+ *        level - KLOG_ERR .. KLOG_DEBUG
+ *          fmt - printf() Format, Expanded when Drained
+ *   a0 .. a3 - Arguments
+ * Outputs: None
+ */
+void klog_record(klog_site_t* site, uint32_t level, const char* fmt,
+		uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3) {
+	uint32_t pos = 1;
+	klog_rec_t* r;
+
+	// Reserve a Slot, Atomic against IRQs that also Log
+	asm volatile ("lock; xaddl %0, %1" : "+r" (pos), "+m" (klog_head) : : "memory");
+	r = &klog_ring[pos & KLOG_RING_MASK];
+
+	r->seq = 0;
+	klog_barrier();
+	r->level = level;
+	r->pid = current_pid;
+	r->missed = site->missed;
+	site->missed = 0;
+	r->fmt = fmt;
+	r->arg[0] = a0;
+	r->arg[1] = a1;
+	r->arg[2] = a2;
+	r->arg[3] = a3;
+	klog_barrier();
+	r->seq = pos + 1;
+
+	if (klogd_pid != 0 && process_list[klogd_pid] == PROCESS_SLEEPING)
+		process_wake(klogd_pid);
+}
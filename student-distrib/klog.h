@@ -0,0 +1,95 @@
+/* klog.h
+ * Leveled Kernel Log
+ */
+
+#ifndef _KLOG_H
+#define _KLOG_H
+
+#include "types.h"
+#include "timer.h"
+
+/* Levels, Most Severe first. Levels above KLOG_LEVEL (e.g. "make
+ * KLOG_LEVEL=3") compile to Nothing. */
+#define KLOG_ERR		0
+#define KLOG_WARN		1
+#define KLOG_INFO		2
+#define KLOG_DEBUG		3
+#ifndef KLOG_LEVEL
+#define KLOG_LEVEL		KLOG_INFO
+#endif
+
+/* Ring Size in Records, a Power of 2 */
+#define KLOG_RING_SIZE	256
+#define KLOG_RING_MASK	(KLOG_RING_SIZE - 1)
+/* Arguments Kept per Record */
+#define KLOG_ARGS		4
+/* Records Printed per Pass of klogd */
+#define KLOG_DRAIN_BATCH	16
+
+/* Rate Limit: each Call Site Logs at most KLOG_BURST Records per
+ * KLOG_INTERVAL Milliseconds */
+#define KLOG_BURST		5
+#define KLOG_INTERVAL	1000
+
+/* Log Record
+ * The Format is only Expanded when the Record is Drained, so %s
+ * Arguments must outlive the Call (string literals, kernel tables).
+ */
+typedef struct klog_rec_t {
+	// Ring Position + 1 once the Record is Complete, 0 while Written
+	volatile uint32_t seq;
+	uint16_t level;
+	// Task that Logged it, Printed before the Message
+	uint16_t pid;
+	// Records this Call Site Dropped just before this one
+	uint32_t missed;
+	const char* fmt;
+	uint32_t arg[KLOG_ARGS];
+} klog_rec_t;
+
+/* Per Call Site Rate Limit State */
+typedef struct klog_site_t {
+	uint32_t start;
+	uint32_t count;
+	uint32_t missed;
+} klog_site_t;
+
+/* klog_allow()
+ * Rate Limit a Call Site, returns 1 if it may Log now
+ */
+static inline int32_t klog_allow(klog_site_t* site) {
+	if (jiffies - site->start >= KLOG_INTERVAL) {
+		site->start = jiffies;
+		site->count = 0;
+	}
+	if (site->count >= KLOG_BURST) {
+		site->missed++;
+		return 0;
+	}
+	site->count++;
+	return 1;
+}
+
+/* Start Draining the Ring */
+void klog_init(void);
+
+/* Append a Record */
+void klog_record(klog_site_t* site, uint32_t level, const char* fmt,
+		uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/* Helpers to pad the Argument List to KLOG_ARGS */
+#define KLOG_PAD(fmt, a0, a1, a2, a3, ...)	(fmt), (uint32_t) (a0), (uint32_t) (a1), (uint32_t) (a2), (uint32_t) (a3)
+
+/* klog()
+ * Log a Message with at most KLOG_ARGS 32-bit Arguments. Costs an
+ * Inlined Rate Check and a few Stores; the Console is Written later by
+ * klogd.
+ */
+#define klog(level, ...)									\
+do {														\
+	static klog_site_t klog_site_;							\
+	if ((level) <= KLOG_LEVEL && klog_allow(&klog_site_))	\
+		klog_record(&klog_site_, (level), KLOG_PAD(__VA_ARGS__, 0, 0, 0, 0));	\
+} while (0)
+
+#endif // _KLOG_H
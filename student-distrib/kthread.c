@@ -0,0 +1,120 @@
+/* kthread.c
+ * Kernel Threads
+ *
+ * A kernel thread is a PCB in one of the KTHREAD_MAX slots after the
+ * user processes, with the 8KB kernel stack that comes with the slot
+ * and no user page. The scheduler runs it from the same process_list
+ * as user programs; context_switch() leaves the outgoing process' user
+ * mapping in place when it switches to one. Threads block with sleep()
+ * or process_sleep() like a process inside a system call.
+ */
+
+#include "kthread.h"
+#include "lib.h"
+#include "syscall.h"
+#include "pit.h"
+#include "stats.h"
+
+/* kthread_entry()
+ * First Code a new Thread Runs, reached by the "leave; ret" at the end
+ * of context_switch() from the Frame kthread_create() Built. The PIT
+ * Handler that Switched here never Returns on this Stack, so Interrupts
+ * are Enabled here instead of by its iret.
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+static void kthread_entry(void) {
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * current_pid));
+	sti();
+	pcb->kthread_fn(pcb->kthread_arg);
+	kthread_exit();
+}
+
+/* kthread_frame()
+ * Build the first Frame of a new Task so that the "leave; ret" at the
+ * End of context_switch() Enters kthread_entry(), which Calls fn(arg).
+ * The Slot must not be the Running one.
+ *
+ * Inputs: pid - Slot of the new Task
+ *          fn - Function it Starts in
+ *         arg - Argument passed to fn
+ * Outputs: None
+ */
+void kthread_frame(uint32_t pid, void (*fn)(uint32_t arg), uint32_t arg) {
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * pid));
+	uint32_t *top = (uint32_t *) (M_8MB - M_8KB * pid);
+
+	pcb->kthread_fn = fn;
+	pcb->kthread_arg = arg;
+	// Saved EBP, then the Return Address, then a Null Return for it
+	top[-1] = 0;
+	top[-2] = (uint32_t) kthread_entry;
+	top[-3] = 0;
+	pcb->bp = (uint32_t) &top[-3];
+	pcb->sp = pcb->bp;
+}
+
+/* kthread_create()
+ * Start a Kernel Thread. It becomes Runnable at once at the Top MLFQ
+ * Level; a Background Thread may lower itself with nice().
+ *
+ * Inputs:   fn - Thread Function
+ *          arg - Argument passed to fn
+ *         name - Name shown by top, Truncated to STAT_NAME_LEN - 1
+ * Outputs: PID of the Thread, -1 if every Kernel Thread Slot is Taken
+ */
+int32_t kthread_create(void (*fn)(uint32_t arg), uint32_t arg, const char* name) {
+	uint32_t flags, pid, len;
+	pcb_struct_t *pcb;
+
+	cli_and_save(flags);
+	// A Thread that just Exited may still be Running on its Stack
+	for (pid = MAX_PROCESS_NUM; pid < MAX_TASK_NUM; pid++) {
+		if (process_list[pid] == 0 && pid != current_pid) break;
+	}
+	if (pid == MAX_TASK_NUM) {
+		restore_flags(flags);
+		printf("KTHREAD.KTHREAD_CREATE: ERR - No Slot for %s \n", name);
+		return -1;
+	}
+
+	pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * pid));
+	memset(pcb, 0, sizeof(pcb_struct_t));
+	pcb->state = 1;
+	pcb->pid = pid;
+	pcb->term = get_process();
+	len = strlen((int8_t*) name);
+	if (len > STAT_NAME_LEN - 1) len = STAT_NAME_LEN - 1;
+	memcpy(pcb->name, name, len);
+	pcb->tgid = pid;
+	timer_setup(&pcb->sleep_timer, process_wake, pid);
+	kthread_frame(pid, fn, arg);
+
+	process_list[pid] = 1;
+	restore_flags(flags);
+	// One more Runnable Task, the current Slice may need an End
+	pit_rearm();
+	return pid;
+}
+
+/* kthread_exit()
+ * Free the Running Thread's Slot. The Scheduler never Picks it again,
+ * so the Thread Idles until the PIT Switches away for good.
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void kthread_exit(void) {
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * current_pid));
+
+	cli();
+	timer_del(&pcb->sleep_timer);
+	pcb->state = 0;
+	process_list[current_pid] = 0;
+	pit_rearm();
+	while (1) {
+		acct_idle();
+		asm volatile("sti; hlt; cli" : : : "memory");
+	}
+}
@@ -0,0 +1,19 @@
+/* kthread.h
+ * Kernel Threads
+ */
+
+#ifndef _KTHREAD_H
+#define _KTHREAD_H
+
+#include "types.h"
+
+/* Start fn(arg) on its own Kernel Stack, returns its PID or -1 */
+int32_t kthread_create(void (*fn)(uint32_t arg), uint32_t arg, const char* name);
+
+/* Set up a new Task's Stack so it Starts in fn(arg) when Switched to */
+void kthread_frame(uint32_t pid, void (*fn)(uint32_t arg), uint32_t arg);
+
+/* End the Running Kernel Thread, also Reached when fn Returns */
+void kthread_exit(void);
+
+#endif // _KTHREAD_H
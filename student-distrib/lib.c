@@ -3,6 +3,9 @@
  */
 
 #include "lib.h"
+#include "serial.h"
+#include "timer.h"
+#include "tasklet.h"
 
 // Terminal Buffer Addresses (4KB Aligned)
 #define TERM0 0x2000
@@ -20,6 +23,8 @@ static char* video_mem = (char*) VIDEO;
 
 // Highest Achieved Length of Current Command Buffer
 static int cmd_len_rec[TERM_MAX] = {0};
+// Length of the Command Buffer as last Echoed on Screen
+static int cmd_len_shown[TERM_MAX] = {0};
 
 // Current Terminal Index (0 - TERM_MAX)
 static int a_term = 0;
@@ -36,6 +41,33 @@ static char* term_buf[TERM_MAX] = {(char*) TERM0, (char*) TERM1, (char*) TERM2};
 // Offset of each terminal in rows
 static int32_t term_offset[TERM_MAX]={125,125,125};
 
+// Period of the Screen Refresh in Jiffies (~64 Hz)
+#define TERM_REFRESH_MS	16
+// Periodic Screen Refresh
+static ktimer_t term_refresh_timer;
+static tasklet_t term_refresh_tasklet;
+
+/* term_refresh()
+ * Tasklet that Copies the Active Terminal to Video Memory
+ *
+ * Inputs: None Effective
+ * Outputs: None
+ */
+static void term_refresh(uint32_t data) {
+	display_terminal();
+}
+
+/* term_refresh_tick()
+ * Refresh Timer Callback, queues the Refresh and re-arms itself
+ *
+ * Inputs: None Effective
+ * Outputs: None
+ */
+static void term_refresh_tick(uint32_t data) {
+	tasklet_schedule(&term_refresh_tasklet);
+	timer_add(&term_refresh_timer, term_refresh_timer.expires + TERM_REFRESH_MS);
+}
+
 
 /* void terminal_init()
  * Inputs: none
@@ -50,6 +82,10 @@ void terminal_init(){
 			*(uint8_t *)(term_buf[i] + (j << 1) + 1) = ATTRIB;
 		}
 	}
+	// Start the Periodic Screen Refresh
+	tasklet_init(&term_refresh_tasklet, term_refresh, 0);
+	timer_setup(&term_refresh_timer, term_refresh_tick, 0);
+	timer_add(&term_refresh_timer, jiffies + TERM_REFRESH_MS);
 }
 
 /* void clear(void);
@@ -244,6 +280,8 @@ int32_t puts_term(int8_t* s, int term) {
  * Return Value: void
  * Function: Output a character to the console */
 void putc(uint8_t c) {
+	// Mirror Console Output to COM1
+	if (SERIAL_CONSOLE) serial_putc(c);
     if(c == '\n' || c == '\r') {
 		// Check if we are in Last Line
 		if (term_y[p_term] >= NUM_ROWS - 1) {
@@ -369,62 +407,67 @@ void scrollup_term(int term) {
 }
 
 /* putcmd()
- * Print the Command Buffer on Screen but do not move the cursor
+ * Echo the Command Buffer from Index "from" onwards but do not move the
+ * cursor. Only the changed tail is redrawn, so appending a character
+ * costs a single cell write regardless of the command length.
  *
- * Inputs: buf - Command Buffer
- *         len - Command Length
+ * Inputs:  buf - Command Buffer
+ *         from - First Index that Changed
+ *          len - Command Length
+ *         term - Terminal the Command belongs to
  * Outputs: None
  */
-void putcmd(char* buf, int len) {
+void putcmd(char* buf, int from, int len, int term) {
 	// Local Variables
+	int x; int y; int i; int num_nl; int pos;
 	if(cmd_flag){
-		term_offset[a_term]=125;
+		term_offset[term]=125;
 		cmd_flag=0;
 	}
-	int x; int y; int i; int num_nl;
 	// Save Screen Cursor
-	x = term_x[a_term];
-	y = term_y[a_term];
+	x = term_x[term];
+	y = term_y[term];
 	// Enable Length Tracker
-	if (len > cmd_len_rec[a_term]) cmd_len_rec[a_term] = len;
+	if (len > cmd_len_rec[term]) cmd_len_rec[term] = len;
 	// Calculate Number of Lines Command Will Take
-	num_nl = (cmd_len_rec[a_term] + x) / NUM_COLS;
+	num_nl = (cmd_len_rec[term] + x) / NUM_COLS;
 	// Calculate Number of New Lines that will be Created by this Command
 	if (num_nl + y > NUM_ROWS - 1) num_nl = (num_nl + y) - (NUM_ROWS - 1);
 	else num_nl = 0;
-	// Print the command buffer
-	for (i = 0; i < len; i++) putc_term(buf[i], a_term);
-	for (i = len; i < cmd_len_rec[a_term]; i++) putc_term(' ', a_term);	
+	// Jump to the first Changed Cell
+	pos = x + from;
+	term_x[term] = pos % NUM_COLS;
+	term_y[term] = y + pos / NUM_COLS;
+	// Print the changed tail and blank out what the last Echo left behind
+	for (i = from; i < len; i++) putc_term(buf[i], term);
+	for (i = len; i < cmd_len_shown[term]; i++) putc_term(' ', term);
+	cmd_len_shown[term] = len;
 	// Restore Screen Cursor
-	term_x[a_term] = x;
-	term_y[a_term] = y - num_nl;
+	term_x[term] = x;
+	term_y[term] = y - num_nl;
 }
 
 /* putcmdend()
- * Print the Command Buffer on Screen and move the cursor
+ * Finish the Command Echo and move the cursor past it. The command is
+ * already on screen, so only the stale tail is cleared.
  *
- * Inputs: buf - Command Buffer
- *         len - Command Length
+ * Inputs:  buf - Command Buffer
+ *          len - Command Length
+ *         term - Terminal the Command belongs to
  * Outputs: None
  */
-void putcmdend(char* buf, int len) {
+void putcmdend(char* buf, int len, int term) {
 	// Local Variables
-	int x; int y; int i; int num_nl;
-	// Save Screen Cursor
-	x = term_x[a_term];
-	y = term_y[a_term];
-	// Enable Length Tracker
-	if (len > cmd_len_rec[a_term]) cmd_len_rec[a_term] = len;
-	// Calculate Number of Lines Command Will Take
-	num_nl = (cmd_len_rec[a_term] + x) / NUM_COLS;
-	// Calculate Number of New Lines that will be Created by this Command
-	if (num_nl + y > NUM_ROWS - 1) num_nl = (num_nl + y) - (NUM_ROWS - 1);
-	else num_nl = 0;
-	// Print the command buffer
-	for (i = 0; i < len; i++) putc_term(buf[i], a_term);
-	for (i = len; i < cmd_len_rec[a_term]; i++) putc_term(' ', a_term);	
-	// Reset Length Tracker
-	cmd_len_rec[a_term] = 0;
+	int pos;
+	// Bring the Screen up to date with the final Buffer
+	putcmd(buf, len, len, term);
+	// Move the Cursor to the End of the Command
+	pos = term_x[term] + len;
+	term_x[term] = pos % NUM_COLS;
+	term_y[term] = term_y[term] + pos / NUM_COLS;
+	// Reset Length Trackers
+	cmd_len_rec[term] = 0;
+	cmd_len_shown[term] = 0;
 }
 
 /* switch_process()
@@ -826,6 +869,29 @@ int8_t* strncpy(int8_t* dest, const int8_t* src, uint32_t n) {
     return dest;
 }
 
+/* uint32_t div64_32(uint64_t* n, uint32_t base)
+ * Inputs: uint64_t* n = dividend, replaced by the quotient
+ *         uint32_t base = divisor
+ * Return Value: remainder
+ * Function: divide a 64-bit value by a 32-bit one using two divl, as
+ *           there is no libgcc to provide 64-bit division */
+uint32_t div64_32(uint64_t* n, uint32_t base) {
+    uint32_t hi = (uint32_t) (*n >> 32);
+    uint32_t lo = (uint32_t) *n;
+    uint32_t q_hi = 0;
+    uint32_t rem;
+    // Divide the High Word first so the divl below cannot overflow
+    if (hi >= base) {
+        q_hi = hi / base;
+        hi = hi % base;
+    }
+    asm volatile("divl %2"
+        : "=a" (lo), "=d" (rem)
+        : "rm" (base), "0" (lo), "1" (hi));
+    *n = ((uint64_t) q_hi << 32) | lo;
+    return rem;
+}
+
 /* void test_interrupts(void)
  * Inputs: void
  * Return Value: void
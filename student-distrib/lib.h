@@ -20,8 +20,8 @@ void clearall(void);
 void scrollup(void);
 void scrollup_term(int term);
 void setcursor(uint8_t x, uint8_t y);
-void putcmd(char* buf, int len);
-void putcmdend(char* buf, int len);
+void putcmd(char* buf, int from, int len, int term);
+void putcmdend(char* buf, int len, int term);
 void switch_process(int new_p_term);
 void switch_terminal(int new_a_term);
 int get_process();
@@ -38,6 +38,9 @@ int32_t strncmp(const int8_t* s1, const int8_t* s2, uint32_t n);
 int8_t* strcpy(int8_t* dest, const int8_t*src);
 int8_t* strncpy(int8_t* dest, const int8_t*src, uint32_t n);
 
+/* 64-bit Division without libgcc */
+uint32_t div64_32(uint64_t* n, uint32_t base);
+
 /* Userspace address-check functions */
 int32_t bad_userspace_addr(const void* addr, int32_t len);
 int32_t safe_strncpy(int8_t* dest, const int8_t* src, int32_t n);
@@ -134,7 +137,7 @@ do {                                    \
 /* Writes four bytes to four consecutive ports */
 #define outl(data, port)                \
 do {                                    \
-    asm volatile ("outl %l1, (%w0)"     \
+    asm volatile ("outl %k1, (%w0)"     \
             :                           \
             : "d"(port), "a"(data)      \
             : "memory", "cc"            \
@@ -177,6 +180,14 @@ do {                                    \
     );                                  \
 } while (0)
 
+/* Compiler barrier - keeps the compiler from reordering memory
+ * accesses across this point. Used to publish ring buffer entries
+ * before the index that makes them visible */
+#define barrier()                       \
+do {                                    \
+    asm volatile ("" : : : "memory");   \
+} while (0)
+
 /* Restore flags
  * Puts the value in "flags" into the EFLAGS register.  Most often used
  * after a cli_and_save_flags(flags) */
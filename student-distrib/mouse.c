@@ -1,6 +1,7 @@
 #include "mouse.h"
 #include "lib.h"
 #include "i8259.h"
+#include "trace.h"
 
 
 #define X_SCALE 4
@@ -129,6 +130,7 @@ void mouse_init(){
 void mouse_irq_handler(/* arguments */) {
   /* code */
 	cli();
+  trace(TRACE_IRQ, TR_IRQ_ENTER, 12);
   uint32_t flag=receive_command();
   /*check ack signal and reset cycle*/
   
@@ -197,6 +199,7 @@ void mouse_irq_handler(/* arguments */) {
   }
 	
   send_eoi(12);
+  trace(TRACE_IRQ, TR_IRQ_EXIT, 12);
   sti();
   
   
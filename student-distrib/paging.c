@@ -10,6 +10,9 @@
 #define TERM1_ADDR 0xA000
 #define TERM2_ADDR 0x12000
 
+// Process whose User Page is Mapped, 0 before the first
+uint8_t user_page_pid = 0;
+
 /* init_page()
  * Setup the PD and first PT (0-4MB)
  * Range 4-8MB is set up as an extended page for Kernel
@@ -111,6 +114,19 @@ void init_page(){
 	return;
 }
 
+/* user_phys()
+ * Physical Address behind an Address in a Process' 4MB User Page,
+ * the same Frame switch_task() Maps
+ *
+ * Inputs:  pid - Process (Thread Group Leader) owning the Page
+ *         addr - Virtual Address within the User Page
+ * Outputs: Physical Address
+ */
+uint32_t user_phys(uint8_t pid, uint32_t addr) {
+	uint32_t page = 1 << (PD_ADDR_OFFSET + PT_ADDR_OFFSET);
+	return ((pid + 3) << (PD_ADDR_OFFSET + PT_ADDR_OFFSET)) | (addr & (page - 1));
+}
+
 /* switch_task()
  * Switches the Page Mapping of 128-132MB to Physical Memory
  * corresponding to the Process ID
@@ -119,6 +135,7 @@ void init_page(){
  * Outputs: None
  */
 void switch_task(uint8_t pid) {
+	user_page_pid = pid;
 	
 	// Activate the PDE of Executable
 	page_directory[ELF_DIR].present = 1;
@@ -212,3 +229,50 @@ void map_video(int term) {
 	
 	return;
 }
+
+/* map_user_page()
+ * Maps a 4KB Kernel Page for User Space in the Page Table of VID_DIR,
+ * which every Process shares. Index 0 belongs to map_video().
+ * 
+ * Inputs:       idx - Page Index within VID_DIR (> 0)
+ *         phys_addr - 4KB Aligned Physical Address
+ *          writable - 0 to Map Read-Only
+ * Outputs: None
+ */
+void map_user_page(uint32_t idx, uint32_t phys_addr, uint32_t writable) {
+	vid_page_table[idx].present = 1;
+	vid_page_table[idx].r_w = (writable != 0);
+	vid_page_table[idx].user_priv = 1;
+	vid_page_table[idx].write_thru = 0;
+	vid_page_table[idx].cache_dis = 0;
+	vid_page_table[idx].accessed = 0;
+	vid_page_table[idx].dirty = 0;
+	vid_page_table[idx].zero = 0;
+	vid_page_table[idx].global = 0;
+	vid_page_table[idx].avail = 0;
+	vid_page_table[idx].page_addr = phys_addr >> PT_ADDR_OFFSET;
+	
+	// The Directory Entry is the same one map_video() Installs
+	page_directory[VID_DIR].present = 1;
+	page_directory[VID_DIR].r_w = 1;
+	page_directory[VID_DIR].user_priv = 1;
+	page_directory[VID_DIR].write_thru = 0;
+	page_directory[VID_DIR].cache_dis = 0;
+	page_directory[VID_DIR].accessed = 0;
+	page_directory[VID_DIR].zero = 0;
+	page_directory[VID_DIR].size = 0;
+	page_directory[VID_DIR].ignore = 0;
+	page_directory[VID_DIR].avail = 0;
+	page_directory[VID_DIR].page_addr = ((uint32_t) vid_page_table) >> PT_ADDR_OFFSET;
+	
+	// Flush the TLB
+	asm volatile(
+	"movl %%cr3, %%eax ;"
+	"movl %%eax, %%cr3 ;"
+	: // No Inputs
+	: // No Outputs
+	: "eax"
+    );
+	
+	return;
+}
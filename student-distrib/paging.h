@@ -24,6 +24,12 @@ void init_page();
 /* Switch Task */
 void switch_task(uint8_t pid);
 
+/* Process whose User Page switch_task() Mapped last */
+extern uint8_t user_page_pid;
+
+/* Physical Address behind a User Page Address of a Process */
+uint32_t user_phys(uint8_t pid, uint32_t addr);
+
 /* Free a previously allocated Page Directory */
 uint32_t free_directory(uint32_t dir);
 
@@ -33,4 +39,7 @@ uint32_t free_page(uint32_t dir, uint32_t idx);
 /* Allocate a 4KB Page at 132MB Mapped to Video Memory */
 void map_video(int term);
 
+/* Map a Kernel Page into every Process after the Video Page */
+void map_user_page(uint32_t idx, uint32_t phys_addr, uint32_t writable);
+
 #endif
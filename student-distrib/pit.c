@@ -1,27 +1,215 @@
 /* pit.c
  * Programmable Interval Timer Driver
+ *
+ * The PIT runs in one-shot mode. Each time it is armed, it is set to
+ * the nearest real deadline: the next kernel timer, or the end of the
+ * running process' time slice when other processes are waiting. A
+ * single runnable process is therefore not interrupted by the
+ * scheduler. The slice length and preemption come from the policy in
+ * syscall.c. Elapsed time is read back from the counter, which keeps
+ * counting down past zero, so the kernel clock does not drift.
  */
 
 #include "pit.h"
 #include "lib.h"
 #include "i8259.h"
 #include "syscall.h"
+#include "timer.h"
+#include "trace.h"
 
-/* pit_irq_handler()
- * PIT Interrupt Handler, calls schedule() on each Interrupt.
+// Counts the PIT was last Armed with, 0 before pit_init()
+static uint32_t pit_armed = 0;
+// Counts the Running Process has used of its Slice
+static uint32_t pit_slice_used = 0;
+// Slice Length in Counts and in Microseconds
+static uint32_t pit_quantum = 0;
+static uint32_t pit_quantum_us = 0;
+
+/* pit_program()
+ * Arm a One-Shot on Channel 0
+ *
+ * Inputs: counts - PIT Input Clock Counts until IRQ 0
+ * Outputs: None
+ */
+static void pit_program(uint32_t counts) {
+	pit_armed = counts;
+	outb(PIT_MODE_ONESHOT, PIT_IO);
+	// Send Low Byte
+	outb(counts, CHANNEL_ZERO);
+	// Send High Byte
+	outb(counts >> BYTE_SHIFT, CHANNEL_ZERO);
+}
+
+/* pit_elapsed()
+ * Read back how far Channel 0 got since it was Armed
  *
  * Inputs: None
+ * Outputs: Counts Elapsed, the Counter keeps going past Zero
+ */
+static uint32_t pit_elapsed(void) {
+	uint32_t status, count;
+
+	outb(PIT_READBACK, PIT_IO);
+	status = inb(CHANNEL_ZERO);
+	count = inb(CHANNEL_ZERO);
+	count |= inb(CHANNEL_ZERO) << BYTE_SHIFT;
+
+	// Count not Loaded yet, no Time has Passed
+	if (status & PIT_STATUS_NULL) return 0;
+	// Expired, the Counter Wrapped and kept going
+	if (status & PIT_STATUS_OUT) return pit_armed + ((PIT_COUNT_WRAP - count) & PIT_COUNT_MAX);
+	return pit_armed - count;
+}
+
+/* pit_account()
+ * Charge the Time since the PIT was Armed to the Kernel Clock and the
+ * current Slice
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+static void pit_account(void) {
+	uint32_t elapsed = pit_elapsed();
+
+	timer_tick(elapsed);
+	pit_slice_used += elapsed;
+}
+
+/* pit_next_counts()
+ * Counts until the nearest Deadline, Measured from the last Time the
+ * Clock was Charged
+ *
+ * Inputs: switching - 1 if the Caller is about to Schedule
+ * Outputs: Counts, PIT_COUNT_MIN to Switch at once
+ */
+static uint32_t pit_next_counts(int switching) {
+	uint32_t counts = timer_next_counts();
+	// Once schedule() Runs, the Slice is the one of the Process it Picks
+	int pid = (switching && current_pid != 0) ? find_next_pid(current_pid) : -1;
+	uint32_t slice = sched_slice((pid > 0) ? pid : current_pid, pit_quantum);
+	int runnable = nr_runnable();
+
+	if (counts > PIT_COUNT_MAX) counts = PIT_COUNT_MAX;
+	// Keep Sampling a Process that Runs Alone
+	if (prof_enabled && counts > PROF_PERIOD_COUNTS) counts = PROF_PERIOD_COUNTS;
+	if (!switching && runnable > 0 && (!current_runnable() || sched_preempt())) {
+		// The current Process Blocked or was Outranked, Switch at once
+		counts = PIT_COUNT_MIN;
+	}
+	else if (runnable > 1) {
+		// Others are Waiting, End the Slice in Time
+		if (pit_slice_used >= slice) counts = PIT_COUNT_MIN;
+		else if (slice - pit_slice_used < counts) counts = slice - pit_slice_used;
+	}
+	if (counts < PIT_COUNT_MIN) counts = PIT_COUNT_MIN;
+	return counts;
+}
+
+/* pit_arm_next()
+ * Arm the PIT for the nearest Deadline
+ *
+ * Inputs: switching - 1 if the Caller is about to Schedule
+ * Outputs: None
+ */
+static void pit_arm_next(int switching) {
+	pit_program(pit_next_counts(switching));
+}
+
+/* pit_irq_handler()
+ * PIT Interrupt Handler, advances the Kernel Clock, calls schedule()
+ * once the Slice is Used up, the Process Blocked or a Higher Priority
+ * Process Woke, and re-arms.
+ *
+ * Inputs: frame - Interrupted Context, Sampled by the Profiler
  * Outputs: None
  */
-void pit_irq_handler(void){
+void pit_irq_handler(irq_frame_t* frame){
+	int expired = 0;
+	trace(TRACE_IRQ, TR_IRQ_ENTER, PIT_IRQ);
+	prof_sample(frame);
 	// Send EOI
 	send_eoi(PIT_IRQ);
-	// Call Scheduler
-	schedule();
+	// Advance Jiffies and Queue Expired Timers
+	pit_account();
+	if (pit_slice_used >= sched_slice(current_pid, pit_quantum)) {
+		// Used the whole Slice, the Policy may Demote it
+		sched_slice_expired();
+		expired = 1;
+	}
+	if (expired || !current_runnable() || sched_preempt()) {
+		// The next Process starts a fresh Slice
+		pit_slice_used = 0;
+		pit_arm_next(1);
+		trace(TRACE_IRQ, TR_IRQ_EXIT, PIT_IRQ);
+		// Call Scheduler
+		schedule();
+	}
+	else {
+		pit_arm_next(0);
+		trace(TRACE_IRQ, TR_IRQ_EXIT, PIT_IRQ);
+	}
 	// Re-enable all IRQs
 	sti();
 }
 
+/* pit_rearm()
+ * Re-evaluate the next Deadline, called when a Timer is Added or a
+ * Process Blocks or Wakes. The PIT is only Reprogrammed when the new
+ * Deadline comes before the Armed one; the Countdown is otherwise left
+ * Running so no Counts are lost to the Reload.
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void pit_rearm(void) {
+	uint32_t flags;
+
+	cli_and_save(flags);
+	// Nothing was Charged since the PIT was Armed, so both Deadlines
+	// are Measured from the same Point
+	if (pit_armed != 0 && pit_next_counts(0) < pit_armed) {
+		pit_account();
+		pit_arm_next(0);
+	}
+	restore_flags(flags);
+}
+
+/* pit_running()
+ * Check whether pit_init() has Run, i.e. jiffies Advance and Timers Fire
+ *
+ * Inputs: None
+ * Outputs: 1 if it has, 0 otherwise
+ */
+int32_t pit_running(void) {
+	return pit_armed != 0;
+}
+
+/* pit_set_quantum()
+ * Set the Scheduler Time Slice
+ *
+ * Inputs: us - Slice in Microseconds, 0 only Queries it
+ * Outputs: Previous Slice in Microseconds
+ */
+uint32_t pit_set_quantum(uint32_t us) {
+	uint32_t flags;
+	uint32_t old = pit_quantum_us;
+	uint64_t counts;
+
+	if (us == 0) return old;
+	if (us < QUANTUM_MIN_US) us = QUANTUM_MIN_US;
+	if (us > QUANTUM_MAX_US) us = QUANTUM_MAX_US;
+
+	counts = (uint64_t) us * INI_FRE;
+	div64_32(&counts, US_PER_S);
+
+	cli_and_save(flags);
+	pit_quantum_us = us;
+	pit_quantum = (uint32_t) counts;
+	restore_flags(flags);
+	pit_rearm();
+	return old;
+}
+
 /* pit_init()
  * Initialize the PIT
  *
@@ -29,20 +217,17 @@ void pit_irq_handler(void){
  * Outputs: None
  */
 void pit_init(){
+	// Default Time Slice
+	pit_set_quantum(QUANTUM_DEFAULT_US);
+	
 	// Disable all Interrupts
 	cli();
 	
 	// Initalize the Mode/Command Register connected to I/O Port 0x43
 	// refer to https://github.com/pdoane/osdev/blob/master/time/pit.c
-	outb(PIT_MODE, PIT_IO);
-	
 	// Channel 0 is connected Directly to IRQ0
-	// Set the frequency
-	
-	// Send Low Byte
-	outb(INI_FRE/DENO_FRE, CHANNEL_ZERO);
-	// Send High Byte
-	outb((INI_FRE/DENO_FRE)>>BYTE_SHIFT, CHANNEL_ZERO);
+	pit_slice_used = 0;
+	pit_program(PIT_COUNT_MIN);
 
 	// Re-enable all Interrupts
 	sti();
@@ -6,24 +6,50 @@
 #define _PIT_H
 
 #include "types.h"
+#include "prof.h"
 
 // IRQ connected to PIT
 #define PIT_IRQ 	0
 // I/O Port used to set Mode
 #define PIT_IO		0x43
-// 0x34 = 0011 0100 = Binary Mode, Operating Mode, Rate Generator, Low+High byte, Counter0
-#define PIT_MODE	0x34
+// 0x30 = 0011 0000 = Binary Mode, Interrupt on Terminal Count, Low+High byte, Counter0
+#define PIT_MODE_ONESHOT	0x30
+// 0xC2 = 1100 0010 = Read-Back, Latch Count and Status of Counter0
+#define PIT_READBACK	0xC2
+// Read-Back Status Bits: OUT Pin and Count not Loaded yet
+#define PIT_STATUS_OUT	0x80
+#define PIT_STATUS_NULL	0x40
 // Numerator of the Frequency, Pre-determined
 #define INI_FRE		1193182
-// Denominator of the the Frequency
-#define DENO_FRE	20000
 // Bits to be shifted right when obtaining the High Bits of Frequency
 #define BYTE_SHIFT	8
 // I/O Port for PIT Channel Zero
 #define CHANNEL_ZERO	0x40
 
-void pit_irq_handler(void);
+// Longest One-Shot (~55ms) and Shortest, to avoid an IRQ Storm (~50us)
+#define PIT_COUNT_MAX	0xFFFF
+#define PIT_COUNT_MIN	60
+// The Counter keeps Counting down from PIT_COUNT_MAX past Zero
+#define PIT_COUNT_WRAP	0x10000
+
+// Scheduler Time Slice in Microseconds
+#define QUANTUM_DEFAULT_US	10000
+#define QUANTUM_MIN_US		100
+#define QUANTUM_MAX_US		1000000
+// Microseconds per Second
+#define US_PER_S	1000000
+
+void pit_irq_handler(irq_frame_t* frame);
 
 void pit_init();
 
+/* Re-evaluate the next Deadline after a Timer or Runnable Task Changed */
+void pit_rearm(void);
+
+/* 1 once the PIT is Running and Timers Fire */
+int32_t pit_running(void);
+
+/* Set the Time Slice, returns the previous one in Microseconds */
+uint32_t pit_set_quantum(uint32_t us);
+
 #endif
@@ -0,0 +1,131 @@
+/* prof.c
+ * Sampling Profiler driven by the PIT Interrupt
+ *
+ * While enabled, every PIT interrupt records the interrupted EIP, CS
+ * and pid, and the PIT is armed at least every PROF_PERIOD_COUNTS so
+ * a process running alone is still sampled. Samples are drained from
+ * the "prof" device; writing '1' to it clears the buffer and starts
+ * sampling, writing '0' or closing it stops it.
+ */
+
+#include "prof.h"
+#include "lib.h"
+#include "pit.h"
+
+// Sample Buffer, Written by prof_sample() and Drained by prof_read()
+static prof_sample_t prof_buf[PROF_BUF_SIZE];
+static uint32_t prof_head = 0;
+static uint32_t prof_tail = 0;
+// Samples Dropped since the last Read
+static uint32_t prof_dropped = 0;
+
+volatile uint32_t prof_enabled = 0;
+
+// PID of Current Running Process
+extern int current_pid;
+
+/* prof_sample()
+ * Record the Interrupted Context. Called with Interrupts Disabled.
+ *
+ * Inputs: frame - Hardware Frame of the PIT Interrupt
+ * Outputs: None
+ */
+void prof_sample(const irq_frame_t* frame) {
+	prof_sample_t* s;
+
+	if (!prof_enabled) return;
+	if (prof_head - prof_tail >= PROF_BUF_SIZE) {
+		prof_dropped++;
+		return;
+	}
+	s = &prof_buf[prof_head++ & PROF_BUF_MASK];
+	s->eip = frame->eip;
+	s->cs = frame->cs;
+	s->pid = current_pid;
+}
+
+/* prof_open()
+ * Open the Profiler Device
+ *
+ * Inputs: None Effective
+ * Outputs: 0
+ */
+int32_t prof_open(const uint8_t* filename) {
+	return 0;
+}
+
+/* prof_read()
+ * Drain the Oldest Samples. Only whole Samples are Copied, and Dropped
+ * Samples are Reported first.
+ *
+ * Inputs: buf - Buffer for prof_sample_t Records
+ *      nbytes - Size of buf
+ * Outputs: Bytes Copied, 0 if no Samples are Pending
+ */
+int32_t prof_read(unsigned int inode, unsigned int offset, void* buf, int32_t nbytes) {
+	uint32_t flags;
+	prof_sample_t* out = (prof_sample_t*) buf;
+	int32_t n = 0, max = nbytes / (int32_t) sizeof(prof_sample_t);
+
+	cli_and_save(flags);
+	if (prof_dropped != 0 && n < max) {
+		out[n].eip = prof_dropped;
+		out[n].cs = 0;
+		out[n].pid = 0;
+		prof_dropped = 0;
+		n++;
+	}
+	while (prof_tail != prof_head && n < max) {
+		out[n++] = prof_buf[prof_tail++ & PROF_BUF_MASK];
+	}
+	restore_flags(flags);
+	return n * sizeof(prof_sample_t);
+}
+
+/* prof_write()
+ * Start ('1') or Stop ('0') Sampling. Starting Discards old Samples.
+ *
+ * Inputs: buf - Command Character
+ *      nbytes - At least 1
+ * Outputs: nbytes, -1 on an Unknown Command
+ */
+int32_t prof_write(unsigned int inode, const void* buf, int32_t nbytes) {
+	uint32_t flags;
+	uint8_t cmd;
+
+	if (nbytes < 1) return -1;
+	cmd = *(const uint8_t*) buf;
+
+	cli_and_save(flags);
+	if (cmd == '1') {
+		prof_head = prof_tail = 0;
+		prof_dropped = 0;
+		prof_enabled = 1;
+	}
+	else if (cmd == '0') {
+		prof_enabled = 0;
+	}
+	else {
+		restore_flags(flags);
+		printf("PROF.PROF_WRITE: ERR - Unknown Command %c \n", cmd);
+		return -1;
+	}
+	restore_flags(flags);
+	// Shorten or Restore the Sampling Period
+	pit_rearm();
+	return nbytes;
+}
+
+/* prof_close()
+ * Close the Profiler Device and Stop Sampling
+ *
+ * Inputs: None Effective
+ * Outputs: 0
+ */
+int32_t prof_close(unsigned int inode) {
+	if (prof_enabled) {
+		prof_enabled = 0;
+		pit_rearm();
+	}
+	return 0;
+}
@@ -0,0 +1,47 @@
+/* prof.h
+ * Sampling Profiler driven by the PIT Interrupt
+ */
+
+#ifndef _PROF_H
+#define _PROF_H
+
+#include "types.h"
+
+/* Sample Buffer Size, a Power of 2 */
+#define PROF_BUF_SIZE	8192
+#define PROF_BUF_MASK	(PROF_BUF_SIZE - 1)
+
+/* Longest Sampling Period while Enabled, in PIT Counts (~1ms) */
+#define PROF_PERIOD_COUNTS	1193
+
+/* Name of the Device that Controls the Profiler */
+#define PROF_DEV_NAME	"prof"
+
+/* Hardware Interrupt Frame, as left on the Stack by the CPU */
+typedef struct irq_frame_t {
+	uint32_t eip;
+	uint32_t cs;
+	uint32_t eflags;
+} irq_frame_t;
+
+/* Profiler Sample, 8 Bytes. A Sample with cs = 0 is not a Sample:
+ * eip holds the Number of Samples Dropped because the Buffer was Full. */
+typedef struct prof_sample_t {
+	uint32_t eip;
+	uint16_t cs;
+	uint16_t pid;
+} prof_sample_t;
+
+/* Non-Zero while Sampling */
+extern volatile uint32_t prof_enabled;
+
+/* Record the Interrupted Context, called from pit_irq_handler() */
+void prof_sample(const irq_frame_t* frame);
+
+/* Character Device Driver Functions */
+int32_t prof_open(const uint8_t* filename);
+int32_t prof_read(unsigned int inode, unsigned int offset, void* buf, int32_t nbytes);
+int32_t prof_write(unsigned int inode, const void* buf, int32_t nbytes);
+int32_t prof_close(unsigned int inode);
+
+#endif // _PROF_H
@@ -1,24 +1,28 @@
 /* rtc.c
  * Generic Real Time Clock Interface Driver
+ *
+ * The hardware runs at RTC_HW_FREQ and every open RTC FD gets a virtual
+ * RTC that divides it down, so processes writing different frequencies
+ * do not disturb each other. Periodic interrupts are only enabled while
+ * an RTC FD is open.
  */
 
 #include "rtc.h"
 #include "lib.h"
 #include "i8259.h"
+#include "syscall.h"
+#include "trace.h"
+#include "klog.h"
 
 /* Global Variables */
-// RTC Status
-uint32_t RTC_STATUS = 0;
-// RTC Frequency in Hz
-uint32_t RTC_FREQ = FDEFAULT;
-// Virtual Elapsed Clock Ticks
-uint32_t RTC_ELAPSED_TICKS_V = 0;
-// Global Elapsed Clock Ticks
-uint32_t RTC_ELAPSED_TICKS_G = 0;
-// RTC Kernel Frequency for Terminal and Scheduler in Hz
-uint32_t RTC_FREQ_KERNEL = 64;
-// Wait for IRQ to be Raised
-uint32_t RTC_IRQ_WAIT[TERM_MAX] = {0};
+// Hardware Ticks since Boot
+static volatile uint32_t rtc_hw_ticks = 0;
+// Virtual RTCs, one per Open RTC FD
+static rtc_virt_t rtc_virt[RTC_VIRT_MAX];
+// Bitmask of Virtual RTCs with a Reader Waiting
+static volatile uint32_t rtc_waiters = 0;
+// Number of Virtual RTCs in Use, the Hardware only Ticks while Nonzero
+static uint32_t rtc_users = 0;
 
 /* rtc_init()
  * Initialize the RTC
@@ -29,33 +33,19 @@ void rtc_init(void) {
 	// Generic Loop Counter
 	int i;
 	
-	// Store the read value of Register B
-	uint8_t REG_B_VAL;
-	
-	// Lower IRQ Wait
-	for (i = 0; i < TERM_MAX; i++) RTC_IRQ_WAIT[i] = 0;
+	// Release all Virtual RTCs
+	for (i = 0; i < RTC_VIRT_MAX; i++) rtc_virt[i].in_use = 0;
+	rtc_waiters = 0;
+	rtc_users = 0;
 	
 	// Disable all IRQs while Initializing RTC
 	cli();
 	
-	/* Perform reads by setting address then reading data */
-	{
-		// Select Register B
-		outb(RTC_REG_B, RTC_PORT);
-		// Read the value of Register B
-		REG_B_VAL = inb(RTC_CMOS);
-	}
-	
-	/* Turn on Interrupts */
-	{
-		// Select Register B
-		outb(RTC_REG_B, RTC_PORT);
-		// Drive REG_B[6] to 1
-		outb(REG_B_VAL | REG_B_MASK, RTC_CMOS);
-	}
+	// Periodic Interrupts stay off until the first Open
+	rtc_set_periodic(0);
 	
-	// Set default frequency of 1024Hz
-	rtc_set_freq(FDEFAULT);
+	// Run the Hardware at the Highest Virtual Frequency
+	rtc_set_rate(RTC_HW_RATE);
 	
 	// Re-enable all IRQs
 	sti();
@@ -64,28 +54,66 @@ void rtc_init(void) {
 	enable_irq(RTC_IRQ);
 	
 	// Reset Elapsed Time to 0
-	RTC_ELAPSED_TICKS_V = 0;
-	RTC_ELAPSED_TICKS_G = 0;
+	rtc_hw_ticks = 0;
 	
 	return;
 }
 
-/* rtc_set_freq()
- * Set the clock's interval frequency
+/* rtc_set_rate()
+ * Program the Periodic Interrupt Rate of the Hardware.
+ * Must be called with Interrupts Disabled.
  *
- * Inputs: freq - Allowed frequency constant
- * Outputs: 0 on Success, -1 on Failure
+ * Inputs: rate - One of the F*Hz Rate Constants
+ * Outputs: None
  */
-uint32_t rtc_set_freq(uint32_t freq) {	
-	// Set Local Frequency
-	RTC_FREQ = freq;
-	return 0;
+void rtc_set_rate(uint8_t rate) {	
+	uint8_t REG_A_VAL;
+	// Read Register A
+	outb(RTC_REG_A, RTC_PORT);
+	REG_A_VAL = inb(RTC_CMOS);
+	// Replace the Rate Bits, keep the Divider
+	outb(RTC_REG_A, RTC_PORT);
+	outb((REG_A_VAL & DIV_MASK) | (rate & RATE_MASK), RTC_CMOS);
+}
+
+/* rtc_set_periodic()
+ * Turn the Periodic Interrupt on or off.
+ * Must be called with Interrupts Disabled.
+ *
+ * Inputs: on - 1 to Enable, 0 to Disable
+ * Outputs: None
+ */
+void rtc_set_periodic(uint32_t on) {
+	// Store the read value of Register B
+	uint8_t REG_B_VAL;
+	
+	/* Perform reads by setting address then reading data */
+	{
+		// Select Register B
+		outb(RTC_REG_B, RTC_PORT);
+		// Read the value of Register B
+		REG_B_VAL = inb(RTC_CMOS);
+	}
+	
+	/* Drive REG_B[6] */
+	{
+		// Select Register B
+		outb(RTC_REG_B, RTC_PORT);
+		if (on) outb(REG_B_VAL | REG_B_MASK, RTC_CMOS);
+		else outb(REG_B_VAL & ~REG_B_MASK, RTC_CMOS);
+	}
+	
+	// Clear any IRQ already Latched in Register C
+	outb(RTC_REG_C, RTC_PORT);
+	inb(RTC_CMOS);
 }
 
 /* rtc_irq_handler()
  * Handler for a RTC Interrupt. When IRQ 8 is raised, read register C 
  * to determine the interrupt type. Since we are using RTC as a
  * simple periodic timer, the read value is not used at this point.
+ * Only Virtual RTCs with a Waiting Reader are Checked, and only those
+ * whose Virtual Period has Elapsed are Woken.
  *
  * Inputs: None
  * Outputs: None
@@ -93,10 +121,12 @@ uint32_t rtc_set_freq(uint32_t freq) {
 void rtc_irq_handler(void) {
 	
 	uint32_t IRQ_TYPE;
+	uint32_t waiters;
 	uint32_t i;
 	
 	// Disable all IRQs while Handling RTC
 	cli();
+	trace(TRACE_IRQ, TR_IRQ_ENTER, RTC_IRQ);
 	
 	// Select Register C
 	outb(RTC_REG_C, RTC_PORT);
@@ -104,25 +134,21 @@ void rtc_irq_handler(void) {
 	IRQ_TYPE = inb(RTC_CMOS);
 	
 	// Virtual RTC Handler
-	RTC_ELAPSED_TICKS_V = RTC_ELAPSED_TICKS_V + 1;
-	if (RTC_ELAPSED_TICKS_V >= (FDEFAULT / RTC_FREQ)) {
-		// Reset Ticks and Increment Seconds
-		RTC_ELAPSED_TICKS_V = 0;
-		// Raise IRQ Wait Flag
-		for (i = 0; i < TERM_MAX; i++) RTC_IRQ_WAIT[i] = 1;
+	rtc_hw_ticks++;
+	waiters = rtc_waiters;
+	for (i = 0; waiters != 0; i++, waiters >>= 1) {
+		if (!(waiters & 1)) continue;
+		// Wake the Reader once its Virtual Tick has Arrived
+		if ((int32_t) (rtc_hw_ticks - rtc_virt[i].next_tick) >= 0) {
+			rtc_virt[i].fired = 1;
+			rtc_waiters &= ~(1 << i);
+			process_wake_interactive(rtc_virt[i].waiter);
+		}
 	}
 	
-	// Global RTC Handler
-	RTC_ELAPSED_TICKS_G = RTC_ELAPSED_TICKS_G + 1;
-	if (RTC_ELAPSED_TICKS_G >= FDEFAULT / RTC_FREQ_KERNEL) {
-		// Reset Ticks and Increment Seconds
-		RTC_ELAPSED_TICKS_G = 0;
-		// Refresh Terminal
-		display_terminal();
-	}
-
 	// Send EOI
 	send_eoi(RTC_IRQ);
+	trace(TRACE_IRQ, TR_IRQ_EXIT, RTC_IRQ);
 	
 	// Re-enable all IRQs
 	sti();
@@ -131,74 +157,128 @@ void rtc_irq_handler(void) {
 }
 
 /* rtc_open()
- * Empty
+ * Allocate a Virtual RTC running at RTC_VIRT_DEFAULT
  * 
  * Inputs: None
- * Outputs: 0
+ * Outputs: Index of the Virtual RTC, -1 if None is Free
  */
 int32_t rtc_open(const uint8_t* filename) {
+	uint32_t flags;
+	int32_t i;
 	
-	return 0;
+	cli_and_save(flags);
+	for (i = 0; i < RTC_VIRT_MAX; i++) {
+		if (!rtc_virt[i].in_use) {
+			rtc_virt[i].in_use = 1;
+			rtc_virt[i].divisor = RTC_HW_FREQ / RTC_VIRT_DEFAULT;
+			rtc_virt[i].next_tick = rtc_hw_ticks + rtc_virt[i].divisor;
+			rtc_virt[i].fired = 0;
+			rtc_virt[i].waiter = 0;
+			// First User Starts the Hardware
+			if (rtc_users++ == 0) rtc_set_periodic(1);
+			restore_flags(flags);
+			return i;
+		}
+	}
+	restore_flags(flags);
+	return -1;
 }
 
 /* rtc_close()
- * Empty
+ * Release the FD's Virtual RTC
  * 
- * Inputs: None
- * Outputs: 0
+ * Inputs: inode - Virtual RTC Index
+ * Outputs: 0 on Success, -1 on Invalid Index
  */
-int32_t rtc_close(void) {
+int32_t rtc_close(unsigned int inode) {
+	uint32_t flags;
 	
+	if (inode >= RTC_VIRT_MAX || !rtc_virt[inode].in_use) return -1;
+	cli_and_save(flags);
+	rtc_waiters &= ~(1 << inode);
+	rtc_virt[inode].in_use = 0;
+	// Last User Stops the Hardware
+	if (--rtc_users == 0) rtc_set_periodic(0);
+	restore_flags(flags);
 	return 0;
 }
 
 /* rtc_read() 
- * Waits for an Interrupt to Occur and returns
+ * Waits for the next Tick of the FD's Virtual RTC and returns. Ticks
+ * stay in Phase with the Virtual Period unless the Reader falls a whole
+ * Period behind.
  * 
- * Inputs: None
- * Outputs: 0 on Success
+ * Inputs: inode - Virtual RTC Index
+ * Outputs: 0 on Success, -1 on Invalid Index or if another Thread is
+ *          already Reading the FD
  */
 int32_t rtc_read(unsigned int inode, unsigned int offset, void* buf, int32_t nbytes) {
-	// Get this Process' Terminal
-	int process_term = get_process();
+	uint32_t flags;
+	rtc_virt_t* vrtc;
 	
-	// Wait for IRQ to Occur
-	RTC_IRQ_WAIT[process_term] = 0;
-	while (RTC_IRQ_WAIT[process_term] != 1);
+	if (inode >= RTC_VIRT_MAX || !rtc_virt[inode].in_use) return -1;
+	vrtc = &rtc_virt[inode];
+	
+	cli_and_save(flags);
+	// Threads Share the FD, but a Virtual RTC Wakes one Reader
+	if (vrtc->waiter != 0) {
+		restore_flags(flags);
+		klog(KLOG_ERR, "RTC.READ: ERR - Virtual RTC already has a Reader \n");
+		return -1;
+	}
+	// Missed the last Tick entirely, wait a full Period from Now
+	if ((int32_t) (rtc_hw_ticks - vrtc->next_tick) >= 0) {
+		vrtc->next_tick = rtc_hw_ticks + vrtc->divisor;
+	}
+	// Register as a Waiter
+	vrtc->fired = 0;
+	vrtc->waiter = current_pid;
+	rtc_waiters |= (1 << inode);
+	
+	// Block until the IRQ Wakes us
+	while (vrtc->fired != 1) process_sleep();
+	vrtc->waiter = 0;
+	restore_flags(flags);
+	
+	// Schedule the next Virtual Tick
+	vrtc->next_tick += vrtc->divisor;
 	return 0;
 }
 
 /* rtc_write()
- * Write the desired Frequency of RTC
+ * Set the Frequency of the FD's Virtual RTC
  * 
- * Inputs: buffer - Pointer to Int that stores Frequency
+ * Inputs: inode - Virtual RTC Index
+ *		   buffer - Pointer to Int that stores Frequency
  *		   size - Should be 4 Bytes
  * Outputs: 4 on Success, 0 on Fail
  */
-int32_t rtc_write(const void* buffer, int32_t size) {
+int32_t rtc_write(unsigned int inode, const void* buffer, int32_t size) {
 	
 	uint32_t* buf = (uint32_t*) buffer;
 	uint32_t freq;
 	
 	// Check that size must be 4 bytes
 	if (size != 4 || buf == 0) {
-		printf("RTC.WRITE: ERR - Size Incorrect or Buffer Empty \n");
+		klog(KLOG_ERR, "RTC.WRITE: ERR - Size Incorrect or Buffer Empty \n");
 		return 0;
 	}
 	
-	// Check that Frequency is Valid
-	if (FDEFAULT % buf[0] != 0) {
-		printf("RTC.WRITE: ERR - Frequency Not Allowed \n");
+	// Check that Frequency is a Power of 2 the Hardware Rate can be Divided by
+	freq = buf[0];
+	if (freq == 0 || RTC_HW_FREQ % freq != 0) {
+		klog(KLOG_ERR, "RTC.WRITE: ERR - Frequency Not Allowed \n");
 		return 0;
 	}
 	
-	// Read and Set Frequency
-	freq = buf[0];
-	if (rtc_set_freq(freq) == -1) {
-		printf("RTC.WRITE: ERR - Set Frequency Failed \n");
+	// Check the Virtual RTC
+	if (inode >= RTC_VIRT_MAX || !rtc_virt[inode].in_use) {
+		klog(KLOG_ERR, "RTC.WRITE: ERR - Invalid Virtual RTC \n");
 		return 0;
 	}
 	
+	// Only this FD's Virtual RTC changes
+	rtc_virt[inode].divisor = RTC_HW_FREQ / freq;
+	
 	return 4;
 }
-
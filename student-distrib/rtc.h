@@ -45,20 +45,50 @@
 
 // Default Frequency during Initialization
 #define FDEFAULT 1024
+// The Hardware always Runs at the Highest Virtual Frequency
+#define RTC_HW_FREQ	FDEFAULT
+#define RTC_HW_RATE	F1024Hz
+// Rate Bits of Register A
+#define RATE_MASK	0x0F
+
+// Number of RTC FDs that can be Open at once
+#define RTC_VIRT_MAX	16
+// Frequency of a Newly Opened RTC FD
+#define RTC_VIRT_DEFAULT	2
+
+/* Virtual RTC
+ * Per-FD State of an Open RTC. The FD's inode Field Holds the Index of
+ * its Virtual RTC.
+ */
+typedef struct rtc_virt_t {
+	// Slot is Owned by an Open FD
+	uint32_t in_use;
+	// Hardware Ticks per Virtual Tick
+	uint32_t divisor;
+	// Hardware Tick Count of the next Virtual Tick
+	uint32_t next_tick;
+	// Raised by the IRQ when a Waiter's Virtual Tick Arrives
+	volatile uint32_t fired;
+	// Process Blocked in rtc_read(), 0 if None; only one at a Time
+	uint32_t waiter;
+} rtc_virt_t;
 
 /* Functions */
 
 /* Initialize the RTC */
 void rtc_init(void);
 
-/* Set the RTC's Frequency */
-uint32_t rtc_set_freq(uint32_t freq);
+/* Program the Hardware Rate */
+void rtc_set_rate(uint8_t rate);
+
+/* Turn the Periodic Interrupt on or off */
+void rtc_set_periodic(uint32_t on);
 
-/* Character Device Driver Functions */
+/* Character Device Driver Functions, inode is the Virtual RTC Index */
 int32_t rtc_open(const uint8_t* filename);
-int32_t rtc_close(void);
+int32_t rtc_close(unsigned int inode);
 int32_t rtc_read(unsigned int inode, unsigned int offset, void* buf, int32_t nbytes);
-int32_t rtc_write(const void* buffer, int32_t size);
+int32_t rtc_write(unsigned int inode, const void* buffer, int32_t size);
 
 /* Handler for a RTC Interrupt */
 void rtc_irq_handler(void);
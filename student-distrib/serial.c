@@ -0,0 +1,242 @@
+/* serial.c
+ * 16550 UART (COM1) Serial Console Driver
+ *
+ * Output is queued in a software ring and moved to the UART a FIFO at a
+ * time from the transmit-empty interrupt, so writers never wait on the
+ * line unless the ring itself is full.
+ */
+
+#include "serial.h"
+#include "lib.h"
+#include "i8259.h"
+#include "trace.h"
+
+/* Global Variables */
+// Set once the UART has been Programmed
+static volatile uint32_t serial_ready = 0;
+// Transmit Ring (head written by Producers, tail by the IRQ)
+static uint8_t serial_tx_buf[SERIAL_TX_SIZE];
+static volatile uint32_t serial_tx_head = 0;
+static volatile uint32_t serial_tx_tail = 0;
+// Receive Ring (head written by the IRQ, tail by Readers)
+static uint8_t serial_rx_buf[SERIAL_RX_SIZE];
+static volatile uint32_t serial_rx_head = 0;
+static volatile uint32_t serial_rx_tail = 0;
+// Current Value of the Interrupt Enable Register
+static uint8_t serial_ier = 0;
+
+/* serial_fill_fifo()
+ * Move up to one FIFO worth of Bytes from the Ring to the UART, and
+ * keep the Transmit Interrupt Enabled only while the Ring has Data.
+ * Must be called with Interrupts Disabled.
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+static void serial_fill_fifo(void) {
+	int i;
+	// FIFO is only Guaranteed Empty when THR Empty is Set
+	if (inb(COM1_BASE + UART_LSR) & LSR_THR_EMPTY) {
+		for (i = 0; i < UART_FIFO_SIZE && serial_tx_tail != serial_tx_head; i++) {
+			outb(serial_tx_buf[serial_tx_tail & (SERIAL_TX_SIZE - 1)], COM1_BASE + UART_DATA);
+			serial_tx_tail++;
+		}
+	}
+	// Update the Transmit Interrupt Enable
+	if (serial_tx_tail != serial_tx_head) {
+		if (!(serial_ier & IER_TX_EMPTY)) {
+			serial_ier |= IER_TX_EMPTY;
+			outb(serial_ier, COM1_BASE + UART_IER);
+		}
+	}
+	else if (serial_ier & IER_TX_EMPTY) {
+		serial_ier &= ~IER_TX_EMPTY;
+		outb(serial_ier, COM1_BASE + UART_IER);
+	}
+}
+
+/* serial_init()
+ * Initialize COM1 at 115200 8N1 with FIFOs Enabled
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void serial_init(void) {
+	uint32_t flags;
+	cli_and_save(flags);
+
+	// Disable UART Interrupts while Programming
+	serial_ier = 0;
+	outb(0x00, COM1_BASE + UART_IER);
+	// Set the Baud Rate Divisor
+	outb(LCR_DLAB, COM1_BASE + UART_LCR);
+	outb(UART_DIVISOR & 0xFF, COM1_BASE + UART_DATA);
+	outb(UART_DIVISOR >> 8, COM1_BASE + UART_IER);
+	// 8N1, Clear DLAB
+	outb(LCR_8N1, COM1_BASE + UART_LCR);
+	// Enable and Clear FIFOs
+	outb(FCR_ENABLE, COM1_BASE + UART_FCR);
+	// Route the UART Interrupt to the PIC
+	outb(MCR_IRQ_EN, COM1_BASE + UART_MCR);
+
+	// Reset Rings
+	serial_tx_head = serial_tx_tail = 0;
+	serial_rx_head = serial_rx_tail = 0;
+
+	// Receive is always Interrupt Driven
+	serial_ier = IER_RX_AVAIL;
+	outb(serial_ier, COM1_BASE + UART_IER);
+	serial_ready = 1;
+
+	restore_flags(flags);
+
+	// Enable COM1 Interrupts
+	enable_irq(SERIAL_IRQ);
+}
+
+/* serial_putc()
+ * Queue a Character for Transmission. Newlines are sent as CR LF.
+ * Only falls back to Polling the UART when the Ring is Full.
+ *
+ * Inputs: c - Character
+ * Outputs: None
+ */
+void serial_putc(uint8_t c) {
+	uint32_t flags;
+
+	if (!serial_ready) return;
+	if (c == '\n') serial_putc('\r');
+
+	cli_and_save(flags);
+	// Ring Full: Drain one FIFO worth by Polling to make Room
+	while (serial_tx_head - serial_tx_tail >= SERIAL_TX_SIZE) {
+		while (!(inb(COM1_BASE + UART_LSR) & LSR_THR_EMPTY));
+		serial_fill_fifo();
+	}
+	serial_tx_buf[serial_tx_head & (SERIAL_TX_SIZE - 1)] = c;
+	serial_tx_head++;
+	// Kick the Transmitter if it is Idle
+	if (!(serial_ier & IER_TX_EMPTY)) serial_fill_fifo();
+	restore_flags(flags);
+}
+
+/* serial_rx_drain()
+ * Move every Received Byte from the UART into the RX Ring, dropping
+ * Bytes when the Ring is Full. Must be called with Interrupts Disabled.
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+static void serial_rx_drain(void) {
+	uint8_t c;
+	while (inb(COM1_BASE + UART_LSR) & LSR_DATA_READY) {
+		c = inb(COM1_BASE + UART_DATA);
+		if (serial_rx_head - serial_rx_tail < SERIAL_RX_SIZE) {
+			serial_rx_buf[serial_rx_head & (SERIAL_RX_SIZE - 1)] = c;
+			serial_rx_head++;
+		}
+	}
+}
+
+/* serial_irq_handler()
+ * Handler for a COM1 Interrupt. Drains the Receive FIFO into the RX
+ * Ring and refills the Transmit FIFO from the TX Ring.
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void serial_irq_handler(void) {
+	uint8_t iir;
+
+	// Disable all IRQs while Handling COM1
+	cli();
+	trace(TRACE_IRQ, TR_IRQ_ENTER, SERIAL_IRQ);
+
+	// Service every Pending Cause
+	while (!((iir = inb(COM1_BASE + UART_IIR)) & IIR_NO_INT)) {
+		switch (iir & IIR_ID_MASK) {
+			case IIR_TX_EMPTY:
+				serial_fill_fifo();
+				break;
+			case IIR_RX_AVAIL:
+			case IIR_LINE_STAT:
+				// Also covers the Character Timeout Indication
+				serial_rx_drain();
+				break;
+			default:
+				// Modem Status, cleared by Reading the MSR
+				inb(COM1_BASE + UART_MSR);
+				break;
+		}
+	}
+
+	// Send EOI
+	send_eoi(SERIAL_IRQ);
+	trace(TRACE_IRQ, TR_IRQ_EXIT, SERIAL_IRQ);
+
+	// Re-enable all IRQs
+	sti();
+}
+
+/* serial_open()
+ * Empty, COM1 is Initialized at Boot
+ *
+ * Inputs: None
+ * Outputs: 0
+ */
+int32_t serial_open(const uint8_t* filename) {
+
+	return 0;
+}
+
+/* serial_close()
+ * Empty
+ *
+ * Inputs: None
+ * Outputs: 0
+ */
+int32_t serial_close(unsigned int inode) {
+
+	return 0;
+}
+
+/* serial_read()
+ * Wait for at least one Byte to Arrive and Return what is Available
+ *
+ * Inputs:    buf - Buffer to Store Received Bytes
+ *         nbytes - Maximum Number of Bytes to Read
+ * Outputs: Number of Bytes Read
+ */
+int32_t serial_read(unsigned int inode, unsigned int offset, void* buf, int32_t nbytes) {
+	uint8_t* cbuf = (uint8_t*) buf;
+	int32_t i = 0;
+
+	if (nbytes <= 0) return 0;
+
+	// Wait for Data to Arrive
+	while (serial_rx_tail == serial_rx_head);
+
+	// Copy out what has Arrived
+	while (i < nbytes && serial_rx_tail != serial_rx_head) {
+		cbuf[i++] = serial_rx_buf[serial_rx_tail & (SERIAL_RX_SIZE - 1)];
+		serial_rx_tail++;
+	}
+	return i;
+}
+
+/* serial_write()
+ * Queue a Buffer for Transmission
+ *
+ * Inputs:    buf - Bytes to Send
+ *         nbytes - Number of Bytes
+ * Outputs: Number of Bytes Written
+ */
+int32_t serial_write(unsigned int inode, const void* buf, int32_t nbytes) {
+	const uint8_t* cbuf = (const uint8_t*) buf;
+	int32_t i;
+
+	for (i = 0; i < nbytes; i++) {
+		serial_putc(cbuf[i]);
+	}
+	return nbytes;
+}
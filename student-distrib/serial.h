@@ -0,0 +1,77 @@
+/* serial.h
+ * 16550 UART (COM1) Serial Console Driver
+ */
+
+#ifndef _SERIAL_H
+#define _SERIAL_H
+
+#include "types.h"
+
+/* Definitions */
+
+// COM1 is connected to IRQ 4
+#define SERIAL_IRQ		4
+
+// I/O Base Port of COM1
+#define COM1_BASE		0x3F8
+// Register Offsets from the Base Port
+#define UART_DATA		0	// RX/TX Buffer (DLAB = 0), Divisor Low (DLAB = 1)
+#define UART_IER		1	// Interrupt Enable (DLAB = 0), Divisor High (DLAB = 1)
+#define UART_IIR		2	// Interrupt Identification on Read
+#define UART_FCR		2	// FIFO Control on Write
+#define UART_LCR		3	// Line Control
+#define UART_MCR		4	// Modem Control
+#define UART_LSR		5	// Line Status
+#define UART_MSR		6	// Modem Status
+
+// Interrupt Enable Bits
+#define IER_RX_AVAIL	0x01
+#define IER_TX_EMPTY	0x02
+// Interrupt Identification: Bit 0 Clear while an Interrupt is Pending
+#define IIR_NO_INT		0x01
+#define IIR_ID_MASK		0x06
+#define IIR_TX_EMPTY	0x02
+#define IIR_RX_AVAIL	0x04	// Also set for Character Timeout
+#define IIR_LINE_STAT	0x06
+// Enable FIFOs, Clear both, 14 Byte RX Trigger Level
+#define FCR_ENABLE		0xC7
+// 8 Data Bits, No Parity, 1 Stop Bit
+#define LCR_8N1			0x03
+// Divisor Latch Access Bit
+#define LCR_DLAB		0x80
+// DTR, RTS and OUT2 (OUT2 gates the IRQ line)
+#define MCR_IRQ_EN		0x0B
+// Line Status Bits
+#define LSR_DATA_READY	0x01
+#define LSR_THR_EMPTY	0x20
+
+// 115200 Baud = 115200 / Divisor
+#define UART_DIVISOR	1
+// Depth of the 16550 Transmit FIFO
+#define UART_FIFO_SIZE	16
+
+// Software Ring Sizes (must be Powers of 2)
+#define SERIAL_TX_SIZE	4096
+#define SERIAL_RX_SIZE	256
+
+// Name the Device is Opened by
+#define SERIAL_DEV_NAME	"serial"
+
+/* Functions */
+
+/* Initialize COM1 */
+void serial_init(void);
+
+/* Queue a Character for Transmission */
+void serial_putc(uint8_t c);
+
+/* Character Device Driver Functions */
+int32_t serial_open(const uint8_t* filename);
+int32_t serial_close(unsigned int inode);
+int32_t serial_read(unsigned int inode, unsigned int offset, void* buf, int32_t nbytes);
+int32_t serial_write(unsigned int inode, const void* buf, int32_t nbytes);
+
+/* Handler for a COM1 Interrupt */
+void serial_irq_handler(void);
+
+#endif // _SERIAL_H
@@ -0,0 +1,175 @@
+/* stats.c
+ * Per-Process CPU Accounting and Kernel Statistics
+ *
+ * Time is charged at every mode boundary: the IRQ and system call
+ * wrappers call acct_charge() on entry with the interrupted CS, so the
+ * cycles since the last boundary go to user or kernel time, and again
+ * on exit, charging the handler to kernel time. Cycles spent halted in
+ * process_sleep() are kept apart as idle time.
+ */
+
+#include "stats.h"
+#include "lib.h"
+#include "syscall.h"
+#include "clocksource.h"
+#include "bcache.h"
+
+// TSC at the last Accounting Boundary
+static uint64_t acct_stamp = 0;
+// Set when the Running Process Halted the CPU
+static uint32_t acct_idling = 0;
+// Cycles the CPU spent Halted
+static uint64_t acct_idle_cycles = 0;
+// Snapshot being Built, too large for the Kernel Stack
+static stat_proc_t stats_proc_buf;
+
+/* acct_charge()
+ * Charge the Cycles since the last Boundary to the Running Process
+ *
+ * Inputs: user - Saved CS on Kernel Entry (its RPL tells whether User
+ *                Code was Running), 0 on Kernel Exit
+ * Outputs: None
+ */
+void acct_charge(uint32_t user) {
+	uint32_t flags;
+	uint64_t now, delta;
+	pcb_struct_t *pcb;
+
+	if (tsc_khz() == 0) return;
+
+	cli_and_save(flags);
+	now = rdtsc();
+	delta = now - acct_stamp;
+	acct_stamp = now;
+	if (acct_idling) {
+		acct_idling = 0;
+		acct_idle_cycles += delta;
+	}
+	else if (current_pid != 0) {
+		pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid)));
+		if (user & CS_RPL_MASK) pcb->acct.user_cycles += delta;
+		else pcb->acct.kernel_cycles += delta;
+	}
+	restore_flags(flags);
+}
+
+/* acct_syscall()
+ * Count a System Call and Charge the User Time before it
+ *
+ * Inputs: cs - Saved CS
+ * Outputs: None
+ */
+void acct_syscall(uint32_t cs) {
+	if (current_pid != 0) {
+		((pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid))))->acct.syscalls++;
+	}
+	acct_charge(cs);
+}
+
+/* acct_idle()
+ * Charge the Kernel Time so far and mark the next Interval as Idle.
+ * Called with Interrupts Disabled right before hlt.
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void acct_idle(void) {
+	acct_charge(0);
+	acct_idling = 1;
+}
+
+/* acct_switch()
+ * Charge the Process being Switched out and Count the Switch as
+ * Voluntary if it Blocked
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void acct_switch(void) {
+	pcb_struct_t *pcb;
+
+	acct_charge(0);
+	if (current_pid == 0) return;
+	pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid)));
+	if (current_runnable()) pcb->acct.nivcsw++;
+	else pcb->acct.nvcsw++;
+}
+
+/* acct_page_fault()
+ * Count a Page Fault against the Running Process
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void acct_page_fault(void) {
+	if (current_pid == 0) return;
+	((pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid))))->acct.page_faults++;
+}
+
+/* stats_proc()
+ * Build a STAT_PROC Snapshot
+ *
+ * Inputs: st - Snapshot to Fill
+ * Outputs: None
+ */
+static void stats_proc(stat_proc_t* st) {
+	int i;
+	uint32_t state;
+	pcb_struct_t *pcb;
+	proc_stat_t *ps;
+
+	// Bring the Caller's own Counters up to Date
+	acct_charge(0);
+
+	st->tsc_khz = tsc_khz();
+	st->now_cycles = rdtsc();
+	st->idle_cycles = acct_idle_cycles;
+	st->nr_proc = 0;
+	for (i = 1; i < MAX_TASK_NUM && st->nr_proc < STAT_PROC_MAX; i++) {
+		state = process_state(i);
+		if (state == 0) continue;
+		pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * i));
+		ps = &st->proc[st->nr_proc++];
+		ps->pid = pcb->pid;
+		ps->parent_pid = pcb->parent_pid;
+		ps->term = pcb->term;
+		ps->state = state;
+		ps->level = pcb->level;
+		ps->nice = pcb->nice;
+		memcpy(ps->name, pcb->name, STAT_NAME_LEN);
+		ps->acct = pcb->acct;
+	}
+}
+
+/* stats_snapshot()
+ * Copy a Snapshot of Kernel Statistics to a User Buffer
+ *
+ * Inputs: which - STAT_* Selector
+ *           buf - User Buffer
+ *        nbytes - Size of buf, the Snapshot is Truncated to it
+ * Outputs: Bytes Copied, -1 on Fail
+ */
+int32_t stats_snapshot(uint32_t which, void* buf, int32_t nbytes) {
+	stat_bcache_t bst;
+	uint32_t flags;
+	int32_t size;
+
+	if (which == STAT_BCACHE) {
+		cli_and_save(flags);
+		bcache_stat(&bst);
+		restore_flags(flags);
+		size = sizeof(stat_bcache_t);
+		if (nbytes < size) size = nbytes;
+		memcpy(buf, &bst, size);
+		return size;
+	}
+	if (which != STAT_PROC) return -1;
+
+	cli_and_save(flags);
+	stats_proc(&stats_proc_buf);
+	size = sizeof(stat_proc_t) - sizeof(proc_stat_t) * (STAT_PROC_MAX - stats_proc_buf.nr_proc);
+	if (nbytes < size) size = nbytes;
+	memcpy(buf, &stats_proc_buf, size);
+	restore_flags(flags);
+	return size;
+}
@@ -0,0 +1,101 @@
+/* stats.h
+ * Per-Process CPU Accounting and Kernel Statistics
+ */
+
+#ifndef _STATS_H
+#define _STATS_H
+
+#include "types.h"
+
+// getstat() Selectors
+#define STAT_PROC	0
+#define STAT_BCACHE	1
+
+// Bytes of a Process Name kept for Statistics
+#define STAT_NAME_LEN	32
+// Processes Reported by STAT_PROC
+#define STAT_PROC_MAX	16
+
+// Privilege Level Bits of a Saved CS
+#define CS_RPL_MASK	0x3
+
+/* Per-Process Counters, kept in the PCB */
+typedef struct proc_acct_t {
+	// TSC Cycles spent in User and Kernel Mode
+	uint64_t user_cycles;
+	uint64_t kernel_cycles;
+	// Context Switches after Blocking and after Preemption
+	uint32_t nvcsw;
+	uint32_t nivcsw;
+	// System Calls and Page Faults
+	uint32_t syscalls;
+	uint32_t page_faults;
+	// Bytes Moved by read() and write()
+	uint64_t bytes_read;
+	uint64_t bytes_written;
+} proc_acct_t;
+
+/* One Process in a STAT_PROC Snapshot */
+typedef struct proc_stat_t {
+	uint32_t pid;
+	uint32_t parent_pid;
+	uint32_t term;
+	// process_list State (1 Runnable, 2 Waiting for Child, 3 Sleeping)
+	uint32_t state;
+	// Scheduler Level and nice Value
+	uint32_t level;
+	uint32_t nice;
+	uint8_t name[STAT_NAME_LEN];
+	proc_acct_t acct;
+} proc_stat_t;
+
+/* STAT_PROC Snapshot, Truncated to the User Buffer */
+typedef struct stat_proc_t {
+	// TSC Frequency, 0 if Cycles are not Counted
+	uint32_t tsc_khz;
+	// Number of Valid Entries in proc[]
+	uint32_t nr_proc;
+	// TSC Cycles since Boot and Cycles spent Halted
+	uint64_t now_cycles;
+	uint64_t idle_cycles;
+	proc_stat_t proc[STAT_PROC_MAX];
+} stat_proc_t;
+
+/* STAT_BCACHE Snapshot of the Buffer Cache */
+typedef struct stat_bcache_t {
+	// Buffers and Bytes per Buffer
+	uint32_t nr_bufs;
+	uint32_t block_size;
+	// Buffers Holding a Block, and Pinned by a Reader
+	uint32_t nr_valid;
+	uint32_t nr_pinned;
+	// Lookups Found in the Cache, and Read from the Device
+	uint32_t hits;
+	uint32_t misses;
+	// Blocks Prefetched, and Prefetched Blocks Later Used
+	uint32_t ra_blocks;
+	uint32_t ra_hits;
+	// Valid Blocks Dropped to make Room
+	uint32_t evictions;
+} stat_bcache_t;
+
+/* Charge Cycles since the last Boundary to the Running Process; user
+ * is the Saved CS on Kernel Entry, 0 on Kernel Exit */
+void acct_charge(uint32_t user);
+
+/* Kernel Entry through int 0x80 */
+void acct_syscall(uint32_t cs);
+
+/* The Running Process is about to Halt the CPU */
+void acct_idle(void);
+
+/* The Running Process is being Switched out */
+void acct_switch(void);
+
+/* Count a Page Fault against the Running Process */
+void acct_page_fault(void);
+
+/* Fill a User Buffer with one of the STAT_* Snapshots */
+int32_t stats_snapshot(uint32_t which, void* buf, int32_t nbytes);
+
+#endif // _STATS_H
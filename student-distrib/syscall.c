@@ -1,5 +1,5 @@
 /* System Calls
- * CTOS Supports 10 System Calls
+ * Handlers for the CTOS System Calls, Numbered by syscall_tbl in irq.S
  */
 
 #include "lib.h"
@@ -9,6 +9,13 @@
 #include "file_system.h"
 #include "rtc.h"
 #include "keyboard.h"
+#include "serial.h"
+#include "pit.h"
+#include "trace.h"
+#include "prof.h"
+#include "ioring.h"
+#include "klog.h"
+#include "thread.h"
 
 // Function Table of RTC
 op_table_t rtc_op;
@@ -20,9 +27,13 @@ op_table_t file_op;
 op_table_t stdin_op;
 // Function Table of Terminal STDOUT
 op_table_t stdout_op;
+// Function Table of Serial Port
+op_table_t serial_op;
+op_table_t trace_op;
+op_table_t prof_op;
 
 /* List of Active Processes */
-uint8_t process_list[MAX_PROCESS_NUM] = {0};
+uint8_t process_list[MAX_TASK_NUM] = {0};
 
 // Current File Dentry
 int file_read_dentry;
@@ -33,6 +44,126 @@ int current_pid;
 // Array that Stores which Process is Active on each Terminal
 uint8_t term_process[TERM_MAX] = {0};
 
+#if SCHED_POLICY == SCHED_MLFQ
+// Periodic Reset of all Levels
+static ktimer_t sched_boost_timer;
+#endif
+
+/* process_sleep()
+ * Block the current Process until process_wake() is called on it. The
+ * Caller Disables Interrupts, checks its Wait Condition, Records its
+ * PID for the Waker and calls this in a Loop, so no Wakeup is lost.
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void process_sleep(void) {
+	int pid = current_pid;
+	
+	process_list[pid] = PROCESS_SLEEPING;
+	// Let the PIT Switch to another Process right away
+	pit_rearm();
+	// Idle until Woken, the Scheduler skips this Process meanwhile
+	while (process_list[pid] == PROCESS_SLEEPING) {
+		acct_idle();
+		asm volatile("sti; hlt; cli" : : : "memory");
+	}
+}
+
+/* process_wake()
+ * Make a Sleeping Process Runnable again. Safe from IRQ Context and as
+ * a Timer Callback.
+ *
+ * Inputs: pid - Process to Wake
+ * Outputs: None
+ */
+void process_wake(uint32_t pid) {
+	if (process_list[pid] == PROCESS_SLEEPING) {
+		process_list[pid] = 1;
+		trace(TRACE_SCHED, TR_WAKEUP, pid);
+		// It may need a Slice Boundary to get the CPU
+		pit_rearm();
+	}
+}
+
+/* process_wake_interactive()
+ * Wake a Process that was Waiting for the User. Under MLFQ it goes
+ * back to the Highest Level its nice Value Allows, so it Preempts
+ * CPU-bound Processes and Echoes Promptly.
+ *
+ * Inputs: pid - Process to Wake
+ * Outputs: None
+ */
+void process_wake_interactive(uint32_t pid) {
+#if SCHED_POLICY == SCHED_MLFQ
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * pid));
+	if (process_list[pid] == PROCESS_SLEEPING) pcb->level = pcb->nice;
+#endif
+	process_wake(pid);
+}
+
+/* group_pcb()
+ * PCB of the Running Program's Thread Group Leader, which holds the
+ * FD Table, Arguments and I/O Rings every Thread of the Program Uses
+ *
+ * Inputs: None
+ * Outputs: Leader's PCB, the Running Process' own if it has no Threads
+ */
+pcb_struct_t* group_pcb(void) {
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid)));
+	return (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * pcb->tgid));
+}
+
+/* kmutex_lock()
+ * Take a Sleeping Lock, Blocking while another Process Holds it
+ *
+ * Inputs: m - Lock
+ * Outputs: None
+ */
+void kmutex_lock(kmutex_t* m) {
+	uint32_t flags;
+
+	cli_and_save(flags);
+	while (m->locked) {
+		m->waiters |= 1 << current_pid;
+		process_sleep();
+	}
+	m->locked = 1;
+	restore_flags(flags);
+}
+
+/* kmutex_unlock()
+ * Release a Sleeping Lock and Wake every Waiter to Retry
+ *
+ * Inputs: m - Lock
+ * Outputs: None
+ */
+void kmutex_unlock(kmutex_t* m) {
+	uint32_t flags, waiters, pid;
+
+	cli_and_save(flags);
+	m->locked = 0;
+	waiters = m->waiters;
+	m->waiters = 0;
+	for (pid = 0; waiters != 0; pid++, waiters >>= 1) {
+		if (waiters & 1) process_wake(pid);
+	}
+	restore_flags(flags);
+}
+
+/* process_alarm()
+ * Timer Callback for alarm(). Signals are not Delivered, so the Alarm
+ * is Recorded and Interrupts the Process' current or next sleep().
+ *
+ * Inputs: pid - Process whose Alarm Expired
+ * Outputs: None
+ */
+void process_alarm(uint32_t pid) {
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * pid));
+	pcb->alarm_pending = 1;
+	process_wake(pid);
+}
+
 
 /* init_fdops()
  * Initialize the FD's Function Table Pointers
@@ -58,6 +189,7 @@ void init_fdops() {
 	file_op.read = &read_file;
 	file_op.write = &write_file;
 	file_op.close = &close_file;
+	file_op.readv = &read_file_v;
 
 	/* Map Terminal STDIN Functions */
 	stdin_op.open = &terminal_open;
@@ -70,6 +202,54 @@ void init_fdops() {
 	stdout_op.read = &terminal_read_invalid;
 	stdout_op.write = &terminal_write;
 	stdout_op.close = &terminal_close;
+
+	/* Map Serial Port Functions */
+	serial_op.open = &serial_open;
+	serial_op.read = &serial_read;
+	serial_op.write = &serial_write;
+	serial_op.close = &serial_close;
+
+	/* Map Trace Ring Functions */
+	trace_op.open = &trace_open;
+	trace_op.read = &trace_read;
+	trace_op.write = &trace_write;
+	trace_op.close = &trace_close;
+
+	/* Map Profiler Functions */
+	prof_op.open = &prof_open;
+	prof_op.read = &prof_read;
+	prof_op.write = &prof_write;
+	prof_op.close = &prof_close;
+}
+
+/* syscall_enter()
+ * Called by syscall_wrapper before Dispatching
+ *
+ * Inputs: cs - Saved CS of the Caller
+ *         nr - System Call Number
+ * Outputs: None
+ */
+void syscall_enter(uint32_t cs, int32_t nr) {
+	// Count the Call and Charge the User Time before it
+	acct_syscall(cs);
+	trace(TRACE_SYSCALL, TR_SYSCALL_ENTER, nr);
+	// A Thread whose Program is Halting Starts no new Call
+	thread_check(cs);
+}
+
+/* syscall_exit()
+ * Called by syscall_wrapper before Returning to the Caller
+ *
+ * Inputs:  cs - Saved CS of the Caller
+ *         ret - Return Value
+ * Outputs: None
+ */
+void syscall_exit(uint32_t cs, int32_t ret) {
+	// Charge the System Call to the Kernel
+	acct_charge(0);
+	trace(TRACE_SYSCALL, TR_SYSCALL_EXIT, ret);
+	// Stop here if a Sibling Halted the Program during the Call
+	thread_check(cs);
 }
 
 /* syscall_err()
@@ -100,11 +280,15 @@ int32_t halt(uint8_t status) {
 	// Parent's ESP, EBP
 	uint32_t parent_esp, parent_ebp;
 	
+	// End the Program's other Threads; if a Thread Halts, the Program
+	// Ends through its Leader's PCB
+	thread_group_exit();
+	
 	// Disable Interrupts
 	cli();
 	
 	// Get the PCB
-	pcb_struct_t * pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid)));
+	pcb_struct_t * pcb = group_pcb();
 	// Get Process ID
 	pid = pcb->pid;
 	
@@ -114,6 +298,9 @@ int32_t halt(uint8_t status) {
 	process_list[pid] = 0;
 	// De-activate PCB
 	pcb->state = 0;
+	// Disarm Timers
+	timer_del(&pcb->sleep_timer);
+	timer_del(&pcb->alarm_timer);
 	
 	// Restore Parent's PID as the Active Process for this Terminal
 	term_process[get_process()] = pcb->parent_pid;
@@ -136,13 +323,16 @@ int32_t halt(uint8_t status) {
 	// Get the Parent's PID
 	parent_pid = pcb->parent_pid;
 	
-	// Switch Page Mapping to Parent Executable
-	switch_task(parent_pid);
+	// Switch Page Mapping to Parent Executable, which may be a Thread
+	switch_task(((pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * parent_pid)))->tgid);
 	
 	// Extract Parent ESP/EBP
 	parent_esp = pcb->parent_sp;
 	parent_ebp = pcb->parent_bp;
 	
+	// Charge the Halting Process
+	acct_charge(0);
+	
 	// Set Current Process to Parent
 	current_pid = parent_pid;
 
@@ -292,10 +482,22 @@ int32_t execute(const uint8_t* command) {
 	// Allocate PCB for this Process
 	pcb_struct_t * pcb = (pcb_struct_t *) (PCB_BASE_ADDR - M_8KB * pid);
 	
+	// Charge the Caller before the new Process takes over
+	acct_charge(0);
+	
 	// Activate PCB
 	pcb->state = 1;
 	// Set Process ID
 	pcb->pid = pid;
+	// Lead a Group of its own, without Threads yet
+	pcb->tgid = pid;
+	pcb->join_pid = 0;
+	pcb->futex_key = 0;
+	pcb->exit_pid = 0;
+	// Reset Counters and Record the Name
+	memset(&pcb->acct, 0, sizeof(proc_acct_t));
+	memset(pcb->name, 0, STAT_NAME_LEN);
+	memcpy(pcb->name, elfname, strlen((int8_t*) elfname));
 	// Set Current PID
 	current_pid = pid;
 	// Set Associated Terminal
@@ -314,6 +516,14 @@ int32_t execute(const uint8_t* command) {
 	}
 	pcb->argbuf[arg_idx] = '\0';
 	
+	// Initialize Timers
+	timer_setup(&pcb->sleep_timer, process_wake, pid);
+	timer_setup(&pcb->alarm_timer, process_alarm, pid);
+	pcb->alarm_pending = 0;
+	
+	// Empty the I/O Rings
+	ioring_init();
+	
 	// Load ESP to PCB
 	asm volatile(
 	"movl %%esp, %%eax ;"
@@ -340,6 +550,13 @@ int32_t execute(const uint8_t* command) {
 		term_process[get_process()] = current_pid;
 	}
 		
+	// Start at the Top Level, inheriting the Parent's nice Value
+	pcb->nice = 0;
+	if (pcb->parent_pid != 0) {
+		pcb->nice = ((pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * pcb->parent_pid)))->nice;
+	}
+	pcb->level = pcb->nice;
+	
 	// Initialize File Descriptor
 	for (i = 0; i < FD_MAX; i++) {
 		pcb->fd_array[i].inode = 0;
@@ -357,6 +574,9 @@ int32_t execute(const uint8_t* command) {
 	tss.esp0 = M_8MB - M_8KB * pid - S_INT;
 	tss.ss0 = KERNEL_DS;
 
+	// A new Shell adds a Runnable Process, which may need a Slice
+	pit_rearm();
+
 	// Re-Enable Interrupts
 	sti();
 	
@@ -397,27 +617,28 @@ int32_t execute(const uint8_t* command) {
 int32_t read(int32_t fd, void* buf, int32_t nbytes) {
 	// Check the Validty of FD
 	if ((fd < 0) || (fd > FD_MAX - 1) || (fd == 1)) {
-		printf("SYSCALL.READ: FATAL - Invalid FD %d \n", fd);
+		klog(KLOG_ERR, "SYSCALL.READ: FATAL - Invalid FD %d \n", fd);
 		return -1;
 	}
 	// Check that nbytes is Positive
 	if (nbytes < 0) {
-		printf("SYSCALL.READ: FATAL - Negative NBYTES %d \n", nbytes);
+		klog(KLOG_ERR, "SYSCALL.READ: FATAL - Negative NBYTES %d \n", nbytes);
 		return -1;
 	}
-	pcb_struct_t * pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid)));
+	pcb_struct_t * pcb = group_pcb();
 	// Check the FD's Flags
 	if (pcb->fd_array[fd].flags == 0) {
-		printf("SYSCALL.READ: FATAL - FD %d has Invalid Flag \n", fd);
+		klog(KLOG_ERR, "SYSCALL.READ: FATAL - FD %d has Invalid Flag \n", fd);
 		return -1;
 	}
 	// Check that Buffer is not a NULL Pointer
 	if (buf == NULL) {
-		printf("SYSCALL.READ: FATAL - Buffer is a NULL Pointer \n", fd);
+		klog(KLOG_ERR, "SYSCALL.READ: FATAL - Buffer is a NULL Pointer \n");
 		return -1;
 	}
 	int32_t read_ret_value = (*(pcb->fd_array[fd].function_table->read))(pcb->fd_array[fd].inode, pcb->fd_array[fd].file_position, buf, nbytes);
 	pcb->fd_array[fd].file_position += read_ret_value;
+	if (read_ret_value > 0) pcb->acct.bytes_read += read_ret_value;
 	return read_ret_value;
 }
 
@@ -432,26 +653,28 @@ int32_t read(int32_t fd, void* buf, int32_t nbytes) {
 int32_t write(int32_t fd, const void* buf, int32_t nbytes) {
 	// Check the Validty of FD
 	if ((fd < 1) || (fd > FD_MAX - 1) || (fd == 0)) {
-		printf("SYSCALL.WRITE: FATAL - Invalid FD %d \n", fd);
+		klog(KLOG_ERR, "SYSCALL.WRITE: FATAL - Invalid FD %d \n", fd);
 		return -1;
 	}
 	// Check that nbytes is Positive
 	if (nbytes < 0) {
-		printf("SYSCALL.WRITE: FATAL - Negative NBYTES %d \n", nbytes);
+		klog(KLOG_ERR, "SYSCALL.WRITE: FATAL - Negative NBYTES %d \n", nbytes);
 		return -1;
 	}
-	pcb_struct_t * pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid)));
+	pcb_struct_t * pcb = group_pcb();
 	// Check the FD's Flags
 	if (pcb->fd_array[fd].flags == 0) {
-		printf("SYSCALL.WRITE: FATAL - FD %d has Invalid Flag \n", fd);
+		klog(KLOG_ERR, "SYSCALL.WRITE: FATAL - FD %d has Invalid Flag \n", fd);
 		return -1;
 	}
 	// Check that Buffer is not a NULL Pointer
 	if (buf == NULL) {
-		printf("SYSCALL.WRITE: FATAL - Buffer is a NULL Pointer \n");
+		klog(KLOG_ERR, "SYSCALL.WRITE: FATAL - Buffer is a NULL Pointer \n");
 		return -1;
 	}
-	return (*(pcb->fd_array[fd].function_table->write))(buf, nbytes);
+	int32_t write_ret_value = (*(pcb->fd_array[fd].function_table->write))(pcb->fd_array[fd].inode, buf, nbytes);
+	if (write_ret_value > 0) pcb->acct.bytes_written += write_ret_value;
+	return write_ret_value;
 }
 
 /* open()
@@ -464,12 +687,46 @@ int32_t write(int32_t fd, const void* buf, int32_t nbytes) {
 int32_t open(const uint8_t* filename) {
 	// Dentry Corresponding to File Name
 	dentry_t open_dentry;
+	// Device not Backed by the File System, if any
+	op_table_t* dev_op = NULL;
+	int32_t dev_flag = 0;
 	// Generic Loop Counter
 	int i;
 	
 	// Check that Filename is not a NULL Pointer
 	if (filename == NULL) {
-		printf("SYSCALL.OPEN: FATAL - Filename is a NULL Pointer \n");
+		klog(KLOG_ERR, "SYSCALL.OPEN: FATAL - Filename is a NULL Pointer \n");
+		return -1;
+	}
+	
+	// Get Current PCB
+	pcb_struct_t * pcb = group_pcb();
+
+	// The Serial Port, Trace Ring and Profiler are not Backed by the File System
+	if (0 == strncmp((const int8_t*) filename, (const int8_t*) SERIAL_DEV_NAME, FNAME_LEN_MAX)) {
+		dev_op = &serial_op;
+		dev_flag = SERIAL_FLAG;
+	}
+	else if (0 == strncmp((const int8_t*) filename, (const int8_t*) TRACE_DEV_NAME, FNAME_LEN_MAX)) {
+		dev_op = &trace_op;
+		dev_flag = TRACE_FLAG;
+	}
+	else if (0 == strncmp((const int8_t*) filename, (const int8_t*) PROF_DEV_NAME, FNAME_LEN_MAX)) {
+		dev_op = &prof_op;
+		dev_flag = PROF_FLAG;
+	}
+	if (dev_op != NULL) {
+		for (i = 2; i < FD_MAX; i++) {
+			if (pcb->fd_array[i].flags == 0) {
+				pcb->fd_array[i].function_table = dev_op;
+				pcb->fd_array[i].inode = 0;
+				pcb->fd_array[i].file_position = 0;
+				pcb->fd_array[i].flags = dev_flag;
+				(*(pcb->fd_array[i].function_table->open))(filename);
+				return i;
+			}
+		}
+		klog(KLOG_ERR, "SYSCALL.OPEN: FATAL - Out of FD Slots \n");
 		return -1;
 	}
 	
@@ -478,12 +735,9 @@ int32_t open(const uint8_t* filename) {
 	
 	// Check if we found it
 	if (read_return == -1) {
-		printf("SYSCALL.OPEN: FATAL - File Name: %s not Found \n", filename);
+		klog(KLOG_ERR, "SYSCALL.OPEN: FATAL - File not Found \n");
 		return -1;
 	}
-	
-	// Get Current PCB
-	pcb_struct_t * pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid)));
 
 	// Attempt to Allocate an Empty Slot in FD for this File
 	for (i = 2; i < FD_MAX; i++) {
@@ -491,12 +745,16 @@ int32_t open(const uint8_t* filename) {
 		if (pcb->fd_array[i].flags == 0) {
 		// Slot is Available, check for the File Type
 			if (open_dentry.file_type == FTYPE_RTC) {
-				// File Name is RTC
+				// File Name is RTC, get a Virtual RTC for this FD
+				int32_t vrtc = (*(rtc_op.open))(filename);
+				if (vrtc == -1) {
+					klog(KLOG_ERR, "SYSCALL.OPEN: FATAL - Out of Virtual RTCs \n");
+					return -1;
+				}
 				pcb->fd_array[i].function_table = &rtc_op;
-				pcb->fd_array[i].inode = 0;
+				pcb->fd_array[i].inode = vrtc;
 				pcb->fd_array[i].file_position = 0;
 				pcb->fd_array[i].flags = RTC_FLAG;
-				(*(pcb->fd_array[i].function_table->open))(filename);
 				return i;
 			}
 			if(open_dentry.file_type == FTYPE_DIRECTORY) {
@@ -508,9 +766,14 @@ int32_t open(const uint8_t* filename) {
 				return i;
 			}
 			if(open_dentry.file_type == FTYPE_REGULAR) {
-				// Open the Regular File
+				// Open the Regular File, the Handle Names its Extent Map
+				int32_t handle = (*(file_op.open))(filename);
+				if (handle == -1) {
+					klog(KLOG_ERR, "SYSCALL.OPEN: FATAL - Cannot Open File \n");
+					return -1;
+				}
 				pcb->fd_array[i].function_table = &file_op;
-				pcb->fd_array[i].inode = open_dentry.inode_index;
+				pcb->fd_array[i].inode = handle;
 				pcb->fd_array[i].file_position = 0;
 				pcb->fd_array[i].flags = FILE_FLAG;
 				return i;
@@ -519,7 +782,7 @@ int32_t open(const uint8_t* filename) {
 	}
 	
 	// No Slot Available
-	printf("SYSCALL.OPEN: FATAL - Out of FD Slots \n");
+	klog(KLOG_ERR, "SYSCALL.OPEN: FATAL - Out of FD Slots \n");
 	return -1;
 }
 
@@ -532,17 +795,17 @@ int32_t open(const uint8_t* filename) {
 int32_t close(int32_t fd) {
 	// Check the Validty of FD
 	if ((fd < 0) || (fd > FD_MAX - 1) || (fd == 0) || (fd == 1)) {
-		printf("SYSCALL.CLOSE: FATAL - Invalid FD %d \n", fd);
+		klog(KLOG_ERR, "SYSCALL.CLOSE: FATAL - Invalid FD %d \n", fd);
 		return -1;
 	}
 	// Get Current PCB
-	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid)));
+	pcb_struct_t *pcb = group_pcb();
 	// Check the FD's Flags
 	if (pcb->fd_array[fd].flags == 0) {
-		printf("SYSCALL.CLOSE: FATAL - FD %d has Invalid Flag \n", fd);
+		klog(KLOG_ERR, "SYSCALL.CLOSE: FATAL - FD %d has Invalid Flag \n", fd);
 		return -1;
 	}
-	int ret = (*(pcb->fd_array[fd].function_table->close))();
+	int ret = (*(pcb->fd_array[fd].function_table->close))(pcb->fd_array[fd].inode);
 	// Reset Flags to 0 on a Successful Close
 	if (ret != -1) {
 		pcb->fd_array[fd].flags = 0;
@@ -564,7 +827,7 @@ int32_t getargs(uint8_t* buf, int32_t nbytes) {
 		return -1;
 	}
 	// Check if there are arguments in PCB waiting to be copied
-	pcb_struct_t * pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid)));
+	pcb_struct_t * pcb = group_pcb();
 	if (pcb->arg_length <= 0) {
 		printf("SYSCALL.GETARGS: FATAL - PCB has no Arguments \n");
 		return -1;
@@ -621,6 +884,443 @@ int32_t sigreturn(void) {
 	return -1;
 }
 
+/* sleep()
+ * Block the Calling Process for at least ms Milliseconds. Other
+ * Processes run meanwhile, and the CPU Halts if there is none.
+ *
+ * Inputs: ms - Time to Sleep
+ * Outputs: 0 after the full Time, or the Milliseconds left if an
+ *          Alarm Interrupted the Sleep
+ */
+int32_t sleep(uint32_t ms) {
+	uint32_t flags;
+	int32_t remaining = 0;
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid)));
+	
+	if (ms == 0) return 0;
+	if (ms > TIMER_MAX_DELAY) ms = TIMER_MAX_DELAY;
+	
+	cli_and_save(flags);
+	// An Alarm that Fired before the Sleep Interrupts it at once
+	if (pcb->alarm_pending) {
+		pcb->alarm_pending = 0;
+		restore_flags(flags);
+		return ms;
+	}
+	
+	// One extra Jiffy, as the current one is already partly over
+	timer_add(&pcb->sleep_timer, jiffies + ms + 1);
+	
+	// Woken by the Sleep Timer or the Alarm
+	process_sleep();
+	
+	// Woken Early by the Alarm
+	if (timer_del(&pcb->sleep_timer)) {
+		remaining = pcb->sleep_timer.expires - jiffies;
+		if (remaining < 0) remaining = 0;
+		pcb->alarm_pending = 0;
+	}
+	restore_flags(flags);
+	return remaining;
+}
+
+/* alarm()
+ * Arm the Process' Alarm, replacing any earlier one
+ *
+ * Inputs: ms - Milliseconds until the Alarm, 0 Cancels it
+ * Outputs: Milliseconds that were left on the previous Alarm
+ */
+int32_t alarm(uint32_t ms) {
+	uint32_t flags;
+	int32_t remaining = 0;
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid)));
+	
+	if (ms > TIMER_MAX_DELAY) ms = TIMER_MAX_DELAY;
+	
+	cli_and_save(flags);
+	if (timer_del(&pcb->alarm_timer)) {
+		remaining = pcb->alarm_timer.expires - jiffies;
+		if (remaining < 0) remaining = 0;
+	}
+	pcb->alarm_pending = 0;
+	if (ms != 0) timer_add(&pcb->alarm_timer, jiffies + ms);
+	restore_flags(flags);
+	return remaining;
+}
+
+/* clock_gettime()
+ * Read the Monotonic Clock
+ *
+ * Inputs: clk_id - Must be CLOCK_MONOTONIC
+ *             ts - User Buffer for the Time since Boot
+ * Outputs: 0 on Success, -1 on Fail
+ */
+int32_t clock_gettime(int32_t clk_id, timespec_t* ts) {
+	if (clk_id != CLOCK_MONOTONIC) {
+		klog(KLOG_ERR, "SYSCALL.CLOCK_GETTIME: FATAL - Unsupported Clock \n");
+		return -1;
+	}
+	// Check that the Buffer is within the User Page
+	if ((((uint32_t) ts) >> PD_OFFSET) != USER_DIR ||
+		(((uint32_t) ts + sizeof(timespec_t) - 1) >> PD_OFFSET) != USER_DIR) {
+		klog(KLOG_ERR, "SYSCALL.CLOCK_GETTIME: FATAL - Pointer Out of Range \n");
+		return -1;
+	}
+	timer_gettime(ts);
+	return 0;
+}
+
+/* set_quantum()
+ * Set the Scheduler Time Slice
+ *
+ * Inputs: us - Slice in Microseconds, 0 only Queries it
+ * Outputs: Previous Slice in Microseconds
+ */
+int32_t set_quantum(uint32_t us) {
+	return pit_set_quantum(us);
+}
+
+/* nice()
+ * Lower (or Raise) the Running Process' Priority. Under MLFQ the
+ * Process never Runs above Level nice; round-robin Ignores it.
+ *
+ * Inputs: inc - Added to the nice Value, which is Clamped to 0..NICE_MAX
+ * Outputs: New nice Value
+ */
+int32_t nice(int32_t inc) {
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid)));
+	int32_t value = (int32_t) pcb->nice + inc;
+	
+	if (value < 0) value = 0;
+	if (value > NICE_MAX) value = NICE_MAX;
+	pcb->nice = value;
+	if (pcb->level < pcb->nice) pcb->level = pcb->nice;
+	// A Raised Priority may Preempt, a Lowered one may Yield
+	pit_rearm();
+	return value;
+}
+
+#if SCHED_POLICY == SCHED_MLFQ
+/* sched_boost()
+ * Anti-Starvation Timer, moves every Process back to its Top Level
+ *
+ * Inputs: None Effective
+ * Outputs: None
+ */
+static void sched_boost(uint32_t data) {
+	int i;
+	pcb_struct_t *pcb;
+	for (i = 1; i < MAX_TASK_NUM; i++) {
+		if (process_list[i] == 0) continue;
+		pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * i));
+		pcb->level = pcb->nice;
+	}
+	timer_add(&sched_boost_timer, sched_boost_timer.expires + MLFQ_BOOST_MS);
+}
+#endif
+
+/* sched_init()
+ * Start the Scheduler's Periodic Work
+ *
+ * Input: None
+ * Output: None
+ */
+void sched_init(void) {
+#if SCHED_POLICY == SCHED_MLFQ
+	timer_setup(&sched_boost_timer, sched_boost, 0);
+	timer_add(&sched_boost_timer, jiffies + MLFQ_BOOST_MS);
+#endif
+}
+
+/* sched_slice()
+ * Slice of a Process. Lower MLFQ Levels get longer Slices.
+ *
+ * Input:     pid - Process the Slice is for
+ *        quantum - Base Slice in PIT Counts
+ * Output: Slice in PIT Counts
+ */
+uint32_t sched_slice(int pid, uint32_t quantum) {
+#if SCHED_POLICY == SCHED_MLFQ
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (pid)));
+	if (quantum > (0xFFFFFFFF >> pcb->level)) return 0xFFFFFFFF;
+	return quantum << pcb->level;
+#else
+	return quantum;
+#endif
+}
+
+/* sched_slice_expired()
+ * Demote the Running Process, it used its whole Slice
+ *
+ * Input: None
+ * Output: None
+ */
+void sched_slice_expired(void) {
+#if SCHED_POLICY == SCHED_MLFQ
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid)));
+	if (pcb->level < MLFQ_LEVELS - 1) pcb->level++;
+#endif
+}
+
+/* sched_preempt()
+ * Check for a Runnable Process on a Higher Level than the Running one
+ *
+ * Input: None
+ * Output: 1 if the Running Process should be Preempted
+ */
+int sched_preempt(void) {
+#if SCHED_POLICY == SCHED_MLFQ
+	int i;
+	uint32_t level;
+	if (current_pid == 0) return 0;
+	level = ((pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (current_pid))))->level;
+	for (i = 1; i < MAX_TASK_NUM; i++) {
+		if (process_list[i] == 1 &&
+			((pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * i)))->level < level)
+			return 1;
+	}
+#endif
+	return 0;
+}
+
+/* getstat()
+ * Snapshot Kernel Statistics into a User Buffer
+ *
+ * Inputs: which - STAT_* Selector
+ *           buf - User Buffer
+ *        nbytes - Size of buf
+ * Outputs: Bytes Copied, -1 on Fail
+ */
+int32_t getstat(uint32_t which, void* buf, int32_t nbytes) {
+	// Check that the Buffer is within the User Page
+	if (nbytes <= 0 || (((uint32_t) buf) >> PD_OFFSET) != USER_DIR ||
+		(((uint32_t) buf + nbytes - 1) >> PD_OFFSET) != USER_DIR) {
+		klog(KLOG_ERR, "SYSCALL.GETSTAT: FATAL - Pointer Out of Range \n");
+		return -1;
+	}
+	return stats_snapshot(which, buf, nbytes);
+}
+
+/* iov_import()
+ * Copy a User iovec Array into the Kernel and Check every Segment
+ *
+ * Inputs:   uiov - User Array
+ *         iovcnt - Number of Segments, at most IOV_MAX
+ *           kiov - Kernel Copy
+ * Outputs: Total Bytes, -1 if the Array or a Segment is Invalid
+ */
+static int32_t iov_import(const iovec_t* uiov, int32_t iovcnt, iovec_t* kiov) {
+	uint32_t base;
+	int32_t i, total = 0;
+	
+	if (iovcnt <= 0 || iovcnt > IOV_MAX || (((uint32_t) uiov) >> PD_OFFSET) != USER_DIR ||
+		(((uint32_t) (uiov + iovcnt) - 1) >> PD_OFFSET) != USER_DIR) {
+		return -1;
+	}
+	memcpy(kiov, uiov, iovcnt * sizeof(iovec_t));
+	for (i = 0; i < iovcnt; i++) {
+		base = (uint32_t) kiov[i].base;
+		if (kiov[i].len < 0 || kiov[i].len > INT32_MAX - total) return -1;
+		if (kiov[i].len > 0 && ((base >> PD_OFFSET) != USER_DIR ||
+			((base + kiov[i].len - 1) >> PD_OFFSET) != USER_DIR)) {
+			return -1;
+		}
+		total += kiov[i].len;
+	}
+	return total;
+}
+
+/* readv()
+ * Read into several Buffers with one Call. Segments are Filled in
+ * Order and the Call Stops at the first Short Read.
+ *
+ * Inputs:     fd - The Index of the File Descriptor Array
+ *            iov - Array of Segments
+ *         iovcnt - Number of Segments, at most IOV_MAX
+ * Outputs: Bytes Read, -1 on Fail
+ */
+int32_t readv(int32_t fd, const iovec_t* iov, int32_t iovcnt) {
+	iovec_t kiov[IOV_MAX];
+	file_desc_t* f;
+	int32_t i, ret, total = 0;
+	
+	// Check the Validty of FD
+	if ((fd < 0) || (fd > FD_MAX - 1) || (fd == 1)) {
+		klog(KLOG_ERR, "SYSCALL.READV: FATAL - Invalid FD %d \n", fd);
+		return -1;
+	}
+	pcb_struct_t * pcb = group_pcb();
+	f = &pcb->fd_array[fd];
+	if (f->flags == 0) {
+		klog(KLOG_ERR, "SYSCALL.READV: FATAL - FD %d has Invalid Flag \n", fd);
+		return -1;
+	}
+	if (-1 == iov_import(iov, iovcnt, kiov)) {
+		klog(KLOG_ERR, "SYSCALL.READV: FATAL - Invalid iovec \n");
+		return -1;
+	}
+	
+	if (f->function_table->readv != NULL) {
+		total = f->function_table->readv(f->inode, f->file_position, kiov, iovcnt);
+	}
+	else {
+		for (i = 0; i < iovcnt; i++) {
+			ret = f->function_table->read(f->inode, f->file_position + total, kiov[i].base, kiov[i].len);
+			// Report an Error only if Nothing was Read
+			if (ret < 0) {
+				if (total == 0) total = -1;
+				break;
+			}
+			total += ret;
+			if (ret < kiov[i].len) break;
+		}
+	}
+	if (total > 0) {
+		f->file_position += total;
+		pcb->acct.bytes_read += total;
+	}
+	return total;
+}
+
+/* writev()
+ * Write several Buffers with one Call, in Order
+ *
+ * Inputs:     fd - The Index of the File Descriptor Array
+ *            iov - Array of Segments
+ *         iovcnt - Number of Segments, at most IOV_MAX
+ * Outputs: Bytes Written, -1 on Fail
+ */
+int32_t writev(int32_t fd, const iovec_t* iov, int32_t iovcnt) {
+	iovec_t kiov[IOV_MAX];
+	file_desc_t* f;
+	int32_t i, ret, total = 0;
+	
+	// Check the Validty of FD
+	if ((fd < 1) || (fd > FD_MAX - 1)) {
+		klog(KLOG_ERR, "SYSCALL.WRITEV: FATAL - Invalid FD %d \n", fd);
+		return -1;
+	}
+	pcb_struct_t * pcb = group_pcb();
+	f = &pcb->fd_array[fd];
+	if (f->flags == 0) {
+		klog(KLOG_ERR, "SYSCALL.WRITEV: FATAL - FD %d has Invalid Flag \n", fd);
+		return -1;
+	}
+	if (-1 == iov_import(iov, iovcnt, kiov)) {
+		klog(KLOG_ERR, "SYSCALL.WRITEV: FATAL - Invalid iovec \n");
+		return -1;
+	}
+	
+	for (i = 0; i < iovcnt; i++) {
+		ret = f->function_table->write(f->inode, kiov[i].base, kiov[i].len);
+		if (ret < 0) {
+			if (total == 0) total = -1;
+			break;
+		}
+		total += ret;
+		if (ret < kiov[i].len) break;
+	}
+	if (total > 0) pcb->acct.bytes_written += total;
+	return total;
+}
+
+/* sendfile_actor()
+ * fs_splice() Consumer: Write a Block Straight to the Output FD
+ */
+static int32_t sendfile_actor(void* ctx, const uint8_t* data, int32_t len) {
+	file_desc_t* out = (file_desc_t*) ctx;
+	return out->function_table->write(out->inode, data, len);
+}
+
+/* sendfile()
+ * Copy a File to another FD inside the Kernel. The Output Driver's
+ * write() gets the File System Blocks in Place, so the Data never
+ * Passes through a User Buffer.
+ *
+ * Inputs: out_fd - Destination FD
+ *          in_fd - Source FD, must be a Regular File
+ *         offset - Where to Start, Updated on Return; NULL to Use and
+ *                  Advance in_fd's File Position
+ *          count - Most Bytes to Copy
+ * Outputs: Bytes Copied, -1 on Fail
+ */
+int32_t sendfile(int32_t out_fd, int32_t in_fd, uint32_t* offset, int32_t count) {
+	file_desc_t *in, *out;
+	uint32_t pos;
+	int32_t ret;
+	
+	// Check the Validty of the FDs
+	if ((out_fd < 1) || (out_fd > FD_MAX - 1) || (in_fd < 0) || (in_fd > FD_MAX - 1) || (in_fd == 1)) {
+		klog(KLOG_ERR, "SYSCALL.SENDFILE: FATAL - Invalid FD \n");
+		return -1;
+	}
+	if (count < 0) {
+		klog(KLOG_ERR, "SYSCALL.SENDFILE: FATAL - Negative COUNT %d \n", count);
+		return -1;
+	}
+	pcb_struct_t * pcb = group_pcb();
+	in = &pcb->fd_array[in_fd];
+	out = &pcb->fd_array[out_fd];
+	if (in->flags == 0 || out->flags == 0) {
+		klog(KLOG_ERR, "SYSCALL.SENDFILE: FATAL - FD has Invalid Flag \n");
+		return -1;
+	}
+	// Only Regular Files can be Read in Place
+	if (in->function_table != &file_op) return -1;
+	if (offset != NULL && ((((uint32_t) offset) >> PD_OFFSET) != USER_DIR ||
+		(((uint32_t) (offset + 1) - 1) >> PD_OFFSET) != USER_DIR)) {
+		klog(KLOG_ERR, "SYSCALL.SENDFILE: FATAL - Pointer Out of Range \n");
+		return -1;
+	}
+	
+	pos = (offset != NULL) ? *offset : (uint32_t) in->file_position;
+	ret = fs_splice(in->inode, pos, count, sendfile_actor, out);
+	if (ret > 0) {
+		if (offset != NULL) *offset = pos + ret;
+		else in->file_position += ret;
+		pcb->acct.bytes_read += ret;
+		pcb->acct.bytes_written += ret;
+	}
+	return ret;
+}
+
+/* process_state()
+ * Read a Process' Scheduling State
+ *
+ * Input: pid - Process ID
+ * Output: process_list Entry, 0 if the Slot is Free
+ */
+int process_state(int pid) {
+	if (pid <= 0 || pid >= MAX_TASK_NUM) return 0;
+	return process_list[pid];
+}
+
+/* nr_runnable()
+ * Count the Processes the Scheduler may Pick
+ *
+ * Input: None
+ * Output: Number of Runnable Processes
+ */
+int nr_runnable(void) {
+	int i, n = 0;
+	for (i = 1; i < MAX_TASK_NUM; i++) {
+		if (process_list[i] == 1) n++;
+	}
+	return n;
+}
+
+/* current_runnable()
+ * Check whether the Running Process may keep the CPU
+ *
+ * Input: None
+ * Output: 1 if Runnable, 0 if it Blocked
+ */
+int current_runnable(void) {
+	// The Boot Context keeps the CPU until the first Shell
+	if (current_pid == 0) return 1;
+	return process_list[current_pid] == 1;
+}
+
 /* schedule()
  * Switch the Process being Executed for the next Time Quantum
  *
@@ -628,20 +1328,27 @@ int32_t sigreturn(void) {
  * Output: None
  */
 int schedule(void) {
+	// The Boot Context is not a Task, it runs until the first Shell
+	if (current_pid == 0) return 0;
 	// Find the Next Active Process to Schedule
 	int _next_pid = find_next_pid(current_pid);
-	if ((_next_pid == -1) || (_next_pid == 0)){
+	// Every Process is Blocked, keep Idling in the current one
+	if (_next_pid == -1) return 0;
+	if (_next_pid == 0){
 		printf("SCHEDULE - FATAL: No Active Process \n");
 		return -1;
 	}
+	// Only one Process is Runnable and it is already Running
+	if (_next_pid == current_pid) return 0;
 	if (VERBOSE) {
 		// Debug Information
 		display_processes(process_list, _next_pid);
 	}
 	// Fetch the PCB for the Next Process
 	pcb_struct_t *next_pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (_next_pid)));
-	// Call Context Switch Helper
-	switch_process(next_pcb->term);
+	// Call Context Switch Helper, Kernel Threads Print to the Terminal
+	// of the Process they Interrupted
+	if (!IS_KTHREAD(_next_pid)) switch_process(next_pcb->term);
 	context_switch(_next_pid);
 
 	return 0;
@@ -661,6 +1368,10 @@ void context_switch(int term) {
 	int next_pid = find_next_pid(current_pid);
 	pcb_struct_t *next_pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * (next_pid)));
 	
+	// Charge the outgoing Process
+	acct_switch();
+	trace(TRACE_SCHED, TR_SWITCH, next_pid);
+	
 	// Save the Base and Stack Pointers
 	asm volatile(
 	"movl %%esp, %%eax ;"
@@ -671,9 +1382,13 @@ void context_switch(int term) {
 	: "=a" (current_pcb->bp)
 	);
 
-	// Enable Paging for the next Process
-	switch_task(next_pid);
-	map_video(next_pcb->term);
+	// Enable Paging for the next Process. Kernel Threads keep the
+	// outgoing Process' User Pages as they never Touch them, and
+	// Threads of the Program already Mapped need no CR3 Reload.
+	if (!IS_KTHREAD(next_pid) && next_pcb->tgid != user_page_pid) {
+		switch_task(next_pcb->tgid);
+		map_video(next_pcb->term);
+	}
 	
 	// Store next Process' Kernel Stack into TSS
 	tss.esp0 = M_8MB - M_8KB * next_pid - S_INT;
@@ -709,7 +1424,22 @@ void context_switch(int term) {
  */
 int find_next_pid(int cur_pid) {
 	int i;
-	for (i = cur_pid + 1; i < MAX_PROCESS_NUM; i++) {
+#if SCHED_POLICY == SCHED_MLFQ
+	// Highest Level wins, Round-Robin within a Level, current one Last
+	int k, best = -1;
+	uint32_t level, best_level = MLFQ_LEVELS;
+	for (k = 1; k < MAX_TASK_NUM; k++) {
+		i = (cur_pid - 1 + k) % (MAX_TASK_NUM - 1) + 1;
+		if (process_list[i] != 1) continue;
+		level = ((pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * i)))->level;
+		if (level < best_level) {
+			best = i;
+			best_level = level;
+		}
+	}
+	return best;
+#else
+	for (i = cur_pid + 1; i < MAX_TASK_NUM; i++) {
 		if (process_list[i] == 1)
 			return i;
 	}
@@ -720,5 +1450,6 @@ int find_next_pid(int cur_pid) {
 	
 	// Should Never be Reached
 	return -1;
+#endif
 }
 
@@ -1,14 +1,21 @@
 /* System Calls
- * CTOS Supports 10 System Calls
+ * Handlers for the CTOS System Calls, Numbered by syscall_tbl in irq.S
  */
 
 #include "types.h"
+#include "timer.h"
+#include "stats.h"
+#include "iovec.h"
 
 #ifndef _SYSCALL_H
 #define _SYSCALL_H
 
 /* Maximum Number of Active Processes */
 #define MAX_PROCESS_NUM 7
+/* Kernel Threads take the Slots after the User Processes */
+#define KTHREAD_MAX 3
+#define MAX_TASK_NUM (MAX_PROCESS_NUM + KTHREAD_MAX)
+#define IS_KTHREAD(pid) ((pid) >= MAX_PROCESS_NUM)
 /* Entry Point Offset of ELF Executable in Bytes */
 #define ELF_ENTRY_OFFSET 24
 /* Start Virtual Address of Executable */
@@ -29,10 +36,12 @@
 #define DIRECTORY_FLAG 2
 /* Flag to Indicate the File is a Regular File */
 #define FILE_FLAG 3
-/* File Types */
-#define FTYPE_REGULAR 2
-#define FTYPE_DIRECTORY 1
-#define FTYPE_RTC 0
+/* Flag to Indicate the File is the Serial Port */
+#define SERIAL_FLAG 4
+/* Flag to Indicate the File is the Trace Ring */
+#define TRACE_FLAG 5
+/* Flag to Indicate the File is the Profiler */
+#define PROF_FLAG 6
 
 /* PCB Base Address in Kernel Space */
 #define PCB_BASE_ADDR 0x007FE000
@@ -49,6 +58,25 @@
 
 /* Flag for a Pending Process */
 #define PROCESS_PENDING 2
+/* Flag for a Process Blocked in sleep() */
+#define PROCESS_SLEEPING 3
+/* Flag for a Thread that Exited and was not Joined yet */
+#define PROCESS_ZOMBIE 4
+
+/* Scheduling Policies, chosen at Build Time with SCHED_POLICY */
+#define SCHED_RR 0
+#define SCHED_MLFQ 1
+#ifndef SCHED_POLICY
+#define SCHED_POLICY SCHED_MLFQ
+#endif
+
+/* MLFQ Priority Levels, 0 is the Highest. Level n gets a Slice of
+ * (Quantum << n) */
+#define MLFQ_LEVELS 4
+/* Period of the Anti-Starvation Reset to Level 0 */
+#define MLFQ_BOOST_MS 1000
+/* Highest nice Value, a Process never Runs above Level nice */
+#define NICE_MAX (MLFQ_LEVELS - 1)
 
 /* Array that Stores which Process is Active on each Terminal */ 
 extern uint8_t term_process[TERM_MAX];
@@ -56,12 +84,21 @@ extern uint8_t term_process[TERM_MAX];
 /* PID of Current Running Process */
 extern int current_pid;
 
-/* File Functions Table */
+/* Scheduling State of every Slot, 0 if Free */
+extern uint8_t process_list[MAX_TASK_NUM];
+
+/* File Functions Table
+ * Every Function except open() receives the FD's inode Field, which
+ * Drivers with per-FD State use as a Handle to it. open() returns the
+ * Handle (or -1) for such Drivers.
+ */
 typedef struct op_table_t {
 	int (*open)(const uint8_t* filename);
 	int (*read)(unsigned int inode, unsigned int offset, void* buf, int32_t nbytes);
-	int (*write)(const void* buf, int32_t size);
-	int (*close)(void);
+	int (*write)(unsigned int inode, const void* buf, int32_t size);
+	int (*close)(unsigned int inode);
+	// Optional Vectored read(); NULL Loops over read()
+	int (*readv)(unsigned int inode, unsigned int offset, const iovec_t* iov, int32_t iovcnt);
 } op_table_t;
 
 /* File Functions for Devices */
@@ -70,6 +107,9 @@ extern op_table_t dir_op;
 extern op_table_t file_op;
 extern op_table_t stdin_op;
 extern op_table_t stdout_op;
+extern op_table_t serial_op;
+extern op_table_t trace_op;
+extern op_table_t prof_op;
 
 /* File Descriptor Structure */
 typedef struct file_desc {
@@ -107,11 +147,55 @@ typedef struct pcb_struct {
 	uint32_t sp;
 	// Current Base Pointer
 	uint32_t bp;
+	// Wakes the Process from sleep()
+	ktimer_t sleep_timer;
+	// Timer set by alarm()
+	ktimer_t alarm_timer;
+	// Alarm Fired and has not Interrupted a sleep() yet
+	uint32_t alarm_pending;
+	// MLFQ Level, Lowered each Time a Slice is Used up
+	uint32_t level;
+	// Floor of the MLFQ Level set by nice()
+	uint32_t nice;
+	// Executable Name
+	uint8_t name[STAT_NAME_LEN];
+	// CPU and I/O Counters
+	proc_acct_t acct;
+	// I/O Rings: Next Entry to Run, End of the Submitted Entries, and
+	// Next Completion Slot. The Ring's own Copies are not Trusted.
+	uint32_t io_sq_head;
+	uint32_t io_sq_tail;
+	uint32_t io_cq_tail;
+	// Thread Running Queued Entries, 0 if None
+	uint32_t io_runner;
+	// Kernel Thread Function and its Argument
+	void (*kthread_fn)(uint32_t arg);
+	uint32_t kthread_arg;
+	// Thread Group Leader, whose User Page, FD Table, Arguments and
+	// I/O Rings every Thread of the Program Shares. Its own PID for a
+	// Process.
+	uint32_t tgid;
+	// User Entry Point and Stack of a Thread made by clone()
+	uint32_t user_eip;
+	uint32_t user_esp;
+	// Thread Waiting in thread_join() and the Status this one Exited with
+	uint32_t join_pid;
+	int32_t exit_status;
+	// Physical Address Waited on in futex_wait(), 0 when not Waiting,
+	// and the next Waiter Queued in the same Hash Bucket
+	uint32_t futex_key;
+	struct pcb_struct* futex_next;
+	// Thread Halting the Program, 0 if None. Kept by the Leader.
+	uint32_t exit_pid;
 } pcb_struct_t;
 
 /* Initialize Function Pointers */
 void init_fdops();
 
+/* Entry and Exit Hooks called by syscall_wrapper */
+void syscall_enter(uint32_t cs, int32_t nr);
+void syscall_exit(uint32_t cs, int32_t ret);
+
 /* System Call Handlers */
 
 /* 0. Error */
@@ -147,6 +231,100 @@ int32_t set_handler(int32_t signum, void* handler_address);
 /* 10. Sigreturn */
 int32_t sigreturn(void);
 
+/* 11. Sleep */
+int32_t sleep(uint32_t ms);
+
+/* 12. Alarm */
+int32_t alarm(uint32_t ms);
+
+/* 13. Clock_gettime */
+int32_t clock_gettime(int32_t clk_id, timespec_t* ts);
+
+/* 14. Set Quantum */
+int32_t set_quantum(uint32_t us);
+
+/* 15. Nice */
+int32_t nice(int32_t inc);
+
+/* 16. Getstat */
+int32_t getstat(uint32_t which, void* buf, int32_t nbytes);
+
+/* 17. Io_submit (ioring.c) */
+int32_t io_submit(uint32_t nr);
+
+/* 18. Io_wait (ioring.c) */
+int32_t io_wait(uint32_t min_complete);
+
+/* 19. Readv */
+int32_t readv(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+
+/* 20. Writev */
+int32_t writev(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+
+/* 21. Sendfile */
+int32_t sendfile(int32_t out_fd, int32_t in_fd, uint32_t* offset, int32_t count);
+
+/* 22. Clone (thread.c) */
+int32_t clone(uint32_t entry, uint32_t stack);
+
+/* 23. Thread_exit (thread.c) */
+int32_t thread_exit(int32_t status);
+
+/* 24. Thread_join (thread.c) */
+int32_t thread_join(int32_t tid, int32_t* status);
+
+/* 25. Futex_wait (futex.c) */
+int32_t futex_wait(uint32_t* addr, uint32_t val);
+
+/* 26. Futex_wake (futex.c) */
+int32_t futex_wake(uint32_t* addr, int32_t n);
+
+// PCB of the Running Program's Thread Group Leader
+pcb_struct_t* group_pcb(void);
+
+// Block the current Process until Woken
+void process_sleep(void);
+
+// Make a Sleeping Process Runnable
+void process_wake(uint32_t pid);
+
+// Alarm Timer Callback
+void process_alarm(uint32_t pid);
+
+// Wake a Process that Waited on a User (Terminal or RTC) and Boost it
+void process_wake_interactive(uint32_t pid);
+
+/* Sleeping Lock for Kernel Code that Blocks while Holding it */
+typedef struct kmutex_t {
+	volatile uint32_t locked;
+	// Bit per PID Sleeping on the Lock
+	volatile uint32_t waiters;
+} kmutex_t;
+
+void kmutex_lock(kmutex_t* m);
+void kmutex_unlock(kmutex_t* m);
+
+// Start the Scheduler's Periodic Work
+void sched_init(void);
+
+// Slice of a Process given the Base Quantum
+uint32_t sched_slice(int pid, uint32_t quantum);
+
+// The Running Process used up its Slice
+void sched_slice_expired(void);
+
+// A Runnable Process should Preempt the Running one
+int sched_preempt(void);
+
+// process_list State of a PID
+int process_state(int pid);
+
+// Number of Runnable Processes
+int nr_runnable(void);
+
+// Whether the Running Process is still Runnable
+int current_runnable(void);
+
 // OS Scheduling Main Function
 int schedule(void);
 
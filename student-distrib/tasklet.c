@@ -0,0 +1,94 @@
+/* tasklet.c
+ * Deferred Work (Bottom Half) for Interrupt Handlers
+ *
+ * Hard IRQ handlers only acknowledge the device and queue a tasklet.
+ * The IRQ wrappers in irq.S call do_softirq() after the handler has
+ * sent its EOI and before returning to the interrupted context, so the
+ * deferred work runs with interrupts enabled and never delays another
+ * IRQ.
+ */
+
+#include "tasklet.h"
+#include "lib.h"
+#include "syscall.h"
+
+// FIFO of Pending Tasklets
+static tasklet_t* tasklet_head = NULL;
+static tasklet_t* tasklet_tail = NULL;
+// Tasks whose Stack is Running do_softirq(), one Bit per PID. Kept per
+// Task as a Tasklet may Switch away, e.g. to Launch a Shell.
+static uint32_t softirq_active = 0;
+
+/* tasklet_init()
+ * Prepare a Tasklet
+ *
+ * Inputs:    t - Tasklet
+ *         func - Deferred Function
+ *         data - Argument passed to func
+ * Outputs: None
+ */
+void tasklet_init(tasklet_t* t, void (*func)(uint32_t data), uint32_t data) {
+	t->func = func;
+	t->data = data;
+	t->state = 0;
+	t->next = NULL;
+}
+
+/* tasklet_schedule()
+ * Queue a Tasklet to run on the next IRQ Exit. Does nothing if it is
+ * already Pending.
+ *
+ * Inputs: t - Tasklet
+ * Outputs: None
+ */
+void tasklet_schedule(tasklet_t* t) {
+	uint32_t flags;
+	cli_and_save(flags);
+	if (!(t->state & TASKLET_PENDING)) {
+		t->state |= TASKLET_PENDING;
+		t->next = NULL;
+		if (tasklet_tail == NULL) tasklet_head = t;
+		else tasklet_tail->next = t;
+		tasklet_tail = t;
+	}
+	restore_flags(flags);
+}
+
+/* do_softirq()
+ * Run every Pending Tasklet with Interrupts Enabled. Each Tasklet is
+ * dequeued before it runs, so an IRQ arriving meanwhile may queue it
+ * again. An IRQ Nested in a Tasklet does not Re-enter: it returns and
+ * leaves the new Work to the Loop already Running on this Stack. A
+ * Tasklet that Switches to another Task (e.g. one that launches a
+ * Shell) does not block the rest of the Queue, which that Task's IRQ
+ * Exits keep Running.
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void do_softirq(void) {
+	uint32_t flags, self;
+	tasklet_t* t;
+
+	cli_and_save(flags);
+	self = 1 << current_pid;
+	if (softirq_active & self) {
+		restore_flags(flags);
+		return;
+	}
+	softirq_active |= self;
+	while (tasklet_head != NULL) {
+		// Dequeue the Oldest Tasklet
+		t = tasklet_head;
+		tasklet_head = t->next;
+		if (tasklet_head == NULL) tasklet_tail = NULL;
+		t->state &= ~TASKLET_PENDING;
+
+		// Run it with Interrupts Enabled
+		sti();
+		t->func(t->data);
+		cli();
+	}
+	softirq_active &= ~self;
+	restore_flags(flags);
+}
@@ -0,0 +1,38 @@
+/* tasklet.h
+ * Deferred Work (Bottom Half) for Interrupt Handlers
+ */
+
+#ifndef _TASKLET_H
+#define _TASKLET_H
+
+#include "types.h"
+
+// Tasklet is Queued and has not Started Running
+#define TASKLET_PENDING	0x1
+
+/* Tasklet
+ * A function queued by a hard IRQ handler and run by do_softirq()
+ * once the IRQ has been acknowledged, with interrupts enabled. A tasklet
+ * is queued at most once no matter how often it is scheduled before it
+ * runs.
+ */
+typedef struct tasklet_t {
+	// Deferred Function and its Argument
+	void (*func)(uint32_t data);
+	uint32_t data;
+	// TASKLET_PENDING while Queued
+	volatile uint32_t state;
+	// Next Tasklet in the Pending Queue
+	struct tasklet_t* next;
+} tasklet_t;
+
+/* Prepare a Tasklet */
+void tasklet_init(tasklet_t* t, void (*func)(uint32_t data), uint32_t data);
+
+/* Queue a Tasklet, safe from Hard IRQ Context */
+void tasklet_schedule(tasklet_t* t);
+
+/* Run all Pending Tasklets, called by the IRQ Wrappers */
+void do_softirq(void);
+
+#endif // _TASKLET_H
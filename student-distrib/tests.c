@@ -7,6 +7,11 @@
 #include "file_system.h"
 #include "syscall.h"
 #include "malloc.h"
+#include "timer.h"
+#include "pit.h"
+#include "tasklet.h"
+#include "futex.h"
+#include "ioring.h"
 #define PASS 1
 #define FAIL 0
 
@@ -236,6 +241,186 @@ int combined_cp3_tests() {
 /* Checkpoint 4 tests */
 /* Checkpoint 5 tests */
 
+// Counts Timer Callbacks
+static volatile int timer_test_fired;
+static void timer_test_cb(uint32_t data) { timer_test_fired += data; }
+
+/* timer_wheel_test()
+ * Arms Timers on every Wheel Level, cancels one and drives the Clock
+ * by Hand until the nearest Fires, so it also Runs before pit_init().
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Moves the Kernel Clock 10 ms ahead
+ * Coverage: timer_add, timer_del, Expiry
+ */
+int timer_wheel_test() {
+	TEST_HEADER;
+	
+	// Static, a Failed Check may Leave some Armed
+	static ktimer_t t[TV_LEVELS];
+	uint32_t start = jiffies;
+	uint32_t flags;
+	int i;
+	
+	timer_test_fired = 0;
+	for (i = 0; i < TV_LEVELS; i++) {
+		timer_setup(&t[i], timer_test_cb, 1 << i);
+		timer_add(&t[i], start + 2 + (1 << (TVN_BITS * i)));
+		if (!timer_pending(&t[i])) return FAIL;
+	}
+	
+	// Cancel is O(1) and leaves the others Armed
+	if (timer_del(&t[1]) != 1) return FAIL;
+	if (timer_del(&t[1]) != 0) return FAIL;
+	if (!timer_pending(&t[2])) return FAIL;
+	
+	// Advance 10 Jiffies and Run the Wheel's Tasklet
+	cli_and_save(flags);
+	for (i = 0; i < 10; i++) timer_tick((INI_FRE + MS_PER_S - 1) / MS_PER_S);
+	restore_flags(flags);
+	do_softirq();
+	
+	// Only the Level 0 Timer was Due
+	if (timer_test_fired != 1 || timer_pending(&t[0])) return FAIL;
+	
+	for (i = 0; i < TV_LEVELS; i++) timer_del(&t[i]);
+	return PASS;
+}
+
+// Counts Tasklet Runs
+static volatile int tasklet_test_runs;
+static void tasklet_test_cb(uint32_t data) { tasklet_test_runs += data; }
+
+/* tasklet_dedup_test()
+ * Schedules one Tasklet twice before it Runs
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Runs any other Pending Tasklets
+ * Coverage: tasklet_schedule De-duplication, do_softirq
+ */
+int tasklet_dedup_test() {
+	TEST_HEADER;
+	
+	static tasklet_t t;
+	uint32_t flags;
+	int queued;
+	
+	tasklet_test_runs = 0;
+	tasklet_init(&t, tasklet_test_cb, 1);
+	cli_and_save(flags);
+	tasklet_schedule(&t);
+	tasklet_schedule(&t);
+	queued = t.state & TASKLET_PENDING;
+	restore_flags(flags);
+	do_softirq();
+	// Queued once, Run once
+	if (!queued || tasklet_test_runs != 1 || (t.state & TASKLET_PENDING)) return FAIL;
+	
+	// Once it has Run it can be Queued again
+	tasklet_schedule(&t);
+	do_softirq();
+	return (tasklet_test_runs == 2) ? PASS : FAIL;
+}
+
+/* futex_queue_test()
+ * Queues Stand-in Tasks in Free Slots on two Keys of one Hash Bucket
+ * and Wakes them by Key, so Nothing Sleeps
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Writes the PCBs of Slots 1 to 3, which must be Free
+ * Coverage: futex_wake FIFO Order and Key Match, futex_cancel
+ */
+int futex_queue_test() {
+	TEST_HEADER;
+	
+	// Two Physical Words, the second Hashing to the first one's Bucket
+	uint32_t k1 = M_8MB + M_4MB, k2 = k1 + S_INT;
+	uint32_t flags;
+	int pid, result = PASS;
+	
+	while (((k2 * FUTEX_HASH_MULT) >> (32 - FUTEX_HASH_BITS)) != ((k1 * FUTEX_HASH_MULT) >> (32 - FUTEX_HASH_BITS))) k2 += S_INT;
+	
+	cli_and_save(flags);
+	for (pid = 1; pid <= 3; pid++) {
+		if (process_list[pid] != 0) {
+			restore_flags(flags);
+			return FAIL;
+		}
+	}
+	for (pid = 1; pid <= 3; pid++) {
+		((pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * pid)))->pid = pid;
+		process_list[pid] = PROCESS_SLEEPING;
+	}
+	futex_queue(1, k1);
+	futex_queue(2, k2);
+	futex_queue(3, k1);
+	
+	// Oldest Waiter on the Key first, the other Key's Waiter is Skipped
+	if (futex_wake_key(k1, 1) != 1 || process_list[1] != 1 ||
+		process_list[2] != PROCESS_SLEEPING || process_list[3] != PROCESS_SLEEPING) result = FAIL;
+	// A Cancelled Waiter is not Woken
+	futex_cancel(3);
+	if (futex_wake_key(k1, 2) != 0 || process_list[3] != PROCESS_SLEEPING) result = FAIL;
+	if (futex_wake_key(k2, 2) != 1 || process_list[2] != 1) result = FAIL;
+	
+	for (pid = 1; pid <= 3; pid++) {
+		futex_cancel(pid);
+		process_list[pid] = 0;
+	}
+	restore_flags(flags);
+	return result;
+}
+
+/* ioring_test()
+ * Runs the Rings of a Stand-in Program in Slot 1: an Overrun
+ * Submission, two NOPs, then an Overrun Completion Ring
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Maps Slot 1's User Page, which must be Free
+ * Coverage: io_submit, io_wait, Ring Index Checks
+ */
+int ioring_test() {
+	TEST_HEADER;
+	
+	io_ring_t *ring = (io_ring_t *) IORING_ADDR;
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - M_8KB);
+	uint32_t flags;
+	int i, result = PASS;
+	
+	cli_and_save(flags);
+	if (process_list[1] != 0) {
+		restore_flags(flags);
+		return FAIL;
+	}
+	pcb->pid = 1;
+	pcb->tgid = 1;
+	pcb->exit_pid = 0;
+	current_pid = 1;
+	switch_task(1);
+	ioring_init();
+	
+	// The Program Claims more Entries than the Ring Holds
+	ring->sq_tail = IORING_ENTRIES + 1;
+	if (io_submit(IORING_ENTRIES + 1) != -1) result = FAIL;
+	
+	// Two NOPs Complete in Order
+	for (i = 0; i < 2; i++) {
+		ring->sq[i].opcode = IORING_OP_NOP;
+		ring->sq[i].user_data = 100 + i;
+	}
+	ring->sq_tail = 2;
+	if (io_submit(IORING_ENTRIES) != 2 || io_wait(2) != 2 || ring->cq_tail != 2) result = FAIL;
+	if (ring->cq[0].user_data != 100 || ring->cq[1].user_data != 101 || ring->cq[0].res != 0) result = FAIL;
+	
+	// The Program Claims to have Consumed Completions not yet Posted
+	ring->cq_head = ring->cq_tail - IORING_ENTRIES - 1;
+	if (io_wait(1) != -1) result = FAIL;
+	
+	current_pid = 0;
+	restore_flags(flags);
+	return result;
+}
+
 /* Test suite entry point */
 void launch_tests() {
 	
@@ -272,4 +457,10 @@ void launch_tests() {
 	
 	/* Checkpoint 4 Tests */
 	/* Checkpoint 5 Tests */
+	{
+		TEST_OUTPUT("timer_wheel_test", timer_wheel_test());
+		TEST_OUTPUT("tasklet_dedup_test", tasklet_dedup_test());
+		TEST_OUTPUT("futex_queue_test", futex_queue_test());
+		TEST_OUTPUT("ioring_test", ioring_test());
+	}
 }
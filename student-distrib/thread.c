@@ -0,0 +1,301 @@
+/* thread.c
+ * User Threads Sharing a Program's Address Space
+ *
+ * clone() starts a thread in a free process slot. The new thread gets
+ * its own PCB and kernel stack, and a user stack the program chose. It
+ * shares its group leader's 4MB user page, fd table, arguments and I/O
+ * rings; pcb->tgid names the leader. context_switch() only reloads CR3
+ * when the next task belongs to another program, so switching between
+ * sibling threads is just a stack switch.
+ *
+ * A thread that ends with thread_exit() stays a zombie until a sibling
+ * joins it. halt() from any thread ends the whole program: the other
+ * threads are woken and stop as zombies on their way back to user
+ * mode (thread_check()), then their slots are freed. Threads
+ * block on each other with futex_wait() and futex_wake() (futex.c).
+ */
+
+#include "thread.h"
+#include "lib.h"
+#include "syscall.h"
+#include "kthread.h"
+#include "x86_desc.h"
+#include "pit.h"
+#include "stats.h"
+#include "klog.h"
+#include "futex.h"
+
+/* thread_user_range()
+ * Check that a Range lies within the User Page
+ *
+ * Inputs: addr - First Byte
+ *          len - Length in Bytes, > 0
+ * Outputs: 1 if it does, 0 otherwise
+ */
+int32_t thread_user_range(uint32_t addr, uint32_t len) {
+	return (addr >> PD_OFFSET) == USER_DIR && ((addr + len - 1) >> PD_OFFSET) == USER_DIR;
+}
+
+/* thread_reap()
+ * Free a Thread's Slot, Called with Interrupts Disabled on a Thread
+ * that is not Running
+ *
+ * Inputs: tid - Thread
+ * Outputs: None
+ */
+static void thread_reap(uint32_t tid) {
+	pcb_struct_t *t = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * tid));
+	timer_del(&t->sleep_timer);
+	timer_del(&t->alarm_timer);
+	futex_cancel(tid);
+	t->state = 0;
+	process_list[tid] = 0;
+}
+
+/* thread_user_start()
+ * First Kernel Code of a new Thread, Drops to User Space at the Entry
+ * Point and Stack given to clone()
+ *
+ * Inputs: None Effective
+ * Outputs: None
+ */
+static void thread_user_start(uint32_t data) {
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * current_pid));
+
+	asm volatile(
+	"cli ;"
+	"movl $0x002B, %%eax ;"		// Load USER_DS to EAX
+	"movw %%ax, %%ds ;" 		// Load Data Segment Register
+	"movw %%ax, %%es ;"			// Load Destination Segment Register
+	"movw %%ax, %%gs ;"			// Load Extra Segment Register
+	"movw %%ax, %%fs ;"			// Load File Segment Register
+	"pushl $0x002B ;" 			// Push USER_DS
+	"pushl %1 ;"				// Push the Thread's User Stack
+	"pushfl ;"					// Push EFLAGS
+	"popl %%ebx ;"				// Load EFLAGS to EBX
+	"orl $0x4200, %%ebx ;"		// Enable NT and IF Flags
+	"pushl %%ebx ;"				// Push EFLAGS
+	"pushl $0x0023 ;" 			// Push USER_CS
+	"pushl %0 ;" 				// Push EIP of the Thread's Entry Point
+	"iret ;"					// Perform IRET to Return to User Space
+	: // No Outputs
+	: "r" (pcb->user_eip), "r" (pcb->user_esp)
+	: "%eax", "%ebx"
+	);
+}
+
+/* clone()
+ * Start a Thread of the Running Program
+ *
+ * Inputs: entry - User Address the Thread Starts at
+ *         stack - Initial User Stack Pointer
+ * Outputs: Thread ID, -1 on Fail
+ */
+int32_t clone(uint32_t entry, uint32_t stack) {
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * current_pid));
+	pcb_struct_t *t;
+	uint32_t flags, tid;
+
+	if (!thread_user_range(entry, 1) || !thread_user_range(stack - S_INT, S_INT)) {
+		klog(KLOG_ERR, "THREAD.CLONE: FATAL - Pointer Out of Range \n");
+		return -1;
+	}
+
+	cli_and_save(flags);
+	// A Thread that just Exited may still be Running on its Stack
+	for (tid = 1; tid < MAX_PROCESS_NUM; tid++) {
+		if (process_list[tid] == 0 && tid != current_pid) break;
+	}
+	if (tid == MAX_PROCESS_NUM) {
+		restore_flags(flags);
+		klog(KLOG_ERR, "THREAD.CLONE: FATAL - No Slot for this Thread \n");
+		return -1;
+	}
+
+	t = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * tid));
+	memset(t, 0, sizeof(pcb_struct_t));
+	t->state = 1;
+	t->pid = tid;
+	t->tgid = pcb->tgid;
+	t->parent_pid = pcb->pid;
+	t->term = pcb->term;
+	t->nice = pcb->nice;
+	t->level = pcb->level;
+	memcpy(t->name, pcb->name, STAT_NAME_LEN);
+	timer_setup(&t->sleep_timer, process_wake, tid);
+	timer_setup(&t->alarm_timer, process_alarm, tid);
+	t->user_eip = entry;
+	t->user_esp = stack;
+	kthread_frame(tid, thread_user_start, 0);
+
+	process_list[tid] = 1;
+	restore_flags(flags);
+	// One more Runnable Task, the current Slice may need an End
+	pit_rearm();
+	return tid;
+}
+
+/* thread_park()
+ * Make the Running Thread a Zombie holding status and Idle until the
+ * PIT Switches away for good
+ *
+ * Inputs: status - Handed to thread_join()
+ * Outputs: None, does not Return
+ */
+static void thread_park(int32_t status) {
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * current_pid));
+
+	cli();
+	timer_del(&pcb->sleep_timer);
+	timer_del(&pcb->alarm_timer);
+	pcb->exit_status = status;
+	process_list[current_pid] = PROCESS_ZOMBIE;
+	if (pcb->join_pid != 0) process_wake(pcb->join_pid);
+	pit_rearm();
+	// Never Picked again, Idle until the PIT Switches away for good
+	while (1) {
+		acct_idle();
+		asm volatile("sti; hlt; cli" : : : "memory");
+	}
+}
+
+/* thread_exit()
+ * End the Running Thread. It stays a Zombie holding its Status until
+ * it is Joined or the Program Ends.
+ *
+ * Inputs: status - Handed to thread_join()
+ * Outputs: -1 if Called by the Main Thread, which Ends with halt();
+ *          does not Return otherwise
+ */
+int32_t thread_exit(int32_t status) {
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * current_pid));
+
+	if (pcb->tgid == current_pid) {
+		klog(KLOG_ERR, "THREAD.THREAD_EXIT: FATAL - Main Thread must Halt \n");
+		return -1;
+	}
+	thread_park(status);
+	return 0;
+}
+
+/* thread_killed()
+ * Check whether a Sibling is Halting the Running Thread's Program.
+ * Waits Ended Early by process_wake() check this and Return.
+ *
+ * Inputs: None
+ * Outputs: 1 if the Thread should Unwind, 0 otherwise
+ */
+int32_t thread_killed(void) {
+	pcb_struct_t *pcb;
+
+	if (current_pid <= 0 || IS_KTHREAD(current_pid)) return 0;
+	pcb = group_pcb();
+	return pcb->exit_pid != 0 && pcb->exit_pid != (uint32_t) current_pid;
+}
+
+/* thread_check()
+ * Stop the Running Thread if a Sibling is Halting its Program. Called
+ * where the Thread Holds no Kernel State: on Entry to and Return from
+ * a System Call, and when the PIT Returns to User Mode.
+ *
+ * Inputs: cs - Saved CS of the Interrupted Context
+ * Outputs: None, does not Return if the Thread is Stopped
+ */
+void thread_check(uint32_t cs) {
+	if ((cs & CS_RPL_MASK) != CS_RPL_MASK) return;
+	if (thread_killed()) thread_park(0);
+}
+
+/* thread_join()
+ * Wait for a Sibling Thread to Exit and Free its Slot
+ *
+ * Inputs:    tid - Thread of the same Program, not its Main Thread
+ *         status - Receives its thread_exit() Status, may be NULL
+ * Outputs: 0 on Success, -1 on Fail
+ */
+int32_t thread_join(int32_t tid, int32_t* status) {
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * current_pid));
+	pcb_struct_t *t;
+	uint32_t flags;
+
+	if (tid <= 0 || tid >= MAX_PROCESS_NUM || tid == current_pid) {
+		klog(KLOG_ERR, "THREAD.THREAD_JOIN: FATAL - Invalid Thread %d \n", tid);
+		return -1;
+	}
+	if (status != NULL && !thread_user_range((uint32_t) status, sizeof(int32_t))) {
+		klog(KLOG_ERR, "THREAD.THREAD_JOIN: FATAL - Pointer Out of Range \n");
+		return -1;
+	}
+	t = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * tid));
+
+	cli_and_save(flags);
+	// Only one Joiner per Thread
+	if (process_list[tid] == 0 || t->tgid != pcb->tgid || t->tgid == tid ||
+		(t->join_pid != 0 && t->join_pid != current_pid)) {
+		restore_flags(flags);
+		klog(KLOG_ERR, "THREAD.THREAD_JOIN: FATAL - Thread %d cannot be Joined \n", tid);
+		return -1;
+	}
+	t->join_pid = current_pid;
+	while (process_list[tid] != PROCESS_ZOMBIE && !thread_killed()) process_sleep();
+	if (process_list[tid] != PROCESS_ZOMBIE) {
+		t->join_pid = 0;
+		restore_flags(flags);
+		return -1;
+	}
+
+	if (status != NULL) *status = t->exit_status;
+	t->state = 0;
+	process_list[tid] = 0;
+	restore_flags(flags);
+	return 0;
+}
+
+/* thread_group_exit()
+ * Stop every other Thread of the Running Program before halt() Ends
+ * it. Sleeping Threads are Woken, and each Thread Stops as a Zombie
+ * once it has Left the Kernel, so no Wait it was in is Left Behind.
+ * A Thread Waiting on a Program it Executed Stops once that Program
+ * Halts. If the Caller is not the Main Thread its own Slot is Freed
+ * too, and halt() Finishes through the Main Thread's PCB. Returns with
+ * Interrupts Disabled.
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void thread_group_exit(void) {
+	pcb_struct_t *pcb = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * current_pid));
+	pcb_struct_t *leader = group_pcb();
+	pcb_struct_t *t;
+	uint32_t tid, busy;
+
+	cli();
+	// A Sibling got here First
+	if (thread_killed()) thread_park(0);
+	leader->exit_pid = current_pid;
+
+	// PENDING Threads are Waited for until their Child Program Halts
+	do {
+		busy = 0;
+		for (tid = 1; tid < MAX_PROCESS_NUM; tid++) {
+			t = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * tid));
+			if (tid == current_pid || process_list[tid] == 0 || t->tgid != pcb->tgid) continue;
+			if (process_list[tid] == PROCESS_ZOMBIE) continue;
+			busy = 1;
+			if (process_list[tid] == PROCESS_SLEEPING) {
+				futex_cancel(tid);
+				process_wake(tid);
+			}
+		}
+		if (busy) sleep(1);
+	} while (busy);
+
+	for (tid = 1; tid < MAX_PROCESS_NUM; tid++) {
+		t = (pcb_struct_t *) (PCB_BASE_ADDR - (M_8KB * tid));
+		if (tid == current_pid || tid == pcb->tgid) continue;
+		if (process_list[tid] != 0 && t->tgid == pcb->tgid) thread_reap(tid);
+	}
+	if (current_pid != pcb->tgid) thread_reap(current_pid);
+	// A Thread Halting while the Main Thread Waits on a Futex
+	futex_cancel(pcb->tgid);
+}
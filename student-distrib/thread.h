@@ -0,0 +1,22 @@
+/* thread.h
+ * User Threads Sharing a Program's Address Space
+ */
+
+#ifndef _THREAD_H
+#define _THREAD_H
+
+#include "types.h"
+
+/* Check that a Range lies within the User Page */
+int32_t thread_user_range(uint32_t addr, uint32_t len);
+
+/* End every other Thread of the Running Program, called by halt() */
+void thread_group_exit(void);
+
+/* 1 if a Sibling is Halting the Running Thread's Program */
+int32_t thread_killed(void);
+
+/* Stop the Running Thread on its Way to User Mode if it is Killed */
+void thread_check(uint32_t cs);
+
+#endif // _THREAD_H
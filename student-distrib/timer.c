@@ -0,0 +1,321 @@
+/* timer.c
+ * Kernel Timers on a Hierarchical Timer Wheel
+ *
+ * The wheel has TV_LEVELS levels of TVN_SIZE slots. Level 0 holds
+ * timers due within the next TVN_SIZE jiffies, one slot per jiffy;
+ * each higher level covers TVN_SIZE times the range of the one below.
+ * Whenever level 0 wraps, the next slot of level 1 is cascaded down,
+ * and so on up the levels. Insert and cancel are O(1) list operations.
+ *
+ * The PIT advances jiffies; expired timers are run by a tasklet so the
+ * PIT handler itself stays short.
+ */
+
+#include "timer.h"
+#include "lib.h"
+#include "pit.h"
+#include "tasklet.h"
+#include "clocksource.h"
+
+// Milliseconds since the PIT was Started
+volatile uint32_t jiffies = 0;
+// Next Jiffy the Wheel has not Processed yet
+static uint32_t timer_jiffies = 0;
+// Wheel Slots
+static timer_link_t timer_wheel[TV_LEVELS][TVN_SIZE];
+// Number of Pending Timers
+static uint32_t timer_count = 0;
+// PIT Counts (times MS_PER_S) not yet Turned into a Jiffy
+static uint32_t pit_acc = 0;
+// Monotonic Clock in Whole Seconds and Milliseconds
+static uint32_t clock_sec = 0;
+static uint32_t clock_ms = 0;
+// Runs Expired Timers
+static tasklet_t timer_tasklet;
+
+/* timer_link_add()
+ * Append a Timer to a Slot
+ *
+ * Inputs: head - Slot Sentinel
+ *         link - Timer Link
+ * Outputs: None
+ */
+static void timer_link_add(timer_link_t* head, timer_link_t* link) {
+	link->prev = head->prev;
+	link->next = head;
+	head->prev->next = link;
+	head->prev = link;
+}
+
+/* timer_link_del()
+ * Unlink a Timer from its Slot
+ *
+ * Inputs: link - Timer Link
+ * Outputs: None
+ */
+static void timer_link_del(timer_link_t* link) {
+	link->prev->next = link->next;
+	link->next->prev = link->prev;
+	link->next = NULL;
+	link->prev = NULL;
+}
+
+/* timer_internal_add()
+ * Place a Timer in the Slot matching its Distance from timer_jiffies.
+ * Must be called with Interrupts Disabled.
+ *
+ * Inputs: t - Timer
+ * Outputs: None
+ */
+static void timer_internal_add(ktimer_t* t) {
+	uint32_t expires = t->expires;
+	uint32_t idx = expires - timer_jiffies;
+	int level;
+
+	// Already Due, run on the next Jiffy Processed
+	if ((int32_t) idx < 0) {
+		timer_link_add(&timer_wheel[0][timer_jiffies & TVN_MASK], &t->link);
+		return;
+	}
+	// Clamp Delays beyond the Wheel
+	if (idx > TIMER_MAX_DELAY) {
+		expires = timer_jiffies + TIMER_MAX_DELAY;
+		idx = TIMER_MAX_DELAY;
+	}
+	for (level = 0; level < TV_LEVELS - 1; level++) {
+		if (idx < (1 << (TVN_BITS * (level + 1)))) break;
+	}
+	timer_link_add(&timer_wheel[level][(expires >> (TVN_BITS * level)) & TVN_MASK], &t->link);
+}
+
+/* timer_cascade()
+ * Move all Timers of one Slot down to the Levels below
+ *
+ * Inputs: level - Wheel Level
+ *         index - Slot within the Level
+ * Outputs: index, so the Caller knows whether this Level wrapped too
+ */
+static uint32_t timer_cascade(int level, uint32_t index) {
+	timer_link_t* head = &timer_wheel[level][index];
+	timer_link_t* link;
+
+	while (head->next != head) {
+		link = head->next;
+		timer_link_del(link);
+		timer_internal_add((ktimer_t*) link);
+	}
+	return index;
+}
+
+/* timer_run()
+ * Tasklet that Processes every Jiffy up to the Current one and runs
+ * the Timers that Expired
+ *
+ * Inputs: None Effective
+ * Outputs: None
+ */
+static void timer_run(uint32_t data) {
+	uint32_t flags;
+	uint32_t index;
+	timer_link_t* head;
+	ktimer_t* t;
+
+	cli_and_save(flags);
+	while ((int32_t) (jiffies - timer_jiffies) >= 0) {
+		index = timer_jiffies & TVN_MASK;
+		// Level 0 Wrapped, Cascade the Levels above
+		if (!index &&
+			!timer_cascade(1, (timer_jiffies >> TVN_BITS) & TVN_MASK) &&
+			!timer_cascade(2, (timer_jiffies >> (2 * TVN_BITS)) & TVN_MASK))
+			timer_cascade(3, (timer_jiffies >> (3 * TVN_BITS)) & TVN_MASK);
+		timer_jiffies++;
+
+		// Fire every Timer in this Slot
+		head = &timer_wheel[0][index];
+		while (head->next != head) {
+			t = (ktimer_t*) head->next;
+			timer_link_del(&t->link);
+			timer_count--;
+			t->func(t->data);
+		}
+	}
+	restore_flags(flags);
+}
+
+/* timer_init()
+ * Initialize the Timer Wheel
+ *
+ * Inputs: None
+ * Outputs: None
+ */
+void timer_init(void) {
+	int level, i;
+
+	for (level = 0; level < TV_LEVELS; level++) {
+		for (i = 0; i < TVN_SIZE; i++) {
+			timer_wheel[level][i].next = &timer_wheel[level][i];
+			timer_wheel[level][i].prev = &timer_wheel[level][i];
+		}
+	}
+	jiffies = 0;
+	timer_jiffies = 0;
+	timer_count = 0;
+	pit_acc = 0;
+	clock_sec = 0;
+	clock_ms = 0;
+	tasklet_init(&timer_tasklet, timer_run, 0);
+}
+
+/* timer_setup()
+ * Prepare a Timer
+ *
+ * Inputs:    t - Timer
+ *         func - Callback
+ *         data - Argument passed to func
+ * Outputs: None
+ */
+void timer_setup(ktimer_t* t, void (*func)(uint32_t data), uint32_t data) {
+	t->link.next = NULL;
+	t->link.prev = NULL;
+	t->expires = 0;
+	t->func = func;
+	t->data = data;
+}
+
+/* timer_add()
+ * Arm a Timer, moving it if it is already Pending
+ *
+ * Inputs:       t - Timer
+ *         expires - Jiffy at which it Fires
+ * Outputs: None
+ */
+void timer_add(ktimer_t* t, uint32_t expires) {
+	uint32_t flags;
+
+	cli_and_save(flags);
+	if (t->link.next != NULL) {
+		timer_link_del(&t->link);
+		timer_count--;
+	}
+	// The Wheel is Idle, skip the Jiffies nobody Waited on
+	if (timer_count == 0) timer_jiffies = jiffies;
+	t->expires = expires;
+	timer_internal_add(t);
+	timer_count++;
+	restore_flags(flags);
+	// The PIT may be Armed past the new Expiry
+	pit_rearm();
+}
+
+/* timer_del()
+ * Disarm a Timer
+ *
+ * Inputs: t - Timer
+ * Outputs: 1 if the Timer was Pending, 0 otherwise
+ */
+int32_t timer_del(ktimer_t* t) {
+	uint32_t flags;
+	int32_t pending = 0;
+
+	cli_and_save(flags);
+	if (t->link.next != NULL) {
+		timer_link_del(&t->link);
+		timer_count--;
+		pending = 1;
+	}
+	restore_flags(flags);
+	return pending;
+}
+
+/* timer_pending()
+ * Check if a Timer is Armed
+ *
+ * Inputs: t - Timer
+ * Outputs: 1 if Pending, 0 otherwise
+ */
+int32_t timer_pending(const ktimer_t* t) {
+	return t->link.next != NULL;
+}
+
+/* timer_tick()
+ * Advance the Clock by the PIT Counts Elapsed since the last IRQ 0 and
+ * queue the Timer Tasklet once a Jiffy has Passed. Called from the PIT
+ * Handler with Interrupts Disabled.
+ *
+ * Inputs: counts - PIT Input Clock Counts since the last Tick
+ * Outputs: None
+ */
+void timer_tick(uint32_t counts) {
+	uint32_t advanced = 0;
+
+	// A Jiffy is INI_FRE / MS_PER_S Counts, kept Exact by Scaling
+	pit_acc += counts * MS_PER_S;
+	while (pit_acc >= INI_FRE) {
+		pit_acc -= INI_FRE;
+		jiffies++;
+		if (++clock_ms == MS_PER_S) {
+			clock_ms = 0;
+			clock_sec++;
+		}
+		advanced = 1;
+	}
+	if (advanced && timer_count != 0) tasklet_schedule(&timer_tasklet);
+}
+
+/* timer_next_counts()
+ * Find how long the PIT may Sleep before the Wheel needs to Run: until
+ * the first non-empty Level 0 Slot, or until Level 0 Wraps and the
+ * Level above must be Cascaded.
+ *
+ * Inputs: None
+ * Outputs: PIT Counts, 0 if Overdue, TIMER_NO_EVENT if Idle
+ */
+uint32_t timer_next_counts(void) {
+	uint32_t next, j, d;
+
+	if (timer_count == 0) return TIMER_NO_EVENT;
+
+	// Default to the next Cascade
+	next = (timer_jiffies | TVN_MASK) + 1;
+	for (j = timer_jiffies; j != next; j++) {
+		if (timer_wheel[0][j & TVN_MASK].next != &timer_wheel[0][j & TVN_MASK]) {
+			next = j;
+			break;
+		}
+	}
+
+	if ((int32_t) (next - jiffies) <= 0) return 0;
+	d = next - jiffies;
+	// Beyond any One-Shot, no need to be Exact
+	if (d > TVN_SIZE) return TIMER_NO_EVENT - 1;
+	// Rest of the current Jiffy, then whole Jiffies
+	return (INI_FRE - pit_acc + MS_PER_S - 1) / MS_PER_S +
+		(d - 1) * INI_FRE / MS_PER_S;
+}
+
+/* timer_gettime()
+ * Read the Monotonic Clock, from the TSC if it is Calibrated
+ *
+ * Inputs: ts - Filled with the Time since the PIT was Started
+ * Outputs: None
+ */
+void timer_gettime(timespec_t* ts) {
+	uint32_t flags;
+	uint32_t sub_ms;
+	uint64_t ns;
+
+	if (tsc_khz() != 0) {
+		ns = ktime_ns();
+		ts->tv_nsec = div64_32(&ns, NS_PER_S);
+		ts->tv_sec = (uint32_t) ns;
+		return;
+	}
+
+	cli_and_save(flags);
+	ts->tv_sec = clock_sec;
+	// Sub-Millisecond Part from the PIT Counts, kept within 32 Bits
+	sub_ms = (pit_acc / MS_PER_S) * MS_PER_S * MS_PER_S / (INI_FRE / MS_PER_S);
+	if (sub_ms >= NS_PER_MS) sub_ms = NS_PER_MS - 1;
+	ts->tv_nsec = clock_ms * NS_PER_MS + sub_ms;
+	restore_flags(flags);
+}
@@ -0,0 +1,90 @@
+/* timer.h
+ * Kernel Timers on a Hierarchical Timer Wheel
+ */
+
+#ifndef _TIMER_H
+#define _TIMER_H
+
+#include "types.h"
+
+// Length of a Jiffy in Milliseconds
+#define JIFFY_MS	1
+// Slots per Wheel Level
+#define TVN_BITS	6
+#define TVN_SIZE	(1 << TVN_BITS)
+#define TVN_MASK	(TVN_SIZE - 1)
+// Number of Wheel Levels
+#define TV_LEVELS	4
+// Longest Delay the Wheel can Hold, in Jiffies (~4.6 Hours)
+#define TIMER_MAX_DELAY	((1 << (TVN_BITS * TV_LEVELS)) - 1)
+
+// Nanoseconds per Millisecond and per Second
+#define NS_PER_MS	1000000
+#define NS_PER_S	1000000000
+// Milliseconds per Second
+#define MS_PER_S	1000
+
+// timer_next_counts() when no Timer is Pending
+#define TIMER_NO_EVENT	0xFFFFFFFF
+
+// Only Clock accepted by clock_gettime()
+#define CLOCK_MONOTONIC	1
+
+/* Timer List Link
+ * Doubly Linked so a Timer can be Removed in O(1). Each Wheel Slot
+ * holds a Sentinel Link.
+ */
+typedef struct timer_link_t {
+	struct timer_link_t* next;
+	struct timer_link_t* prev;
+} timer_link_t;
+
+/* Kernel Timer
+ * Calls func(data) once jiffies reaches expires. The Callback runs
+ * from the Timer Tasklet with Interrupts Disabled, so it must be short;
+ * it may re-arm its own Timer.
+ */
+typedef struct ktimer_t {
+	// Wheel Slot Link, next is NULL while not Pending
+	timer_link_t link;
+	// Jiffy at which the Timer Fires
+	uint32_t expires;
+	// Callback and its Argument
+	void (*func)(uint32_t data);
+	uint32_t data;
+} ktimer_t;
+
+/* Monotonic Time */
+typedef struct timespec_t {
+	uint32_t tv_sec;
+	uint32_t tv_nsec;
+} timespec_t;
+
+/* Milliseconds since the PIT was Started */
+extern volatile uint32_t jiffies;
+
+/* Initialize the Timer Wheel */
+void timer_init(void);
+
+/* Prepare a Timer */
+void timer_setup(ktimer_t* t, void (*func)(uint32_t data), uint32_t data);
+
+/* Arm a Timer to Fire at Jiffy expires, re-arming if Pending */
+void timer_add(ktimer_t* t, uint32_t expires);
+
+/* Disarm a Timer, returns 1 if it was Pending */
+int32_t timer_del(ktimer_t* t);
+
+/* Check if a Timer is Armed */
+int32_t timer_pending(const ktimer_t* t);
+
+/* Advance the Clock by a Number of PIT Counts, called from IRQ 0 */
+void timer_tick(uint32_t counts);
+
+/* PIT Counts until the Wheel next needs to Run */
+uint32_t timer_next_counts(void);
+
+/* Read the Monotonic Clock */
+void timer_gettime(timespec_t* ts);
+
+#endif // _TIMER_H
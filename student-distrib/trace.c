@@ -0,0 +1,76 @@
+/* trace.c
+ * Kernel Event Trace Ring
+ *
+ * Events are appended to one ring with interrupts disabled for the
+ * handful of stores, so recording costs a few dozen cycles and never
+ * touches the console. Readers of the "trace" device drain the ring in
+ * binary form; events overwritten before being read are reported as a
+ * single TR_LOST event.
+ */
+
+#include "trace.h"
+
+// The Ring and the Total Number of Events Recorded
+trace_event_t trace_ring[TRACE_RING_SIZE];
+uint32_t trace_head = 0;
+// Total Number of Events Drained or Lost
+static uint32_t trace_tail = 0;
+
+/* trace_open()
+ * Open the Trace Device
+ *
+ * Inputs: None Effective
+ * Outputs: 0
+ */
+int32_t trace_open(const uint8_t* filename) {
+	return 0;
+}
+
+/* trace_read()
+ * Drain the Oldest Events. Only whole Events are Copied.
+ *
+ * Inputs: buf - Buffer for trace_event_t Records
+ *      nbytes - Size of buf
+ * Outputs: Bytes Copied, 0 if the Ring is Empty
+ */
+int32_t trace_read(unsigned int inode, unsigned int offset, void* buf, int32_t nbytes) {
+	uint32_t flags;
+	trace_event_t* out = (trace_event_t*) buf;
+	int32_t n = 0, max = nbytes / (int32_t) sizeof(trace_event_t);
+
+	cli_and_save(flags);
+	// The Writer Lapped the Reader, Report the Gap first
+	if (trace_head - trace_tail > TRACE_RING_SIZE && n < max) {
+		out[n].tsc = rdtsc();
+		out[n].type = TR_LOST;
+		out[n].pid = 0;
+		out[n].arg = trace_head - trace_tail - TRACE_RING_SIZE;
+		trace_tail = trace_head - TRACE_RING_SIZE;
+		n++;
+	}
+	while (trace_tail != trace_head && n < max) {
+		out[n++] = trace_ring[trace_tail++ & TRACE_RING_MASK];
+	}
+	restore_flags(flags);
+	return n * sizeof(trace_event_t);
+}
+
+/* trace_write()
+ * The Trace Device is Read-Only
+ *
+ * Inputs: None Effective
+ * Outputs: -1
+ */
+int32_t trace_write(unsigned int inode, const void* buf, int32_t nbytes) {
+	return -1;
+}
+
+/* trace_close()
+ * Close the Trace Device
+ *
+ * Inputs: None Effective
+ * Outputs: 0
+ */
+int32_t trace_close(unsigned int inode) {
+	return 0;
+}
@@ -0,0 +1,81 @@
+/* trace.h
+ * Kernel Event Trace Ring
+ */
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include "types.h"
+#include "lib.h"
+#include "clocksource.h"
+
+/* Categories, Enabled at Build Time with TRACE_MASK (e.g. "make
+ * TRACE_MASK=0xF"). A Disabled Category compiles to Nothing. */
+#define TRACE_SYSCALL	0x1
+#define TRACE_IRQ		0x2
+#define TRACE_SCHED		0x4
+#define TRACE_FAULT		0x8
+#ifndef TRACE_MASK
+#define TRACE_MASK		0
+#endif
+
+/* Event Types */
+#define TR_SYSCALL_ENTER	1	// arg: System Call Number
+#define TR_SYSCALL_EXIT		2	// arg: Return Value
+#define TR_IRQ_ENTER		3	// arg: IRQ Number
+#define TR_IRQ_EXIT			4	// arg: IRQ Number
+#define TR_SWITCH			5	// arg: Next PID
+#define TR_WAKEUP			6	// arg: Woken PID
+#define TR_PAGE_FAULT		7	// arg: Faulting Address
+#define TR_LOST				8	// arg: Events Overwritten before being Read
+
+/* Ring Size in Events, a Power of 2 */
+#define TRACE_RING_SIZE	4096
+#define TRACE_RING_MASK	(TRACE_RING_SIZE - 1)
+
+/* Name of the Device that Drains the Ring */
+#define TRACE_DEV_NAME	"trace"
+
+/* Trace Event, 16 Bytes */
+typedef struct trace_event_t {
+	uint64_t tsc;
+	uint16_t type;
+	uint16_t pid;
+	uint32_t arg;
+} trace_event_t;
+
+/* The Ring, Written by trace_record() and Drained by trace_read() */
+extern trace_event_t trace_ring[TRACE_RING_SIZE];
+extern uint32_t trace_head;
+
+/* PID of Current Running Process */
+extern int current_pid;
+
+/* trace_record()
+ * Append an Event, Overwriting the Oldest when Full
+ */
+static inline void trace_record(uint32_t type, uint32_t arg) {
+	uint32_t flags;
+	trace_event_t* e;
+	cli_and_save(flags);
+	e = &trace_ring[trace_head++ & TRACE_RING_MASK];
+	e->tsc = rdtsc();
+	e->type = type;
+	e->pid = current_pid;
+	e->arg = arg;
+	restore_flags(flags);
+}
+
+/* Record an Event if its Category is Built in */
+#define trace(cat, type, arg)						\
+do {												\
+	if (TRACE_MASK & (cat)) trace_record((type), (arg));	\
+} while (0)
+
+/* Character Device Driver Functions */
+int32_t trace_open(const uint8_t* filename);
+int32_t trace_read(unsigned int inode, unsigned int offset, void* buf, int32_t nbytes);
+int32_t trace_write(unsigned int inode, const void* buf, int32_t nbytes);
+int32_t trace_close(unsigned int inode);
+
+#endif // _TRACE_H
@@ -9,10 +9,17 @@
 
 #define VERBOSE 0
 
+/* Mirror Console Output (printf and STDOUT) to COM1 */
+#ifndef SERIAL_CONSOLE
+#define SERIAL_CONSOLE 0
+#endif
+
 /* Address of Null Pointer */
 #define NULL 0
 /* Maximum Integer represented by a 16-bit Unsigned Integer */
 #define UINT16_MAX 65536
+/* Maximum Integer represented by a 32-bit Signed Integer */
+#define INT32_MAX 0x7FFFFFFF
 /* Maximum Number of Terminals */
 #define TERM_MAX 3
 /* Terminal Buffer Size */
@@ -28,6 +35,9 @@
 #ifndef ASM
 
 /* Types defined here just like in <stdint.h> */
+typedef long long int64_t;
+typedef unsigned long long uint64_t;
+
 typedef int int32_t;
 typedef unsigned int uint32_t;
 
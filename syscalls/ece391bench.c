@@ -0,0 +1,179 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 128
+#define SAMPLES 1000
+#define EXEC_SAMPLES 100
+#define READ_MAX 16384
+#define SCREEN_BYTES (80 * 25 * 2)
+#define NR_SIZES 5
+
+static uint32_t sample[SAMPLES];
+static uint8_t data[READ_MAX];
+static const uint32_t read_size[NR_SIZES] = {64, 256, 1024, 4096, READ_MAX};
+
+/* Elapsed cycles since "start", in 32 bits */
+static uint32_t
+since (uint64_t start)
+{
+    return (uint32_t)(ece391_rdtsc () - start);
+}
+
+/* Throughput in MB/s (10^6 bytes), that is bytes per microsecond */
+static void
+put_rate (const char* label, uint32_t bytes, uint32_t ns)
+{
+    uint8_t buf[16];
+    uint32_t rate;
+
+    if (ns == 0)
+        return;
+    rate = (ns >= 1000) ? bytes / (ns / 1000) : bytes * 1000 / ns;
+    ece391_fdputs (1, (const uint8_t*)label);
+    ece391_fdputs (1, ece391_itoa (rate, buf, 10));
+    ece391_fdputs (1, (const uint8_t*)" MB/s\n");
+}
+
+/* set_quantum(0) only reads the slice, the cheapest call there is */
+static int32_t
+bench_null (void)
+{
+    uint64_t t;
+    uint32_t i;
+
+    for (i = 0; i < SAMPLES; i++) {
+        t = ece391_rdtsc ();
+        ece391_set_quantum (0);
+        sample[i] = since (t);
+    }
+    ece391_bench_stats ((uint8_t*)"null_syscall", sample, SAMPLES);
+    return 0;
+}
+
+static int32_t
+bench_open (const uint8_t* file)
+{
+    uint64_t t;
+    uint32_t i;
+    int32_t fd;
+
+    for (i = 0; i < SAMPLES; i++) {
+        t = ece391_rdtsc ();
+        fd = ece391_open (file);
+        ece391_close (fd);
+        sample[i] = since (t);
+        if (fd == -1)
+            return -1;
+    }
+    ece391_bench_stats ((uint8_t*)"open_close", sample, SAMPLES);
+    return 0;
+}
+
+/* One sample is a read of the whole file with the given buffer size */
+static int32_t
+bench_read (const uint8_t* file)
+{
+    uint8_t name[BUFSIZE];
+    uint64_t t;
+    uint32_t i, s, bytes, ns;
+    int32_t fd, cnt;
+
+    for (s = 0; s < NR_SIZES; s++) {
+        for (i = 0; i < SAMPLES / 10; i++) {
+            if (-1 == (fd = ece391_open (file)))
+                return -1;
+            bytes = 0;
+            t = ece391_rdtsc ();
+            while (0 < (cnt = ece391_read (fd, data, read_size[s])))
+                bytes += cnt;
+            sample[i] = since (t);
+            ece391_close (fd);
+        }
+        ece391_strcpy (name, (uint8_t*)"read_");
+        ece391_itoa (read_size[s], name + ece391_strlen (name), 10);
+        ns = ece391_bench_stats (name, sample, SAMPLES / 10);
+        put_rate ("  ", bytes, ns);
+    }
+    return 0;
+}
+
+/* A child running "bench nop" halts at once */
+static int32_t
+bench_exec (void)
+{
+    uint64_t t;
+    uint32_t i;
+
+    for (i = 0; i < EXEC_SAMPLES; i++) {
+        t = ece391_rdtsc ();
+        if (0 != ece391_execute ((uint8_t*)"bench nop"))
+            return -1;
+        sample[i] = since (t);
+    }
+    ece391_bench_stats ((uint8_t*)"execute_halt", sample, EXEC_SAMPLES);
+    return 0;
+}
+
+/* Fill the mapped text screen, one sample per frame */
+static int32_t
+bench_vid (void)
+{
+    uint8_t* screen;
+    uint32_t* p;
+    uint64_t t;
+    uint32_t i, j, ns;
+
+    if (-1 == ece391_vidmap (&screen))
+        return -1;
+    for (i = 0; i < SAMPLES; i++) {
+        p = (uint32_t*)screen;
+        t = ece391_rdtsc ();
+        for (j = 0; j < SCREEN_BYTES / 4; j++)
+            p[j] = 0x07200720 + (i & 0x3F);
+        sample[i] = since (t);
+    }
+    ns = ece391_bench_stats ((uint8_t*)"vidmap_frame", sample, SAMPLES);
+    put_rate ("  ", SCREEN_BYTES, ns);
+    return 0;
+}
+
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    uint8_t* file = (uint8_t*)"shell";
+    uint8_t* arg = buf;
+    int32_t all, ret = 0;
+    uint32_t i;
+
+    /* bench [nop|null|open|read|exec|vid] [file], default: all of them */
+    if (0 != ece391_getargs (buf, BUFSIZE))
+        buf[0] = '\0';
+    for (i = 0; buf[i] != '\0' && buf[i] != ' '; i++);
+    if (buf[i] == ' ') {
+        buf[i] = '\0';
+        file = &buf[i + 1];
+    }
+    if (0 == ece391_strcmp (arg, (uint8_t*)"nop"))
+        return 0;
+    if (ece391_cycles_to_ns (1000) == 0)
+        ece391_fdputs (1, (uint8_t*)"no TSC, times in ns read as 0\n");
+
+    all = (arg[0] == '\0');
+    if (all || 0 == ece391_strcmp (arg, (uint8_t*)"null"))
+        ret |= bench_null ();
+    if (all || 0 == ece391_strcmp (arg, (uint8_t*)"open"))
+        ret |= bench_open (file);
+    if (all || 0 == ece391_strcmp (arg, (uint8_t*)"read"))
+        ret |= bench_read (file);
+    if (all || 0 == ece391_strcmp (arg, (uint8_t*)"exec"))
+        ret |= bench_exec ();
+    if (all || 0 == ece391_strcmp (arg, (uint8_t*)"vid"))
+        ret |= bench_vid ();
+    if (ret != 0) {
+        ece391_fdputs (1, (uint8_t*)"a benchmark failed\n");
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 128
+#define BATCH 256
+#define HIST_SIZE 4096
+#define TOP 10
+#define DEFAULT_MS 5000
+#define POLL_MS 100
+
+struct bucket {
+    uint32_t eip;
+    uint16_t pid;
+    uint16_t kernel;
+    uint32_t count;
+};
+
+static struct ece391_prof_sample smp[BATCH];
+static struct bucket hist[HIST_SIZE];
+static struct ece391_stat_proc snap;
+static uint32_t total, dropped, kernel, overflow;
+
+static void
+add (const struct ece391_prof_sample* s)
+{
+    uint32_t k = (s->cs & 3) == 0;
+    uint32_t h = (s->eip * 2654435761U + s->pid) & (HIST_SIZE - 1);
+    uint32_t n;
+
+    if (s->cs == 0) {
+        dropped += s->eip;
+        return;
+    }
+    total++;
+    kernel += k;
+    for (n = 0; n < HIST_SIZE; n++, h = (h + 1) & (HIST_SIZE - 1)) {
+        if (hist[h].count == 0) {
+            hist[h].eip = s->eip;
+            hist[h].pid = s->pid;
+            hist[h].kernel = k;
+        }
+        if (hist[h].eip == s->eip && hist[h].pid == s->pid) {
+            hist[h].count++;
+            return;
+        }
+    }
+    overflow++;
+}
+
+static int32_t
+drain (int32_t fd)
+{
+    int32_t cnt, i;
+
+    while (0 < (cnt = ece391_read (fd, smp, sizeof (smp)))) {
+        cnt /= sizeof (smp[0]);
+        for (i = 0; i < cnt; i++)
+            add (&smp[i]);
+    }
+    return cnt;
+}
+
+static void
+put_num (int32_t out, uint32_t value, int32_t radix)
+{
+    uint8_t buf[BUFSIZE];
+
+    ece391_itoa (value, buf, radix);
+    ece391_fdputs (out, buf);
+}
+
+/* Kernel samples are "kernel"; user samples take the name of the
+   program the pid was running when we finished (getstat only knows
+   live programs). */
+static const uint8_t*
+name_of (const struct bucket* b)
+{
+    uint32_t i;
+
+    if (b->kernel)
+        return (uint8_t*)"kernel";
+    for (i = 0; i < snap.nr_proc; i++)
+        if (snap.proc[i].pid == b->pid)
+            return snap.proc[i].name;
+    return (uint8_t*)"?";
+}
+
+/* "prof <count> <pid> <name> <eip>", the format tools/profsym.py reads */
+static void
+put_bucket (int32_t out, const struct bucket* b)
+{
+    ece391_fdputs (out, (uint8_t*)"prof ");
+    put_num (out, b->count, 10);
+    ece391_fdputs (out, (uint8_t*)" ");
+    put_num (out, b->pid, 10);
+    ece391_fdputs (out, (uint8_t*)" ");
+    ece391_fdputs (out, name_of (b));
+    ece391_fdputs (out, (uint8_t*)" 0x");
+    put_num (out, b->eip, 16);
+    ece391_fdputs (out, (uint8_t*)"\n");
+}
+
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    uint32_t ms = DEFAULT_MS, waited, i, j, best;
+    int32_t fd, out;
+
+    /* Optional argument: milliseconds to sample */
+    if (0 == ece391_getargs (buf, BUFSIZE)) {
+        ms = 0;
+        for (i = 0; buf[i] >= '0' && buf[i] <= '9'; i++)
+            ms = ms * 10 + (buf[i] - '0');
+        if (ms == 0)
+            ms = DEFAULT_MS;
+    }
+
+    if (-1 == (fd = ece391_open ((uint8_t*)ECE391_PROF_DEV))) {
+        ece391_fdputs (1, (uint8_t*)"prof not found\n");
+        return 2;
+    }
+    if (-1 == ece391_write (fd, "1", 1)) {
+        ece391_fdputs (1, (uint8_t*)"cannot start the profiler\n");
+        return 2;
+    }
+    for (waited = 0; waited < ms; waited += POLL_MS) {
+        ece391_sleep (POLL_MS);
+        drain (fd);
+    }
+    ece391_write (fd, "0", 1);
+    drain (fd);
+    ece391_close (fd);
+    ece391_getstat (ECE391_STAT_PROC, &snap, sizeof (snap));
+
+    /* The whole histogram goes to COM1 for the host-side symbolizer */
+    if (-1 != (out = ece391_open ((uint8_t*)"serial"))) {
+        for (i = 0; i < HIST_SIZE; i++)
+            if (hist[i].count != 0)
+                put_bucket (out, &hist[i]);
+        ece391_fdputs (out, (uint8_t*)"prof end\n");
+        ece391_close (out);
+    }
+
+    put_num (1, total, 10);
+    ece391_fdputs (1, (uint8_t*)" samples, ");
+    put_num (1, kernel, 10);
+    ece391_fdputs (1, (uint8_t*)" in kernel, ");
+    put_num (1, dropped + overflow, 10);
+    ece391_fdputs (1, (uint8_t*)" dropped\n");
+
+    /* Top entries on the terminal, selected in place */
+    for (j = 0; j < TOP; j++) {
+        best = HIST_SIZE;
+        for (i = 0; i < HIST_SIZE; i++)
+            if (hist[i].count != 0 &&
+                (best == HIST_SIZE || hist[i].count > hist[best].count))
+                best = i;
+        if (best == HIST_SIZE)
+            break;
+        put_bucket (1, &hist[best]);
+        hist[best].count = 0;
+    }
+    return 0;
+}
@@ -102,3 +102,184 @@ uint8_t* ece391_strrev(uint8_t* s)
    return s;
 }
 
+
+uint64_t ece391_rdtsc(void)
+{
+    uint32_t lo, hi;
+
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+uint64_t ece391_time_ns(void)
+{
+    const struct ece391_vtime* vt = (const struct ece391_vtime*)ECE391_TIME_PAGE;
+    struct ece391_timespec ts;
+    uint32_t seq, mult, shift, hi, lo;
+    uint64_t cycles;
+
+    /* No TSC, fall back to the system call */
+    if (!vt->valid) {
+        if (0 != ece391_clock_gettime (ECE391_CLOCK_MONOTONIC, &ts))
+            return 0;
+        return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    }
+
+    do {
+        seq = vt->seq;
+        mult = vt->mult;
+        shift = vt->shift;
+        cycles = ece391_rdtsc () - vt->tsc_base;
+    } while ((seq & 1) || seq != vt->seq);
+
+    /* Split the multiply so no 64-bit division helper is needed */
+    hi = (uint32_t)(cycles >> 32);
+    lo = (uint32_t)cycles;
+    return (((uint64_t)hi * mult) << (32 - shift)) +
+           (((uint64_t)lo * mult) >> shift);
+}
+
+/* TSC cycles to nanoseconds with the time page's scale, 0 without a TSC */
+uint32_t ece391_cycles_to_ns(uint32_t cycles)
+{
+    const struct ece391_vtime* vt = (const struct ece391_vtime*)ECE391_TIME_PAGE;
+
+    if (!vt->valid)
+        return 0;
+    return (uint32_t)(((uint64_t)cycles * vt->mult) >> vt->shift);
+}
+
+static void
+put_stat (const char* label, uint32_t value)
+{
+    uint8_t buf[16];
+
+    ece391_fdputs (1, (const uint8_t*)label);
+    ece391_fdputs (1, ece391_itoa (value, buf, 10));
+}
+
+/* Sort n cycle samples in place and print one line of statistics:
+ *     <name> n=.. min=.. med=.. p99=.. max=.. cyc med=.. ns
+ * Returns the median in nanoseconds (0 without a TSC). */
+uint32_t ece391_bench_stats(const uint8_t* name, uint32_t* samples, uint32_t n)
+{
+    uint32_t gap, i, j, v, med;
+
+    if (n == 0)
+        return 0;
+    /* Shell sort, fine for a few thousand samples */
+    for (gap = n / 2; gap > 0; gap /= 2) {
+        for (i = gap; i < n; i++) {
+            v = samples[i];
+            for (j = i; j >= gap && samples[j - gap] > v; j -= gap)
+                samples[j] = samples[j - gap];
+            samples[j] = v;
+        }
+    }
+    med = samples[n / 2];
+
+    ece391_fdputs (1, name);
+    put_stat (" n=", n);
+    put_stat (" min=", samples[0]);
+    put_stat (" med=", med);
+    put_stat (" p99=", samples[n - 1 - n / 100]);
+    put_stat (" max=", samples[n - 1]);
+    put_stat (" cyc med=", ece391_cycles_to_ns (med));
+    ece391_fdputs (1, (const uint8_t*)" ns\n");
+    return ece391_cycles_to_ns (med);
+}
+
+/* Start fn(arg) in a new thread running on stack[0 .. size), which must
+ * stay valid until the thread is joined.  The thread's return value is
+ * its thread_exit status.  Returns the thread ID, or -1. */
+int32_t ece391_thread_create(int32_t (*fn)(void*), void* arg, void* stack, uint32_t size)
+{
+    uint32_t* sp = (uint32_t*)(((uint32_t)stack + size) & ~15);
+
+    /* ece391_thread_entry pops fn and leaves arg as its argument */
+    *--sp = (uint32_t)arg;
+    *--sp = (uint32_t)fn;
+    return ece391_clone (ece391_thread_entry, sp);
+}
+
+/* Atomic helpers for the mutex and condition variable: each is one
+ * locked instruction (xchg is locked implicitly) */
+static uint32_t
+atomic_cmpxchg (volatile uint32_t* p, uint32_t old, uint32_t new)
+{
+    asm volatile ("lock; cmpxchgl %2, %1"
+                  : "+a" (old), "+m" (*p) : "r" (new) : "memory");
+    return old;
+}
+
+static uint32_t
+atomic_xchg (volatile uint32_t* p, uint32_t v)
+{
+    asm volatile ("xchgl %0, %1" : "+r" (v), "+m" (*p) : : "memory");
+    return v;
+}
+
+static uint32_t
+atomic_add (volatile uint32_t* p, uint32_t v)
+{
+    asm volatile ("lock; xaddl %0, %1" : "+r" (v), "+m" (*p) : : "memory");
+    return v;
+}
+
+/* Lock a mutex. Fast path: 0 -> 1. Otherwise mark it 2 so the holder's
+ * unlock knows to wake someone, and sleep until it comes back 0. */
+void ece391_mutex_lock(struct ece391_mutex* m)
+{
+    uint32_t c = atomic_cmpxchg (&m->state, 0, 1);
+
+    if (c == 0)
+        return;
+    if (c != 2)
+        c = atomic_xchg (&m->state, 2);
+    while (c != 0) {
+        ece391_futex_wait (&m->state, 2);
+        c = atomic_xchg (&m->state, 2);
+    }
+}
+
+/* Lock a mutex if it is free. Returns 0 if it was taken, -1 if busy. */
+int32_t ece391_mutex_trylock(struct ece391_mutex* m)
+{
+    return atomic_cmpxchg (&m->state, 0, 1) == 0 ? 0 : -1;
+}
+
+/* Unlock a mutex. Fast path: 1 -> 0. From 2, someone may be asleep. */
+void ece391_mutex_unlock(struct ece391_mutex* m)
+{
+    if (atomic_add (&m->state, (uint32_t)-1) != 1) {
+        m->state = 0;
+        ece391_futex_wake (&m->state, 1);
+    }
+}
+
+/* Release m, sleep until the condition is signalled, and take m back.
+ * Wakeups may be spurious; callers recheck their condition in a loop. */
+void ece391_cond_wait(struct ece391_cond* c, struct ece391_mutex* m)
+{
+    uint32_t seq = c->seq;
+
+    ece391_mutex_unlock (m);
+    ece391_futex_wait (&c->seq, seq);
+    /* Other waiters may have been woken with us: take m as contended */
+    while (atomic_xchg (&m->state, 2) != 0)
+        ece391_futex_wait (&m->state, 2);
+}
+
+/* Wake one thread in ece391_cond_wait */
+void ece391_cond_signal(struct ece391_cond* c)
+{
+    atomic_add (&c->seq, 1);
+    ece391_futex_wake (&c->seq, 1);
+}
+
+/* Wake every thread in ece391_cond_wait */
+void ece391_cond_broadcast(struct ece391_cond* c)
+{
+    atomic_add (&c->seq, 1);
+    ece391_futex_wake (&c->seq, 0x7FFFFFFF);
+}
@@ -8,6 +8,37 @@ extern int32_t ece391_strcmp(const uint8_t* s1, const uint8_t* s2);
 extern int32_t ece391_strncmp(const uint8_t* s1, const uint8_t* s2, uint32_t n);
 extern uint8_t *ece391_itoa(uint32_t value, uint8_t* buf, int32_t radix);
 extern uint8_t *ece391_strrev(uint8_t* s);
+extern uint64_t ece391_rdtsc(void);
+extern uint64_t ece391_time_ns(void);
+extern uint32_t ece391_cycles_to_ns(uint32_t cycles);
+extern uint32_t ece391_bench_stats(const uint8_t* name, uint32_t* samples, uint32_t n);
+extern int32_t ece391_thread_create(int32_t (*fn)(void*), void* arg, void* stack, uint32_t size);
+
+/*
+ * Mutex and condition variable for threads, built on futex_wait and
+ * futex_wake.  An uncontended lock or unlock is one atomic instruction
+ * and no system call.  Both start zeroed (ECE391_MUTEX_INIT,
+ * ECE391_COND_INIT).
+ */
+struct ece391_mutex {
+    /* 0 unlocked, 1 locked, 2 locked and maybe waited on */
+    volatile uint32_t state;
+};
+
+struct ece391_cond {
+    /* Bumped by every signal and broadcast */
+    volatile uint32_t seq;
+};
+
+#define ECE391_MUTEX_INIT { 0 }
+#define ECE391_COND_INIT { 0 }
+
+extern void ece391_mutex_lock(struct ece391_mutex* m);
+extern int32_t ece391_mutex_trylock(struct ece391_mutex* m);
+extern void ece391_mutex_unlock(struct ece391_mutex* m);
+extern void ece391_cond_wait(struct ece391_cond* c, struct ece391_mutex* m);
+extern void ece391_cond_signal(struct ece391_cond* c);
+extern void ece391_cond_broadcast(struct ece391_cond* c);
 
 #endif /* ECE391SUPPORT_H */
 
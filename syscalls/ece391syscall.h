@@ -22,6 +22,243 @@ extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
 
+/*
+ * sleep blocks for at least ms milliseconds and returns 0, or the
+ * milliseconds left if the alarm went off first.  alarm arms a one-shot
+ * alarm (0 cancels it) and returns what was left on the previous one;
+ * the alarm interrupts the current or next sleep.  clock_gettime only
+ * supports ECE391_CLOCK_MONOTONIC, the time since the kernel started.
+ */
+#define ECE391_CLOCK_MONOTONIC 1
+
+struct ece391_timespec {
+	uint32_t tv_sec;
+	uint32_t tv_nsec;
+};
+
+extern int32_t ece391_sleep (uint32_t ms);
+extern int32_t ece391_alarm (uint32_t ms);
+extern int32_t ece391_clock_gettime (int32_t clk_id, struct ece391_timespec* ts);
+
+/*
+ * set_quantum sets the scheduler time slice in microseconds (clamped
+ * to 100 us .. 1 s) and returns the previous one; 0 only queries it.
+ */
+extern int32_t ece391_set_quantum (uint32_t us);
+
+/*
+ * nice adds inc to the program's nice value (clamped to 0..3) and
+ * returns the new value.  Under the default MLFQ scheduler a program
+ * never runs above priority level nice; round-robin ignores it.
+ */
+extern int32_t ece391_nice (int32_t inc);
+
+/*
+ * getstat copies a snapshot of kernel statistics into buf, truncated
+ * to nbytes, and returns the number of bytes copied.  ECE391_STAT_PROC
+ * fills a struct ece391_stat_proc with per-program CPU and I/O counters;
+ * cycles are TSC cycles, tsc_khz converts them to time.
+ * ECE391_STAT_BCACHE fills a struct ece391_stat_bcache with the disk
+ * buffer cache counters.
+ */
+#define ECE391_STAT_PROC 0
+#define ECE391_STAT_BCACHE 1
+#define ECE391_STAT_NAME_LEN 32
+#define ECE391_STAT_PROC_MAX 16
+
+struct ece391_proc_acct {
+	uint64_t user_cycles;
+	uint64_t kernel_cycles;
+	uint32_t nvcsw;
+	uint32_t nivcsw;
+	uint32_t syscalls;
+	uint32_t page_faults;
+	uint64_t bytes_read;
+	uint64_t bytes_written;
+};
+
+struct ece391_proc_stat {
+	uint32_t pid;
+	uint32_t parent_pid;
+	uint32_t term;
+	uint32_t state;
+	uint32_t level;
+	uint32_t nice;
+	uint8_t name[ECE391_STAT_NAME_LEN];
+	struct ece391_proc_acct acct;
+};
+
+struct ece391_stat_proc {
+	uint32_t tsc_khz;
+	uint32_t nr_proc;
+	uint64_t now_cycles;
+	uint64_t idle_cycles;
+	struct ece391_proc_stat proc[ECE391_STAT_PROC_MAX];
+};
+
+struct ece391_stat_bcache {
+	uint32_t nr_bufs;
+	uint32_t block_size;
+	uint32_t nr_valid;
+	uint32_t nr_pinned;
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t ra_blocks;
+	uint32_t ra_hits;
+	uint32_t evictions;
+};
+
+extern int32_t ece391_getstat (uint32_t which, void* buf, int32_t nbytes);
+
+/*
+ * The kernel maps a read-only time page at ECE391_TIME_PAGE in every
+ * program.  Once valid is set, nanoseconds since boot are
+ * ((rdtsc - tsc_base) * mult) >> shift; seq is odd while it changes.
+ * ece391_time_ns in ece391support.c does this without a system call.
+ */
+#define ECE391_TIME_PAGE 0x8401000
+
+struct ece391_vtime {
+	volatile uint32_t seq;
+	uint32_t valid;
+	uint32_t mult;
+	uint32_t shift;
+	uint32_t tsc_khz;
+	uint64_t tsc_base;
+};
+
+/*
+ * Opening "trace" gives a read-only descriptor on the kernel event
+ * ring.  Each read drains whole struct ece391_trace_event records,
+ * oldest first, and returns 0 once the ring is empty.  Events are
+ * only recorded for the categories the kernel was built with
+ * (make TRACE_MASK=...).
+ */
+#define ECE391_TRACE_DEV "trace"
+#define ECE391_TR_SYSCALL_ENTER 1
+#define ECE391_TR_SYSCALL_EXIT 2
+#define ECE391_TR_IRQ_ENTER 3
+#define ECE391_TR_IRQ_EXIT 4
+#define ECE391_TR_SWITCH 5
+#define ECE391_TR_WAKEUP 6
+#define ECE391_TR_PAGE_FAULT 7
+#define ECE391_TR_LOST 8
+
+struct ece391_trace_event {
+	uint64_t tsc;
+	uint16_t type;
+	uint16_t pid;
+	uint32_t arg;
+};
+
+/*
+ * Opening "prof" gives a descriptor on the sampling profiler.  Writing
+ * "1" clears the sample buffer and starts sampling the interrupted
+ * context about once a millisecond; writing "0" or closing it stops.
+ * Reads drain whole struct ece391_prof_sample records.  A record with
+ * cs == 0 is not a sample: eip counts samples dropped while the buffer
+ * was full.  The privilege level is cs & 3 (0 = kernel).
+ */
+#define ECE391_PROF_DEV "prof"
+
+struct ece391_prof_sample {
+	uint32_t eip;
+	uint16_t cs;
+	uint16_t pid;
+};
+
+/*
+ * Every program has a submission and a completion ring at
+ * ECE391_IORING_ADDR.  Fill ring->sq[ring->sq_tail % ECE391_IORING_ENTRIES],
+ * advance sq_tail, and call io_submit, which queues up to nr new entries
+ * and returns at once.  The kernel runs queued entries in order while
+ * the program keeps running, and posts a completion for each with the
+ * entry's user_data and what read or write would have returned.
+ * io_wait returns once min_complete completions are waiting (fewer if
+ * nothing else is queued); consume cq[cq_head % ECE391_IORING_ENTRIES]
+ * and advance cq_head.  An offset of ECE391_IORING_OFF_CUR reads at
+ * the descriptor's file position and advances it, as read does.
+ */
+#define ECE391_IORING_ADDR 0x08000000
+#define ECE391_IORING_ENTRIES 64
+#define ECE391_IORING_OP_NOP 0
+#define ECE391_IORING_OP_READ 1
+#define ECE391_IORING_OP_WRITE 2
+#define ECE391_IORING_OFF_CUR 0xFFFFFFFF
+
+struct ece391_io_sqe {
+	uint8_t opcode;
+	uint8_t flags;
+	uint16_t resv;
+	int32_t fd;
+	uint32_t offset;
+	int32_t len;
+	void* buf;
+	uint32_t user_data;
+};
+
+struct ece391_io_cqe {
+	uint32_t user_data;
+	int32_t res;
+};
+
+struct ece391_io_ring {
+	volatile uint32_t sq_head;
+	volatile uint32_t cq_tail;
+	volatile uint32_t sq_tail;
+	volatile uint32_t cq_head;
+	struct ece391_io_sqe sq[ECE391_IORING_ENTRIES];
+	struct ece391_io_cqe cq[ECE391_IORING_ENTRIES];
+};
+
+extern int32_t ece391_io_submit (uint32_t nr);
+extern int32_t ece391_io_wait (uint32_t min_complete);
+
+/*
+ * readv and writev move up to ECE391_IOV_MAX buffers, in order, with
+ * one call and return the total bytes moved.  readv stops at the first
+ * short read.
+ */
+#define ECE391_IOV_MAX 16
+
+struct ece391_iovec {
+	void* base;
+	int32_t len;
+};
+
+extern int32_t ece391_readv (int32_t fd, const struct ece391_iovec* iov, int32_t iovcnt);
+extern int32_t ece391_writev (int32_t fd, const struct ece391_iovec* iov, int32_t iovcnt);
+
+/*
+ * sendfile copies up to count bytes of the file open on in_fd to out_fd
+ * inside the kernel, with no user buffer in between, and returns the
+ * bytes copied (0 at end of file).  It starts at *offset and updates
+ * it, or uses and advances in_fd's file position if offset is NULL.
+ * in_fd must be a regular file; anything else returns -1.
+ */
+extern int32_t ece391_sendfile (int32_t out_fd, int32_t in_fd, uint32_t* offset, int32_t count);
+
+/*
+ * clone starts a thread of this program at entry with its stack pointer
+ * at stack and returns its thread ID.  Threads share memory, open files
+ * and I/O rings; halt from any of them ends the whole program.  A thread
+ * other than the first ends with thread_exit, and stays around until a
+ * sibling collects its status with thread_join.  ece391_thread_create
+ * (ece391support.h) is the usual way in.
+ *
+ * futex_wait sleeps until futex_wake on the same word, unless *addr no
+ * longer holds val, in which case it returns -1 at once.  futex_wake
+ * wakes at most n waiters, oldest first, and returns how many it woke.
+ * Words are matched by physical address.  ece391_mutex and ece391_cond
+ * (ece391support.h) are built on them.
+ */
+extern int32_t ece391_clone (void* entry, void* stack);
+extern int32_t ece391_thread_exit (int32_t status);
+extern int32_t ece391_thread_join (int32_t tid, int32_t* status);
+extern int32_t ece391_futex_wait (volatile uint32_t* addr, uint32_t val);
+extern int32_t ece391_futex_wake (volatile uint32_t* addr, int32_t n);
+extern void ece391_thread_entry (void);
+
 enum signums {
 	DIV_ZERO = 0,
 	SEGFAULT,
@@ -11,5 +11,21 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_SLEEP   11
+#define SYS_ALARM   12
+#define SYS_CLOCK_GETTIME  13
+#define SYS_SET_QUANTUM  14
+#define SYS_NICE    15
+#define SYS_GETSTAT 16
+#define SYS_IO_SUBMIT 17
+#define SYS_IO_WAIT 18
+#define SYS_READV   19
+#define SYS_WRITEV  20
+#define SYS_SENDFILE 21
+#define SYS_CLONE   22
+#define SYS_THREAD_EXIT 23
+#define SYS_THREAD_JOIN 24
+#define SYS_FUTEX_WAIT 25
+#define SYS_FUTEX_WAKE 26
 
 #endif /* ECE391SYSNUM_H */
@@ -0,0 +1,66 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define NTHREAD 3
+#define STACK_SIZE 4096
+#define N 30000
+
+static uint8_t stack[NTHREAD][STACK_SIZE];
+static struct ece391_mutex lock = ECE391_MUTEX_INIT;
+static struct ece391_cond all_done = ECE391_COND_INIT;
+static uint32_t shared_total;
+static volatile uint32_t done;
+
+/* Sum one third of 0 .. N-1, into shared_total under the lock and into
+   the return value without it */
+static int32_t
+worker (void* arg)
+{
+    uint32_t part = (uint32_t)arg, i, sum = 0;
+
+    for (i = part * (N / NTHREAD); i < (part + 1) * (N / NTHREAD); i++) {
+        ece391_mutex_lock (&lock);
+        shared_total += i;
+        ece391_mutex_unlock (&lock);
+        sum += i;
+    }
+    ece391_mutex_lock (&lock);
+    if (++done == NTHREAD)
+        ece391_cond_signal (&all_done);
+    ece391_mutex_unlock (&lock);
+    return sum;
+}
+
+int main ()
+{
+    int32_t tid[NTHREAD], status;
+    uint32_t i, total = 0;
+    uint8_t buf[16];
+
+    for (i = 0; i < NTHREAD; i++) {
+        if (-1 == (tid[i] = ece391_thread_create (worker, (void*)i, stack[i], STACK_SIZE))) {
+            ece391_fdputs (1, (uint8_t*)"could not start thread\n");
+            return 3;
+        }
+    }
+
+    /* Sleep until every worker has finished */
+    ece391_mutex_lock (&lock);
+    while (done < NTHREAD)
+        ece391_cond_wait (&all_done, &lock);
+    ece391_mutex_unlock (&lock);
+
+    for (i = 0; i < NTHREAD; i++) {
+        if (-1 == ece391_thread_join (tid[i], &status))
+            return 3;
+        total += status;
+    }
+
+    ece391_fdputs (1, (uint8_t*)"sum ");
+    ece391_fdputs (1, ece391_itoa (total, buf, 10));
+    ece391_fdputs (1, (uint8_t*)(total == (uint32_t)N * (N - 1) / 2 &&
+                                 shared_total == total ? " ok\n" : " wrong\n"));
+    return 0;
+}
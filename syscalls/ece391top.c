@@ -0,0 +1,164 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 128
+#define MAX_PID 16
+#define DEFAULT_REFRESHES 10
+#define REFRESH_MS 1000
+
+static struct ece391_stat_proc snap;
+static struct ece391_stat_bcache bsnap;
+static uint64_t prev_cycles[MAX_PID];
+static uint64_t prev_now;
+
+/* Shift a and b right together until b fits in "bits" bits, so the
+   caller can finish in 32-bit math (there is no 64-bit division). */
+static void
+scale (uint64_t* a, uint64_t* b, uint32_t bits)
+{
+    while ((*b >> bits) != 0) {
+        *a >>= 1;
+        *b >>= 1;
+    }
+}
+
+static uint32_t
+percent (uint64_t part, uint64_t total)
+{
+    scale (&part, &total, 24);
+    if (total == 0)
+        return 0;
+    return (uint32_t)part * 100 / (uint32_t)total;
+}
+
+static uint32_t
+cycles_to_ms (uint64_t cycles, uint32_t khz)
+{
+    uint64_t k = khz;
+
+    scale (&k, &cycles, 32);
+    if (k == 0)
+        return 0;
+    return (uint32_t)cycles / (uint32_t)k;
+}
+
+static void
+put_col (uint32_t value, uint32_t width)
+{
+    uint8_t buf[BUFSIZE];
+    uint32_t len;
+
+    ece391_itoa (value, buf, 10);
+    for (len = ece391_strlen (buf); len < width; len++)
+        ece391_fdputs (1, (uint8_t*)" ");
+    ece391_fdputs (1, buf);
+}
+
+static void
+put_name (const uint8_t* name, uint32_t width)
+{
+    uint8_t buf[ECE391_STAT_NAME_LEN + 1];
+    uint32_t len;
+
+    for (len = 0; len < ECE391_STAT_NAME_LEN && len < width && name[len] != '\0'; len++)
+        buf[len] = name[len];
+    buf[len] = '\0';
+    ece391_fdputs (1, (uint8_t*)" ");
+    ece391_fdputs (1, buf);
+    for (; len < width; len++)
+        ece391_fdputs (1, (uint8_t*)" ");
+}
+
+static void
+show (void)
+{
+    static const char* state_name = " RWS";
+    struct ece391_proc_stat* ps;
+    uint64_t busy, interval;
+    uint8_t st[2];
+    uint32_t i;
+
+    interval = snap.now_cycles - prev_now;
+    prev_now = snap.now_cycles;
+
+    ece391_fdputs (1, (uint8_t*)
+      "PID NAME       S LV NI %CPU USR(ms) SYS(ms)  VCSW  ICSW  SYSC PF    READ   WRITE\n");
+    for (i = 0; i < snap.nr_proc; i++) {
+        ps = &snap.proc[i];
+        busy = ps->acct.user_cycles + ps->acct.kernel_cycles;
+        put_col (ps->pid, 3);
+        put_name (ps->name, 10);
+        st[0] = (ps->state < 4) ? state_name[ps->state] : '?';
+        st[1] = '\0';
+        ece391_fdputs (1, (uint8_t*)" ");
+        ece391_fdputs (1, st);
+        put_col (ps->level, 3);
+        put_col (ps->nice, 3);
+        put_col (ps->pid < MAX_PID ? percent (busy - prev_cycles[ps->pid], interval) : 0, 5);
+        put_col (cycles_to_ms (ps->acct.user_cycles, snap.tsc_khz), 8);
+        put_col (cycles_to_ms (ps->acct.kernel_cycles, snap.tsc_khz), 8);
+        put_col (ps->acct.nvcsw, 6);
+        put_col (ps->acct.nivcsw, 6);
+        put_col (ps->acct.syscalls, 6);
+        put_col (ps->acct.page_faults, 3);
+        put_col ((uint32_t)ps->acct.bytes_read, 8);
+        put_col ((uint32_t)ps->acct.bytes_written, 8);
+        ece391_fdputs (1, (uint8_t*)"\n");
+        if (ps->pid < MAX_PID)
+            prev_cycles[ps->pid] = busy;
+    }
+    ece391_fdputs (1, (uint8_t*)"idle");
+    put_col (percent (snap.idle_cycles, snap.now_cycles), 4);
+    ece391_fdputs (1, (uint8_t*)"% since boot\n");
+
+    /* Buffer cache, only in use when the file system is on a disk */
+    if (0 < ece391_getstat (ECE391_STAT_BCACHE, &bsnap, sizeof (bsnap)) &&
+      bsnap.hits + bsnap.misses != 0) {
+        ece391_fdputs (1, (uint8_t*)"bcache");
+        put_col (bsnap.nr_valid, 3);
+        ece391_fdputs (1, (uint8_t*)"/");
+        put_col (bsnap.nr_bufs, 0);
+        ece391_fdputs (1, (uint8_t*)" bufs, hit");
+        put_col (percent (bsnap.hits, bsnap.hits + bsnap.misses), 4);
+        ece391_fdputs (1, (uint8_t*)"%, readahead");
+        put_col (bsnap.ra_blocks, 6);
+        ece391_fdputs (1, (uint8_t*)" used");
+        put_col (bsnap.ra_hits, 6);
+        ece391_fdputs (1, (uint8_t*)", evict");
+        put_col (bsnap.evictions, 6);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    uint32_t n = DEFAULT_REFRESHES, i;
+
+    /* Optional argument: number of refreshes */
+    if (0 == ece391_getargs (buf, BUFSIZE)) {
+        n = 0;
+        for (i = 0; buf[i] >= '0' && buf[i] <= '9'; i++)
+            n = n * 10 + (buf[i] - '0');
+        if (n == 0)
+            n = DEFAULT_REFRESHES;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (0 >= ece391_getstat (ECE391_STAT_PROC, &snap, sizeof (snap))) {
+            ece391_fdputs (1, (uint8_t*)"getstat failed\n");
+            return 2;
+        }
+        if (snap.tsc_khz == 0) {
+            ece391_fdputs (1, (uint8_t*)"no TSC, CPU times are not counted\n");
+            return 2;
+        }
+        show ();
+        if (i + 1 < n)
+            ece391_sleep (REFRESH_MS);
+    }
+    return 0;
+}
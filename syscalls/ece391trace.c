@@ -0,0 +1,96 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 128
+#define BATCH 32
+
+static struct ece391_trace_event ev[BATCH];
+
+static const char* type_name[] = {
+    "?", "sys_enter", "sys_exit", "irq_enter", "irq_exit",
+    "switch", "wakeup", "page_fault", "lost"
+};
+
+static void
+put_hex (int32_t out, uint32_t value, uint32_t width)
+{
+    uint8_t buf[BUFSIZE];
+    uint32_t len;
+
+    ece391_itoa (value, buf, 16);
+    for (len = ece391_strlen (buf); len < width; len++)
+        ece391_fdputs (out, (uint8_t*)"0");
+    ece391_fdputs (out, buf);
+}
+
+static void
+put_dec (int32_t out, uint32_t value)
+{
+    uint8_t buf[BUFSIZE];
+
+    ece391_itoa (value, buf, 10);
+    ece391_fdputs (out, buf);
+}
+
+/* One line per event: 64-bit TSC in hex, pid, type, argument.  The
+   TSC is left raw; tsc_khz from getstat converts it to time. */
+static void
+show (int32_t out, const struct ece391_trace_event* e)
+{
+    put_hex (out, (uint32_t)(e->tsc >> 32), 8);
+    put_hex (out, (uint32_t)e->tsc, 8);
+    ece391_fdputs (out, (uint8_t*)" ");
+    put_dec (out, e->pid);
+    ece391_fdputs (out, (uint8_t*)" ");
+    ece391_fdputs (out, (uint8_t*)(e->type <= ECE391_TR_LOST ? type_name[e->type] : type_name[0]));
+    ece391_fdputs (out, (uint8_t*)" ");
+    if (e->type == ECE391_TR_PAGE_FAULT) {
+        ece391_fdputs (out, (uint8_t*)"0x");
+        put_hex (out, e->arg, 8);
+    } else {
+        put_dec (out, e->arg);
+    }
+    ece391_fdputs (out, (uint8_t*)"\n");
+}
+
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    int32_t fd, out = 1, cnt, i;
+    uint32_t total = 0;
+    uint64_t start;
+
+    /* "trace serial" dumps to COM1 instead of the terminal */
+    if (0 == ece391_getargs (buf, BUFSIZE) &&
+        0 == ece391_strcmp (buf, (uint8_t*)"serial")) {
+        if (-1 == (out = ece391_open ((uint8_t*)"serial"))) {
+            ece391_fdputs (1, (uint8_t*)"serial not found\n");
+            return 2;
+        }
+    }
+    if (-1 == (fd = ece391_open ((uint8_t*)ECE391_TRACE_DEV))) {
+        ece391_fdputs (1, (uint8_t*)"trace not found\n");
+        return 2;
+    }
+
+    /* Our own system calls keep adding events; stop at the ones
+       recorded after we started so the dump terminates. */
+    start = ece391_rdtsc ();
+    while (0 < (cnt = ece391_read (fd, ev, sizeof (ev)))) {
+        cnt /= sizeof (ev[0]);
+        for (i = 0; i < cnt && ev[i].tsc < start; i++)
+            show (out, &ev[i]);
+        total += i;
+        if (i < cnt)
+            break;
+    }
+    if (total == 0)
+        ece391_fdputs (1, (uint8_t*)"no events, build with TRACE_MASK set\n");
+
+    ece391_close (fd);
+    if (out != 1)
+        ece391_close (out);
+    return 0;
+}
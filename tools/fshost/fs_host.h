@@ -0,0 +1,36 @@
+/* fs_host.h
+ * Stand-in for types.h and lib.h when file_system.c is Built on the
+ * Host (-DFS_HOST). The Harness decides where printf() Output goes.
+ */
+
+#ifndef _FS_HOST_H
+#define _FS_HOST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Keep the Kernel Headers from Redefining the Host Types
+#define _TYPES_H
+#define _LIB_H
+
+#define VERBOSE 0
+
+// Single-Threaded, the Kernel's Sleeping Lock is not Needed
+typedef struct kmutex_t {
+	uint32_t locked;
+} kmutex_t;
+#define kmutex_lock(m)		((void) (m))
+#define kmutex_unlock(m)	((void) (m))
+
+// Kernel printf(), Implemented by the Harness
+int fs_host_printf(const char *format, ...);
+#define printf fs_host_printf
+
+// klog() Prints at once, there is no Drain Tasklet
+#define _KLOG_H
+#define KLOG_ERR	0
+#define KLOG_WARN	1
+#define klog(level, ...)	fs_host_printf(__VA_ARGS__)
+
+#endif // _FS_HOST_H
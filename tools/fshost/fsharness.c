@@ -0,0 +1,379 @@
+/* fsharness.c
+ * Host Harness for file_system.c
+ *
+ *     fsharness [-i image] [-d] ls
+ *     fsharness [-i image] [-d] bench [rounds]
+ *     fsharness [-i image] [-d] fuzz [cases] [seed]
+ *     fsharness [-i image] -d pin
+ *
+ * The image defaults to student-distrib/filesys_img. -d mounts it as a
+ * disk, so reads go through the buffer cache. "bench" times
+ * read_dentry_by_name() and read_file() on the real image. "fuzz"
+ * mutates the metadata of a copy, runs every entry point over it in a
+ * child process, and saves the images that crash as crash-<n>.img.
+ * "pin" pins every buffer of the cache and checks that a miss then
+ * fails instead of evicting one, and that unpinning one frees it.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "file_system.h"
+
+#define FS_BLOCK	FS_BLOCK_SIZE
+#define DENTRY_MAX	FS_DENTRY_MAX
+#define INODE_BLOCKS	FS_INODE_BLOCKS
+// Largest File the Format can Describe
+#define FILE_MAX	(INODE_BLOCKS * FS_BLOCK)
+// Unmapped Space after a Fuzzed Image, so Overruns Fault
+#define GUARD_SIZE	(16 << 20)
+
+// Defined by syscall.c in the Kernel
+int file_read_dentry;
+
+static int quiet;
+static unsigned char buf[FILE_MAX];
+
+int fs_host_printf(const char *format, ...) {
+	va_list ap;
+	int ret;
+
+	if (quiet) return 0;
+	va_start(ap, format);
+	ret = vprintf(format, ap);
+	va_end(ap);
+	return ret;
+}
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static unsigned char *load_image(const char *path, size_t *size) {
+	struct stat st;
+	unsigned char *img;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		perror(path);
+		exit(2);
+	}
+	img = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (img == MAP_FAILED) {
+		perror("mmap");
+		exit(2);
+	}
+	close(fd);
+	*size = st.st_size;
+	return img;
+}
+
+// The Image as a Block Device, Mounted the way the Kernel does
+static blkdev_t img_dev;
+static int as_disk;
+static unsigned char *disk_img;
+
+// A Disk that is not Read in Place, so the Buffer Cache is Used
+static int32_t disk_read(blkdev_t *dev, uint32_t lba, uint32_t count, void *dst) {
+	memcpy(dst, disk_img + (size_t) lba * BLKDEV_SECTOR, (size_t) count * BLKDEV_SECTOR);
+	return 0;
+}
+
+static int mount_image(unsigned char *img, size_t size) {
+	ramdisk_init(&img_dev, "img", img, size);
+	if (as_disk) {
+		disk_img = img;
+		img_dev.mem = NULL;
+		img_dev.read = disk_read;
+	}
+	return fs_mount(&img_dev);
+}
+
+static int cmd_ls(void) {
+	uint32_t i;
+	dentry_t d;
+
+	for (i = 0; i < bl->num_dentries && i < DENTRY_MAX; i++) {
+		read_dentry_by_index(i, &d);
+		fprintf(stdout, "%-32s type %u inode %2u %8u bytes\n", (char *) d.file_name,
+			d.file_type, d.inode_index, d.file_type == 2 ? fs_file_length(d.inode_index) : 0);
+	}
+	return 0;
+}
+
+static int cmd_bench(unsigned rounds) {
+	static const unsigned sizes[] = {64, 1024, 4096, 65536, FILE_MAX};
+	unsigned r, i, s, n = 0;
+	uint64_t bytes;
+	dentry_t d;
+	double t;
+	unsigned char names[DENTRY_MAX][33];
+
+	for (i = 0; i < bl->num_dentries && i < DENTRY_MAX; i++, n++) {
+		memcpy(names[i], bl->dentries[i].file_name, 32);
+		names[i][32] = '\0';
+	}
+
+	t = now_ns();
+	for (r = 0; r < rounds; r++)
+		for (i = 0; i < n; i++)
+			read_dentry_by_name(names[i], &d);
+	fprintf(stdout, "read_dentry_by_name hit  %8.1f ns\n", (now_ns() - t) / ((double) rounds * n));
+
+	t = now_ns();
+	for (r = 0; r < rounds; r++)
+		read_dentry_by_name((unsigned char *) "no-such-file", &d);
+	fprintf(stdout, "read_dentry_by_name miss %8.1f ns\n", (now_ns() - t) / rounds);
+
+	for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		bytes = 0;
+		t = now_ns();
+		for (r = 0; r < rounds / 10 + 1; r++) {
+			for (i = 0; i < n; i++) {
+				uint32_t off, len, got;
+				int32_t h;
+				if (bl->dentries[i].file_type != 2) continue;
+				if ((h = open_file(names[i])) == -1) continue;
+				len = fs_file_length(bl->dentries[i].inode_index);
+				for (off = 0; off < len; off += got) {
+					got = read_file(h, off, buf, sizes[s]);
+					if (got == 0 || got == (uint32_t) -1) break;
+					bytes += got;
+				}
+				close_file(h);
+			}
+		}
+		t = now_ns() - t;
+		fprintf(stdout, "read_file %7u B chunks %8.1f MB/s\n", sizes[s], bytes * 1e3 / t);
+	}
+	if (as_disk) {
+		stat_bcache_t st;
+		bcache_stat(&st);
+		fprintf(stdout, "bcache %u x %u B: %u hits %u misses (%.1f%%), %u read ahead %u used, %u evictions, %u device reads\n",
+			st.nr_bufs, st.block_size, st.hits, st.misses, 100.0 * st.hits / (st.hits + st.misses + !st.hits),
+			st.ra_blocks, st.ra_hits, st.evictions, img_dev.nr_reads);
+	}
+	return 0;
+}
+
+static int cmd_pin(void) {
+	buf_t *pinned[BCACHE_NR], *b;
+	uint32_t i;
+	int ok = 1;
+
+	if (!as_disk || img_dev.nr_sectors / BCACHE_BLOCK_SECTORS <= BCACHE_NR) {
+		fprintf(stderr, "pin needs -d and an image of more than %d blocks\n", BCACHE_NR);
+		return 2;
+	}
+	for (i = 0; i < BCACHE_NR; i++) {
+		if ((pinned[i] = bread(&img_dev, i)) == NULL)
+			ok = 0;
+	}
+	if (ok) {
+		// Every Buffer is Pinned, so a Miss finds no Victim
+		quiet = 1;
+		if ((b = bread(&img_dev, BCACHE_NR)) != NULL) {
+			ok = 0;
+			brelse(b);
+		}
+		quiet = 0;
+		// A Hit on a Pinned Block still Succeeds
+		if ((b = bread(&img_dev, 0)) != pinned[0])
+			ok = 0;
+		if (b != NULL)
+			brelse(b);
+		// The only Unpinned Buffer is the one the CLOCK Hand Reuses
+		brelse(pinned[BCACHE_NR / 2]);
+		b = bread(&img_dev, BCACHE_NR);
+		if (b != pinned[BCACHE_NR / 2] || b->block != BCACHE_NR)
+			ok = 0;
+		pinned[BCACHE_NR / 2] = b;
+	}
+	for (i = 0; i < BCACHE_NR; i++) {
+		if (pinned[i] != NULL)
+			brelse(pinned[i]);
+	}
+	fprintf(stdout, "pin %s\n", ok ? "ok" : "FAILED");
+	return !ok;
+}
+
+static uint32_t rng_state;
+
+static uint32_t rng(void) {
+	// xorshift32
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+// Values that tend to Hit Boundaries
+static uint32_t interesting(void) {
+	static const uint32_t v[] = {0, 1, 2, 62, 63, 64, 1023, 1024, 4095, 4096,
+		0x7FFFFFFF, 0x80000000, 0xFFFFFFFE, 0xFFFFFFFF};
+	switch (rng() % 3) {
+	case 0: return v[rng() % (sizeof(v) / sizeof(v[0]))];
+	case 1: return rng() % 256;
+	default: return rng();
+	}
+}
+
+static void mutate(unsigned char *img, size_t size) {
+	uint32_t *w = (uint32_t *) img;
+	unsigned k, count = 1 + rng() % 4;
+
+	for (k = 0; k < count; k++) {
+		switch (rng() % 6) {
+		case 0:	// Boot Block Counts
+			w[rng() % 3] = interesting();
+			break;
+		case 1:	// Dentry Type or Inode
+			((uint32_t *) &((bootblock *) img)->dentries[rng() % DENTRY_MAX].file_type)[rng() % 2] = interesting();
+			break;
+		case 2:	// Dentry Name without Terminator
+			memset(((bootblock *) img)->dentries[rng() % DENTRY_MAX].file_name, 'A' + rng() % 26, 32);
+			break;
+		case 3:	// Inode Length or Block Index
+			if (size >= 2 * FS_BLOCK) {
+				uint32_t ino = rng() % (size / FS_BLOCK - 1);
+				w[(ino + 1) * (FS_BLOCK / 4) + rng() % 8] = interesting();
+			}
+			break;
+		default:	// Random Byte
+			img[rng() % size] = rng();
+			break;
+		}
+	}
+}
+
+// Every Entry Point, with Arguments taken from the (Malformed) Image
+static void exercise(void) {
+	dentry_t d;
+	unsigned i, n;
+	int32_t h;
+	char out[33];
+	iovec_t iov[2];
+
+	for (i = 0; i < DENTRY_MAX + 2; i++) {
+		if (read_dentry_by_index(i, &d) == 0) {
+			read_dentry_by_name(d.file_name, &d);
+			check_file(d.file_name);
+			read_file_data(d.file_name, rng() % 8192, buf, rng() % FILE_MAX);
+			if ((h = open_file(d.file_name)) != -1) {
+				read_file(h, 0, buf, FILE_MAX);
+				read_file(h, rng() % (2 * FILE_MAX), buf, rng() % FILE_MAX);
+				iov[0].base = buf;
+				iov[0].len = rng() % (FILE_MAX / 2);
+				iov[1].base = buf + FILE_MAX / 2;
+				iov[1].len = rng() % (FILE_MAX / 2);
+				read_file_v(h, rng() % (2 * FILE_MAX), iov, 2);
+				close_file(h);
+			}
+		}
+	}
+	n = bl->num_inodes < 256 ? bl->num_inodes + 2 : 256;
+	for (i = 0; i < n; i++) {
+		read_data(i, 0, buf, FILE_MAX);
+		read_data(i, rng() % (2 * FILE_MAX), buf, rng() % FILE_MAX);
+	}
+	file_read_dentry = 0;
+	for (i = 0; i < DENTRY_MAX + 2; i++) {
+		if (read_directory(0, 0, out, 32) <= 0) break;
+	}
+}
+
+static int cmd_fuzz(const unsigned char *orig, size_t size, unsigned cases, uint32_t seed) {
+	size_t span = (size + FS_BLOCK - 1) & ~(size_t) (FS_BLOCK - 1);
+	unsigned char *img;
+	unsigned c, crashes = 0;
+	int status;
+	pid_t pid;
+	char name[64];
+	FILE *f;
+
+	// The Image, then a Guard Region that Faults on Access
+	img = mmap(NULL, span + GUARD_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (img == MAP_FAILED || mprotect(img, span, PROT_READ | PROT_WRITE) < 0) {
+		perror("mmap");
+		return 2;
+	}
+	rng_state = seed ? seed : 1;
+	for (c = 0; c < cases; c++) {
+		memcpy(img, orig, size);
+		mutate(img, size);
+		fflush(stdout);
+		pid = fork();
+		if (pid == 0) {
+			quiet = 1;
+			// Images the Mount Rejects never Reach the Readers
+			if (mount_image(img, size) == 0)
+				exercise();
+			_exit(0);
+		}
+		waitpid(pid, &status, 0);
+		if (WIFSIGNALED(status)) {
+			snprintf(name, sizeof(name), "crash-%u.img", c);
+			if ((f = fopen(name, "wb")) != NULL) {
+				fwrite(img, 1, size, f);
+				fclose(f);
+			}
+			fprintf(stdout, "case %u: signal %d, saved %s\n", c, WTERMSIG(status), name);
+			crashes++;
+		}
+		// Keep the Children's Random Choices Independent
+		rng();
+	}
+	fprintf(stdout, "%u cases, %u crashes (seed %u)\n", cases, crashes, seed);
+	return crashes != 0;
+}
+
+int main(int argc, char **argv) {
+	const char *path = "../../student-distrib/filesys_img";
+	unsigned char *img;
+	size_t size;
+	int a = 1;
+
+	for (; a < argc && argv[a][0] == '-'; a++) {
+		if (strcmp(argv[a], "-i") == 0 && a + 1 < argc)
+			path = argv[++a];
+		else if (strcmp(argv[a], "-d") == 0)
+			as_disk = 1;
+		else
+			break;
+	}
+	if (a >= argc || argv[a][0] == '-') {
+		fprintf(stderr, "usage: %s [-i image] [-d] ls | bench [rounds] | fuzz [cases] [seed] | pin\n", argv[0]);
+		return 2;
+	}
+	img = load_image(path, &size);
+	if (size < FS_BLOCK) {
+		fprintf(stderr, "%s: too small for a boot block\n", path);
+		return 2;
+	}
+	if (mount_image(img, size) != 0) {
+		fprintf(stderr, "%s: not a file system image\n", path);
+		return 2;
+	}
+
+	if (strcmp(argv[a], "ls") == 0)
+		return cmd_ls();
+	if (strcmp(argv[a], "bench") == 0)
+		return cmd_bench(a + 1 < argc ? atoi(argv[a + 1]) : 100000);
+	if (strcmp(argv[a], "fuzz") == 0)
+		return cmd_fuzz(img, size, a + 1 < argc ? atoi(argv[a + 1]) : 10000,
+			a + 2 < argc ? strtoul(argv[a + 2], NULL, 0) : (uint32_t) time(NULL));
+	if (strcmp(argv[a], "pin") == 0)
+		return cmd_pin();
+	fprintf(stderr, "unknown command %s\n", argv[a]);
+	return 2;
+}
@@ -0,0 +1,233 @@
+/* mkfs.c
+ * File System Image Builder
+ *
+ *     mkfs -i <dir> -o <image> [-f <order file>] [-a <bytes>] [-v]
+ *
+ * Writes the layout read by student-distrib/file_system.c: a boot block
+ * with up to 63 dentries, one 4 kB block per inode, then the data
+ * blocks. Unlike createfs:
+ *  - every file's blocks are contiguous, in dentry order, so a file can
+ *    be read with one long copy
+ *  - dentries are ordered by expected access frequency, since lookups
+ *    scan them from the start: ".", the names in the order file (most
+ *    used first), "shell", other executables, data files, then "rtc"
+ *  - "-a" starts each executable at an image offset that is a multiple
+ *    of the given size. Blocks are 4 kB and boot modules are page
+ *    aligned, so executables are always 4 kB aligned; "-a" is for
+ *    mapping them with larger pages.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define FS_BLOCK	4096
+#define NAME_LEN	32
+#define DENTRY_MAX	63
+#define INODE_BLOCKS	1023
+#define FTYPE_RTC	0
+#define FTYPE_DIRECTORY	1
+#define FTYPE_REGULAR	2
+
+/* On-disk Structures, as in file_system.h */
+typedef struct {
+	char name[NAME_LEN];
+	uint32_t type;
+	uint32_t inode;
+	uint8_t reserved[24];
+} disk_dentry_t;
+
+typedef struct {
+	uint32_t num_dentries;
+	uint32_t num_inodes;
+	uint32_t num_data_blocks;
+	uint8_t reserved[52];
+	disk_dentry_t dentries[DENTRY_MAX];
+} disk_boot_t;
+
+typedef struct {
+	char name[NAME_LEN + 1];
+	char path[4096];
+	uint32_t size;
+	int exe;
+	int rank;
+} file_t;
+
+static file_t files[DENTRY_MAX];
+static int nfiles;
+static int verbose;
+
+/* Lower Ranks come First */
+static int rank_of(const file_t *f, char **order, int norder) {
+	int i;
+	for (i = 0; i < norder; i++)
+		if (strncmp(order[i], f->name, NAME_LEN) == 0) return i;
+	if (strcmp(f->name, "shell") == 0) return norder;
+	return norder + (f->exe ? 1 : 2);
+}
+
+static int by_rank(const void *a, const void *b) {
+	const file_t *x = a, *y = b;
+	if (x->rank != y->rank) return x->rank - y->rank;
+	return strcmp(x->name, y->name);
+}
+
+static int is_elf(const char *path) {
+	unsigned char magic[4] = {0};
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) return 0;
+	if (fread(magic, 1, 4, f) != 4) magic[0] = 0;
+	fclose(f);
+	return memcmp(magic, "\177ELF", 4) == 0;
+}
+
+static char **read_order(const char *path, int *n) {
+	static char *names[DENTRY_MAX];
+	char line[256];
+	FILE *f = fopen(path, "r");
+
+	*n = 0;
+	if (f == NULL) {
+		perror(path);
+		exit(1);
+	}
+	while (*n < DENTRY_MAX && fgets(line, sizeof(line), f) != NULL) {
+		line[strcspn(line, " \t\r\n#")] = '\0';
+		if (line[0] != '\0') names[(*n)++] = strdup(line);
+	}
+	fclose(f);
+	return names;
+}
+
+static void scan(const char *dir) {
+	DIR *d = opendir(dir);
+	struct dirent *e;
+	struct stat st;
+	file_t *f;
+
+	if (d == NULL) {
+		perror(dir);
+		exit(1);
+	}
+	while ((e = readdir(d)) != NULL) {
+		if (e->d_name[0] == '.') continue;
+		// ".", "rtc" and the Files share the 63 Dentries
+		if (nfiles == DENTRY_MAX - 2) {
+			fprintf(stderr, "mkfs: too many files, %s and later are left out\n", e->d_name);
+			break;
+		}
+		f = &files[nfiles];
+		snprintf(f->path, sizeof(f->path), "%s/%s", dir, e->d_name);
+		if (stat(f->path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+		if (st.st_size > (off_t) INODE_BLOCKS * FS_BLOCK) {
+			fprintf(stderr, "mkfs: %s is larger than %d blocks, skipped\n", f->path, INODE_BLOCKS);
+			continue;
+		}
+		if (strlen(e->d_name) > NAME_LEN)
+			fprintf(stderr, "mkfs: %s is truncated to %d characters\n", e->d_name, NAME_LEN);
+		memset(f->name, 0, sizeof(f->name));
+		memcpy(f->name, e->d_name, strnlen(e->d_name, NAME_LEN));
+		f->size = st.st_size;
+		f->exe = is_elf(f->path);
+		nfiles++;
+	}
+	closedir(d);
+}
+
+int main(int argc, char **argv) {
+	const char *in = NULL, *out = NULL, *order_path = NULL;
+	uint32_t align = 0, block, first, i, nblocks, ndent = 0, data_start;
+	char **order = NULL;
+	int norder = 0, opt;
+	disk_boot_t *boot;
+	uint8_t *img;
+	uint32_t *ino;
+	FILE *f;
+
+	for (opt = 1; opt < argc; opt++) {
+		if (strcmp(argv[opt], "-v") == 0) verbose = 1;
+		else if (opt + 1 < argc && strcmp(argv[opt], "-i") == 0) in = argv[++opt];
+		else if (opt + 1 < argc && strcmp(argv[opt], "-o") == 0) out = argv[++opt];
+		else if (opt + 1 < argc && strcmp(argv[opt], "-f") == 0) order_path = argv[++opt];
+		else if (opt + 1 < argc && strcmp(argv[opt], "-a") == 0) align = strtoul(argv[++opt], NULL, 0);
+		else break;
+	}
+	if (in == NULL || out == NULL || opt != argc ||
+		(align != 0 && (align % FS_BLOCK != 0 || (align & (align - 1)) != 0))) {
+		fprintf(stderr, "usage: %s -i <dir> -o <image> [-f <order file>] [-a <bytes>] [-v]\n"
+			"  -a must be a power of 2 and a multiple of %d\n", argv[0], FS_BLOCK);
+		return 1;
+	}
+	if (order_path != NULL) order = read_order(order_path, &norder);
+
+	scan(in);
+	for (i = 0; i < (uint32_t) nfiles; i++) files[i].rank = rank_of(&files[i], order, norder);
+	qsort(files, nfiles, sizeof(file_t), by_rank);
+
+	// Inode 0 is Empty and Named by "." and "rtc", Files use 1..n
+	data_start = 1 + 1 + nfiles;
+	nblocks = 0;
+	for (i = 0; i < (uint32_t) nfiles; i++) {
+		if (align != 0 && files[i].exe)
+			while (((data_start + nblocks) * FS_BLOCK) % align != 0) nblocks++;
+		nblocks += (files[i].size + FS_BLOCK - 1) / FS_BLOCK;
+	}
+
+	img = calloc(data_start + nblocks, FS_BLOCK);
+	if (img == NULL) {
+		perror("calloc");
+		return 1;
+	}
+	boot = (disk_boot_t *) img;
+
+	strcpy(boot->dentries[ndent].name, ".");
+	boot->dentries[ndent++].type = FTYPE_DIRECTORY;
+
+	block = 0;
+	for (i = 0; i < (uint32_t) nfiles; i++) {
+		uint32_t b, n = (files[i].size + FS_BLOCK - 1) / FS_BLOCK;
+
+		if (align != 0 && files[i].exe)
+			while (((data_start + block) * FS_BLOCK) % align != 0) block++;
+		first = block;
+		memcpy(boot->dentries[ndent].name, files[i].name, NAME_LEN);
+		boot->dentries[ndent].type = FTYPE_REGULAR;
+		boot->dentries[ndent++].inode = 1 + i;
+
+		ino = (uint32_t *) (img + (2 + i) * FS_BLOCK);
+		ino[0] = files[i].size;
+		for (b = 0; b < n; b++) ino[1 + b] = block++;
+
+		f = fopen(files[i].path, "rb");
+		if (f == NULL || fread(img + (data_start + first) * FS_BLOCK, 1, files[i].size, f) != files[i].size) {
+			perror(files[i].path);
+			return 1;
+		}
+		fclose(f);
+		if (verbose)
+			printf("%2u %-32s %7u bytes  blocks %u-%u%s\n", ndent - 1, files[i].name,
+				files[i].size, first, first + n - (n != 0), files[i].exe ? "  exe" : "");
+	}
+
+	strcpy(boot->dentries[ndent].name, "rtc");
+	boot->dentries[ndent++].type = FTYPE_RTC;
+
+	boot->num_dentries = ndent;
+	boot->num_inodes = 1 + nfiles;
+	boot->num_data_blocks = nblocks;
+
+	f = fopen(out, "wb");
+	if (f == NULL || fwrite(img, FS_BLOCK, data_start + nblocks, f) != data_start + nblocks) {
+		perror(out);
+		return 1;
+	}
+	fclose(f);
+	if (verbose)
+		printf("%u dentries, %u inodes, %u data blocks, %u bytes\n", ndent,
+			boot->num_inodes, nblocks, (data_start + nblocks) * FS_BLOCK);
+	free(img);
+	return 0;
+}
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Symbolize the histogram printed by the "prof" user program.
+
+prof writes one line per sampled address to COM1:
+
+    prof <count> <pid> <name> 0x<eip>
+
+Run QEMU with "-serial file:serial.log" (or stdio) and pass the log
+here.  Kernel addresses are looked up in student-distrib/bootimg,
+user addresses in the unstripped syscalls/<name>.exe when it exists,
+otherwise in fsdir/<name>.  The result is a flat profile by function.
+
+    tools/profsym.py serial.log
+"""
+
+import argparse
+import bisect
+import os
+import subprocess
+import sys
+from collections import defaultdict
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+class SymbolTable:
+    """Sorted text symbols of one ELF file, read with nm."""
+
+    def __init__(self, path):
+        self.path = path
+        self.addrs = []
+        self.names = []
+        if path is None:
+            return
+        try:
+            out = subprocess.run(["nm", "-n", path], capture_output=True,
+                                 text=True, check=True).stdout
+        except (OSError, subprocess.CalledProcessError):
+            return
+        for line in out.splitlines():
+            parts = line.split()
+            if len(parts) == 3 and parts[1] in "tTwW":
+                self.addrs.append(int(parts[0], 16))
+                self.names.append(parts[2])
+
+    def lookup(self, addr):
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return "0x%08x" % addr
+        return self.names[i]
+
+
+def user_binary(name, fsdir, userdir):
+    for path in (os.path.join(userdir, name + ".exe"),
+                 os.path.join(fsdir, name)):
+        if os.path.isfile(path):
+            return path
+    return None
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("log", nargs="?", default="-",
+                    help="serial log holding the prof output (default stdin)")
+    ap.add_argument("--kernel", default=os.path.join(ROOT, "student-distrib", "bootimg"))
+    ap.add_argument("--fsdir", default=os.path.join(ROOT, "fsdir"))
+    ap.add_argument("--userdir", default=os.path.join(ROOT, "syscalls"))
+    ap.add_argument("--addr", action="store_true",
+                    help="keep one row per address instead of per function")
+    args = ap.parse_args()
+
+    log = sys.stdin if args.log == "-" else open(args.log, errors="replace")
+    tables = {"kernel": SymbolTable(args.kernel)}
+    flat = defaultdict(int)
+    total = 0
+    for line in log:
+        parts = line.split()
+        # The histogram may share the log with console output
+        if len(parts) != 5 or parts[0] != "prof":
+            continue
+        count, name, eip = int(parts[1]), parts[3], int(parts[4], 16)
+        if name not in tables:
+            tables[name] = SymbolTable(user_binary(name, args.fsdir, args.userdir))
+        sym = tables[name].lookup(eip)
+        if args.addr:
+            sym = "%s (0x%08x)" % (sym, eip)
+        flat[(name, sym)] += count
+        total += count
+
+    if total == 0:
+        sys.exit("no prof lines found")
+    print("%7s %7s  %-10s %s" % ("%", "samples", "object", "function"))
+    for (name, sym), count in sorted(flat.items(), key=lambda kv: -kv[1]):
+        print("%6.2f%% %7d  %-10s %s" % (100.0 * count / total, count, name, sym))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""Boot the "make bench" kernel headless in QEMU and collect its results.
+
+The kernel prints "BENCH <name> <value> <unit>" lines on COM1 between
+"BENCH BEGIN" and "BENCH END" (see student-distrib/bench.c).  This
+script boots the disk image one or more times, takes the median of
+each benchmark and prints the results as JSON.  With --baseline it
+compares against an earlier JSON file and exits non-zero on a
+regression.
+
+    cd student-distrib && make bench
+    tools/runbench.py --runs 5 --out bench.json
+    tools/runbench.py --runs 5 --baseline bench.json
+
+Time-based units (ns) are better when lower; rates are better when higher.
+"""
+
+import argparse
+import json
+import os
+import queue
+import statistics
+import subprocess
+import sys
+import threading
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+LOWER_IS_BETTER = ("ns",)
+
+
+def boot_once(args):
+    """Run QEMU until BENCH END and return {name: (value, unit)}."""
+    cmd = [args.qemu, "-m", "256", "-hda", args.image, "-display", "none",
+           "-serial", "stdio", "-monitor", "none", "-no-reboot"]
+    if args.kvm:
+        cmd += ["-enable-kvm", "-cpu", "host"]
+    proc = subprocess.Popen(cmd, stdout=subprocess.PIPE,
+                            stderr=subprocess.DEVNULL, text=True,
+                            errors="replace")
+    # Read on a thread so a guest that hangs without printing still
+    # times out; None marks the end of QEMU's output.
+    lines = queue.Queue()
+
+    def reader():
+        for line in proc.stdout:
+            lines.put(line)
+        lines.put(None)
+
+    threading.Thread(target=reader, daemon=True).start()
+    results = {}
+    done = False
+    deadline = time.monotonic() + args.timeout
+    try:
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                break
+            try:
+                line = lines.get(timeout=remaining)
+            except queue.Empty:
+                break
+            if line is None:
+                break
+            parts = line.split()
+            if len(parts) == 4 and parts[0] == "BENCH":
+                if parts[1] == "END":
+                    done = True
+                    break
+                if parts[1] != "BEGIN":
+                    results[parts[1]] = (int(parts[2]), parts[3])
+    finally:
+        proc.kill()
+        proc.wait()
+    if not done:
+        sys.exit("benchmark run did not finish (is the image built with make bench?)")
+    return results
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--image", default=os.path.join(ROOT, "student-distrib", "mp3.img"))
+    ap.add_argument("--qemu", default="qemu-system-i386")
+    ap.add_argument("--runs", type=int, default=3, help="boots to take the median of")
+    ap.add_argument("--timeout", type=float, default=120.0, help="seconds per boot")
+    ap.add_argument("--kvm", action="store_true", help="use KVM instead of TCG")
+    ap.add_argument("--out", help="write the JSON results here as well")
+    ap.add_argument("--baseline", help="JSON results to compare against")
+    ap.add_argument("--tolerance", type=float, default=10.0,
+                    help="allowed regression in percent (default 10)")
+    args = ap.parse_args()
+
+    runs = [boot_once(args) for _ in range(args.runs)]
+    report = {"runs": args.runs, "accel": "kvm" if args.kvm else "tcg",
+              "results": {}}
+    for name, (_, unit) in runs[0].items():
+        values = [r[name][0] for r in runs if name in r]
+        report["results"][name] = {
+            "value": statistics.median(values),
+            "unit": unit,
+            "min": min(values),
+            "max": max(values),
+        }
+
+    text = json.dumps(report, indent=2, sort_keys=True)
+    print(text)
+    if args.out:
+        with open(args.out, "w") as f:
+            f.write(text + "\n")
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            base = json.load(f)["results"]
+        failed = False
+        for name, cur in sorted(report["results"].items()):
+            if name not in base or base[name]["value"] == 0:
+                continue
+            change = 100.0 * (cur["value"] - base[name]["value"]) / base[name]["value"]
+            worse = change > 0 if cur["unit"] in LOWER_IS_BETTER else change < 0
+            status = "REGRESSION" if worse and abs(change) > args.tolerance else "ok"
+            failed |= status != "ok"
+            print("%-20s %+7.1f%%  %s" % (name, change, status), file=sys.stderr)
+        sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()